@@ -0,0 +1,426 @@
+/******************************************************************************
+ *
+ *  Copyright 2024 NXP
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/*
+ *  Plan the AID entries of the listen mode routing table.
+ */
+#include "AidRoutingPlanner.h"
+
+const int AidRoutingPlanner::AID_INFO_PREFIX;
+const int AidRoutingPlanner::AID_INFO_SUBSET;
+const int AidRoutingPlanner::AID_INFO_BLOCKED;
+const size_t AidRoutingPlanner::TLV_HEADER_LEN;
+
+/*******************************************************************************
+**
+** Function:        AidRoutingPlanner
+**
+** Description:     Initialize member variables.
+**
+** Returns:         None
+**
+*******************************************************************************/
+AidRoutingPlanner::AidRoutingPlanner()
+    : mPrefixSupported(false), mPrefixOnly(false) {}
+
+/*******************************************************************************
+**
+** Function:        setMatching
+**
+** Description:     Set how the controller matches AID entries.
+**                  prefixSupported: Entries can be matched as prefix.
+**                  prefixOnly: Every entry is matched as prefix.
+**
+** Returns:         None
+**
+*******************************************************************************/
+void AidRoutingPlanner::setMatching(bool prefixSupported, bool prefixOnly) {
+  mPrefixSupported = prefixSupported || prefixOnly;
+  mPrefixOnly = prefixOnly;
+}
+
+/*******************************************************************************
+**
+** Function:        add
+**
+** Description:     Register an AID, or replace its route.
+**                  entry: AID entry.
+**
+** Returns:         None
+**
+*******************************************************************************/
+void AidRoutingPlanner::add(const Entry& entry) {
+  Node* node = &mRoot;
+  for (uint8_t octet : entry.aid) {
+    std::unique_ptr<Node>& child = node->children[octet];
+    if (!child) child.reset(new Node());
+    node = child.get();
+  }
+  node->hasEntry = true;
+  node->entry = entry;
+}
+
+/*******************************************************************************
+**
+** Function:        remove
+**
+** Description:     Unregister an AID. An AID that was never registered is
+**                  still removed from the controller by the next diff().
+**                  aid: AID.
+**                  aidLen: Length of the AID.
+**
+** Returns:         True if the AID was registered.
+**
+*******************************************************************************/
+bool AidRoutingPlanner::remove(const uint8_t* aid, size_t aidLen) {
+  if (removeFrom(&mRoot, aid, aidLen)) return true;
+  mUnregisteredRemoves.insert(std::vector<uint8_t>(aid, aid + aidLen));
+  return false;
+}
+
+bool AidRoutingPlanner::removeFrom(Node* node, const uint8_t* aid,
+                                   size_t aidLen) {
+  if (aidLen == 0) {
+    if (!node->hasEntry) return false;
+    node->hasEntry = false;
+    return true;
+  }
+  auto it = node->children.find(aid[0]);
+  if (it == node->children.end()) return false;
+  if (!removeFrom(it->second.get(), aid + 1, aidLen - 1)) return false;
+  // drop the branch once nothing is registered below it
+  if (!it->second->hasEntry && it->second->children.empty())
+    node->children.erase(it);
+  return true;
+}
+
+/*******************************************************************************
+**
+** Function:        clear
+**
+** Description:     Forget all AIDs, including those in the controller.
+**
+** Returns:         None
+**
+*******************************************************************************/
+void AidRoutingPlanner::clear() {
+  mRoot.children.clear();
+  mRoot.hasEntry = false;
+  mProgrammed.clear();
+  mUnregisteredRemoves.clear();
+}
+
+void AidRoutingPlanner::Coverage::merge(const Entry& entry, bool mergeable) {
+  if (!mergeable) {
+    state = MIXED;
+  } else if (state == NONE) {
+    state = SAME;
+    route = entry.route;
+    power = entry.power;
+  } else if ((state == SAME) &&
+             ((route != entry.route) || (power != entry.power))) {
+    state = MIXED;
+  }
+}
+
+void AidRoutingPlanner::Coverage::merge(const Coverage& other) {
+  if (other.state == NONE) return;
+  if ((other.state == MIXED) || (state == MIXED)) {
+    state = MIXED;
+  } else if (state == NONE) {
+    *this = other;
+  } else if ((route != other.route) || (power != other.power)) {
+    state = MIXED;
+  }
+}
+
+bool AidRoutingPlanner::Coverage::isOnly(const Entry& entry) const {
+  return (state == SAME) && (route == entry.route) && (power == entry.power);
+}
+
+bool AidRoutingPlanner::isMergeable(const Entry& entry) {
+  // blocked and subset entries are never folded into a prefix
+  return (entry.aidInfo & ~AID_INFO_PREFIX) == 0;
+}
+
+bool AidRoutingPlanner::isMatchedAsPrefix(const Entry& entry) {
+  return mPrefixOnly ||
+         (mPrefixSupported && (entry.aidInfo & AID_INFO_PREFIX));
+}
+
+/*******************************************************************************
+**
+** Function:        collect
+**
+** Description:     Append the entries of a subtree that must be programmed.
+**                  An entry is left out when every prefix entry above it and
+**                  every entry below it has its route and power state, and
+**                  at least one prefix entry is above it: whichever of them
+**                  the controller matches first, the result is the same.
+**                  node: Root of the subtree.
+**                  ancestors: Routes of the prefix entries above node.
+**                  table: Receives the entries, longer AIDs first.
+**
+** Returns:         Routes of all entries of the subtree.
+**
+*******************************************************************************/
+AidRoutingPlanner::Coverage AidRoutingPlanner::collect(
+    Node* node, const Coverage& ancestors, std::vector<Entry>& table) {
+  Coverage below;
+  Coverage childAncestors = ancestors;
+  // the empty AID is the default route; it never covers other entries
+  bool isEntry = node->hasEntry && !node->entry.aid.empty();
+  if (isEntry && isMatchedAsPrefix(node->entry))
+    childAncestors.merge(node->entry, isMergeable(node->entry));
+
+  for (auto& child : node->children)
+    below.merge(collect(child.second.get(), childAncestors, table));
+
+  if (node->hasEntry) {
+    const Entry& entry = node->entry;
+    bool covered = isEntry && mPrefixSupported && isMergeable(entry) &&
+                   ancestors.isOnly(entry) &&
+                   ((below.state == Coverage::NONE) || below.isOnly(entry));
+    if (!covered) table.push_back(entry);
+    below.merge(entry, isMergeable(entry));
+  }
+  return below;
+}
+
+/*******************************************************************************
+**
+** Function:        getTable
+**
+** Description:     Get the entries to program: registered AIDs without
+**                  those covered by prefix entries. Longer AIDs come first.
+**                  table: Receives the entries.
+**
+** Returns:         None
+**
+*******************************************************************************/
+void AidRoutingPlanner::getTable(std::vector<Entry>& table) {
+  table.clear();
+  collect(&mRoot, Coverage(), table);
+}
+
+/*******************************************************************************
+**
+** Function:        resolve
+**
+** Description:     Find the entry routing a SELECT command: an exact entry
+**                  first, then the longest prefix entry, then a subset
+**                  entry, then the empty AID. Takes O(aidLen) unless only
+**                  a subset entry can match.
+**                  aid: AID of the SELECT command.
+**                  aidLen: Length of the AID.
+**                  winner: Receives the entry.
+**
+** Returns:         True if an entry routes the AID; false if none matches
+**                  or the matching entry is blocked.
+**
+*******************************************************************************/
+bool AidRoutingPlanner::resolve(const uint8_t* aid, size_t aidLen,
+                                Entry& winner) {
+  const Node* node = &mRoot;
+  const Entry* best = NULL;
+
+  for (size_t i = 0; (node != NULL) && (i < aidLen); i++) {
+    // the empty AID at the root only routes what nothing else matches
+    if ((i > 0) && node->hasEntry && isMatchedAsPrefix(node->entry))
+      best = &node->entry;
+    auto it = node->children.find(aid[i]);
+    node = (it != node->children.end()) ? it->second.get() : NULL;
+  }
+  if ((node != NULL) && node->hasEntry) {
+    best = &node->entry;
+  } else if ((best == NULL) && (node != NULL)) {
+    node = findSubset(node);
+    if (node != NULL) best = &node->entry;
+  }
+  if ((best == NULL) && mRoot.hasEntry) best = &mRoot.entry;
+
+  if ((best == NULL) || (best->aidInfo & AID_INFO_BLOCKED)) return false;
+  winner = *best;
+  return true;
+}
+
+const AidRoutingPlanner::Node* AidRoutingPlanner::findSubset(
+    const Node* node) {
+  if (node->hasEntry && (node->entry.aidInfo & AID_INFO_SUBSET)) return node;
+  for (auto& child : node->children) {
+    const Node* found = findSubset(child.second.get());
+    if (found != NULL) return found;
+  }
+  return NULL;
+}
+
+/*******************************************************************************
+**
+** Function:        getConflicts
+**
+** Description:     Get the registered entries overlapping an entry with a
+**                  different route or power state, i.e. entries a
+**                  SELECT command can match together with it.
+**                  entry: Entry to check; need not be registered.
+**                  conflicts: Receives the entries.
+**
+** Returns:         None
+**
+*******************************************************************************/
+void AidRoutingPlanner::getConflicts(const Entry& entry,
+                                     std::vector<Entry>& conflicts) {
+  const Node* node = &mRoot;
+
+  conflicts.clear();
+  if (entry.aid.empty()) return;
+  // shorter prefix entries match the SELECT commands of the entry; a subset
+  // entry also matches SELECT commands of every shorter entry
+  bool isSubset = entry.aidInfo & AID_INFO_SUBSET;
+  for (size_t i = 0; i < entry.aid.size(); i++) {
+    if ((i > 0) && node->hasEntry &&
+        (isSubset || isMatchedAsPrefix(node->entry)) &&
+        ((node->entry.route != entry.route) ||
+         (node->entry.power != entry.power)))
+      conflicts.push_back(node->entry);
+    auto it = node->children.find(entry.aid[i]);
+    if (it == node->children.end()) return;
+    node = it->second.get();
+  }
+  // longer entries match the entry's SELECT commands if it is a prefix
+  // entry; longer subset entries match them in any case
+  for (auto& child : node->children)
+    collectConflicts(child.second.get(), entry, isMatchedAsPrefix(entry),
+                     conflicts);
+}
+
+void AidRoutingPlanner::collectConflicts(const Node* node, const Entry& entry,
+                                         bool all,
+                                         std::vector<Entry>& conflicts) {
+  if (node->hasEntry && (all || (node->entry.aidInfo & AID_INFO_SUBSET)) &&
+      ((node->entry.route != entry.route) ||
+       (node->entry.power != entry.power)))
+    conflicts.push_back(node->entry);
+  for (auto& child : node->children)
+    collectConflicts(child.second.get(), entry, all, conflicts);
+}
+
+/*******************************************************************************
+**
+** Function:        diff
+**
+** Description:     Compute the requests bringing the controller from the
+**                  last programmed table to getTable(), and take the new
+**                  table as programmed.
+**                  removes: Receives the entries to remove.
+**                  adds: Receives the entries to add or update.
+**
+** Returns:         None
+**
+*******************************************************************************/
+void AidRoutingPlanner::diff(std::vector<Entry>& removes,
+                             std::vector<Entry>& adds) {
+  std::vector<Entry> table;
+  std::map<std::vector<uint8_t>, Entry> desired;
+
+  getTable(table);
+  removes.clear();
+  adds.clear();
+  for (const Entry& entry : table) {
+    auto it = mProgrammed.find(entry.aid);
+    if ((it == mProgrammed.end()) || (it->second.route != entry.route) ||
+        (it->second.power != entry.power) ||
+        (it->second.aidInfo != entry.aidInfo))
+      adds.push_back(entry);
+    desired[entry.aid] = entry;
+  }
+  for (auto& programmed : mProgrammed) {
+    if (desired.count(programmed.first) == 0)
+      removes.push_back(programmed.second);
+  }
+  for (const std::vector<uint8_t>& aid : mUnregisteredRemoves) {
+    if ((desired.count(aid) == 0) && (mProgrammed.count(aid) == 0))
+      removes.push_back(Entry{aid, 0, 0, 0});
+  }
+  mUnregisteredRemoves.clear();
+  mProgrammed.swap(desired);
+}
+
+/*******************************************************************************
+**
+** Function:        hasChanges
+**
+** Description:     Whether diff() would return any request.
+**
+** Returns:         True if getTable() differs from the programmed table.
+**
+*******************************************************************************/
+bool AidRoutingPlanner::hasChanges() {
+  std::vector<Entry> table;
+  std::set<std::vector<uint8_t>> desired;
+
+  getTable(table);
+  for (const Entry& entry : table) {
+    auto it = mProgrammed.find(entry.aid);
+    if ((it == mProgrammed.end()) || (it->second.route != entry.route) ||
+        (it->second.power != entry.power) ||
+        (it->second.aidInfo != entry.aidInfo))
+      return true;
+    desired.insert(entry.aid);
+  }
+  // every desired AID is programmed; anything else programmed is removed
+  if (desired.size() != mProgrammed.size()) return true;
+  for (const std::vector<uint8_t>& aid : mUnregisteredRemoves) {
+    if (desired.count(aid) == 0) return true;
+  }
+  return false;
+}
+
+/*******************************************************************************
+**
+** Function:        forgetProgrammed
+**
+** Description:     Assume nothing is known to be programmed, after a failed
+**                  request: the next diff() adds every entry again and
+**                  removes every AID that may be left over.
+**                  removes: Entries of the failed diff() to remove.
+**
+** Returns:         None
+**
+*******************************************************************************/
+void AidRoutingPlanner::forgetProgrammed(const std::vector<Entry>& removes) {
+  for (auto& programmed : mProgrammed)
+    mUnregisteredRemoves.insert(programmed.first);
+  for (const Entry& entry : removes) mUnregisteredRemoves.insert(entry.aid);
+  mProgrammed.clear();
+}
+
+/*******************************************************************************
+**
+** Function:        getTableSize
+**
+** Description:     Get the size of AID entries in the routing table.
+**                  table: Entries.
+**
+** Returns:         Size in octets.
+**
+*******************************************************************************/
+size_t AidRoutingPlanner::getTableSize(const std::vector<Entry>& table) {
+  size_t size = 0;
+  for (const Entry& entry : table) size += TLV_HEADER_LEN + entry.aid.size();
+  return size;
+}
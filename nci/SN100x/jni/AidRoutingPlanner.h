@@ -0,0 +1,239 @@
+/******************************************************************************
+ *
+ *  Copyright 2024 NXP
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/*
+ *  Plan the AID entries of the listen mode routing table. Registered AIDs
+ *  are kept in a trie; an entry is left out of the table when prefix
+ *  entries with the same route and power state already select every AID
+ *  it would, so that more AIDs fit in the controller.
+ */
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <map>
+#include <memory>
+#include <set>
+#include <vector>
+
+class AidRoutingPlanner {
+ public:
+  static const int AID_INFO_PREFIX = 0x10;  // prefix qualifier of aidInfo
+  static const int AID_INFO_SUBSET = 0x20;  // subset qualifier of aidInfo
+  static const int AID_INFO_BLOCKED = 0x40;  // blocked qualifier of aidInfo
+  static const size_t TLV_HEADER_LEN = 4;   // type, length, route, power
+
+  struct Entry {
+    std::vector<uint8_t> aid;
+    int route;
+    uint8_t power;
+    int aidInfo;
+  };
+
+  /*******************************************************************************
+  **
+  ** Function:        AidRoutingPlanner
+  **
+  ** Description:     Initialize member variables.
+  **
+  ** Returns:         None
+  **
+  *******************************************************************************/
+  AidRoutingPlanner();
+
+  /*******************************************************************************
+  **
+  ** Function:        setMatching
+  **
+  ** Description:     Set how the controller matches AID entries.
+  **                  prefixSupported: Entries can be matched as prefix.
+  **                  prefixOnly: Every entry is matched as prefix.
+  **
+  ** Returns:         None
+  **
+  *******************************************************************************/
+  void setMatching(bool prefixSupported, bool prefixOnly);
+
+  /*******************************************************************************
+  **
+  ** Function:        add
+  **
+  ** Description:     Register an AID, or replace its route.
+  **                  entry: AID entry.
+  **
+  ** Returns:         None
+  **
+  *******************************************************************************/
+  void add(const Entry& entry);
+
+  /*******************************************************************************
+  **
+  ** Function:        remove
+  **
+  ** Description:     Unregister an AID. An AID that was never registered is
+  **                  still removed from the controller by the next diff().
+  **                  aid: AID.
+  **                  aidLen: Length of the AID.
+  **
+  ** Returns:         True if the AID was registered.
+  **
+  *******************************************************************************/
+  bool remove(const uint8_t* aid, size_t aidLen);
+
+  /*******************************************************************************
+  **
+  ** Function:        clear
+  **
+  ** Description:     Forget all AIDs, including those in the controller.
+  **
+  ** Returns:         None
+  **
+  *******************************************************************************/
+  void clear();
+
+  /*******************************************************************************
+  **
+  ** Function:        getTable
+  **
+  ** Description:     Get the entries to program: registered AIDs without
+  **                  those covered by prefix entries. Longer AIDs come first.
+  **                  table: Receives the entries.
+  **
+  ** Returns:         None
+  **
+  *******************************************************************************/
+  void getTable(std::vector<Entry>& table);
+
+  /*******************************************************************************
+  **
+  ** Function:        resolve
+  **
+  ** Description:     Find the entry routing a SELECT command: an exact entry
+  **                  first, then the longest prefix entry, then a subset
+  **                  entry, then the empty AID. Takes O(aidLen) unless only
+  **                  a subset entry can match.
+  **                  aid: AID of the SELECT command.
+  **                  aidLen: Length of the AID.
+  **                  winner: Receives the entry.
+  **
+  ** Returns:         True if an entry routes the AID; false if none matches
+  **                  or the matching entry is blocked.
+  **
+  *******************************************************************************/
+  bool resolve(const uint8_t* aid, size_t aidLen, Entry& winner);
+
+  /*******************************************************************************
+  **
+  ** Function:        getConflicts
+  **
+  ** Description:     Get the registered entries overlapping an entry with a
+  **                  different route or power state, i.e. entries a
+  **                  SELECT command can match together with it.
+  **                  entry: Entry to check; need not be registered.
+  **                  conflicts: Receives the entries.
+  **
+  ** Returns:         None
+  **
+  *******************************************************************************/
+  void getConflicts(const Entry& entry, std::vector<Entry>& conflicts);
+
+  /*******************************************************************************
+  **
+  ** Function:        diff
+  **
+  ** Description:     Compute the requests bringing the controller from the
+  **                  last programmed table to getTable(), and take the new
+  **                  table as programmed.
+  **                  removes: Receives the entries to remove.
+  **                  adds: Receives the entries to add or update.
+  **
+  ** Returns:         None
+  **
+  *******************************************************************************/
+  void diff(std::vector<Entry>& removes, std::vector<Entry>& adds);
+
+  /*******************************************************************************
+  **
+  ** Function:        hasChanges
+  **
+  ** Description:     Whether diff() would return any request.
+  **
+  ** Returns:         True if getTable() differs from the programmed table.
+  **
+  *******************************************************************************/
+  bool hasChanges();
+
+  /*******************************************************************************
+  **
+  ** Function:        forgetProgrammed
+  **
+  ** Description:     Assume nothing is known to be programmed, after a failed
+  **                  request: the next diff() adds every entry again and
+  **                  removes every AID that may be left over.
+  **                  removes: Entries of the failed diff() to remove.
+  **
+  ** Returns:         None
+  **
+  *******************************************************************************/
+  void forgetProgrammed(const std::vector<Entry>& removes);
+
+  /*******************************************************************************
+  **
+  ** Function:        getTableSize
+  **
+  ** Description:     Get the size of AID entries in the routing table.
+  **                  table: Entries.
+  **
+  ** Returns:         Size in octets.
+  **
+  *******************************************************************************/
+  static size_t getTableSize(const std::vector<Entry>& table);
+
+ private:
+  struct Node {
+    std::map<uint8_t, std::unique_ptr<Node>> children;
+    bool hasEntry;
+    Entry entry;
+    Node() : hasEntry(false) {}
+  };
+
+  // routes selecting some AIDs: none, all the same one, or different ones
+  struct Coverage {
+    enum { NONE, SAME, MIXED } state;
+    int route;
+    uint8_t power;
+    Coverage() : state(NONE), route(0), power(0) {}
+    void merge(const Entry& entry, bool mergeable);
+    void merge(const Coverage& other);
+    bool isOnly(const Entry& entry) const;
+  };
+
+  bool isMergeable(const Entry& entry);
+  bool isMatchedAsPrefix(const Entry& entry);
+  Coverage collect(Node* node, const Coverage& ancestors,
+                   std::vector<Entry>& table);
+  bool removeFrom(Node* node, const uint8_t* aid, size_t aidLen);
+  const Node* findSubset(const Node* node);
+  void collectConflicts(const Node* node, const Entry& entry, bool all,
+                        std::vector<Entry>& conflicts);
+
+  bool mPrefixSupported;
+  bool mPrefixOnly;
+  Node mRoot;
+  std::map<std::vector<uint8_t>, Entry> mProgrammed;
+  std::set<std::vector<uint8_t>> mUnregisteredRemoves;
+};
@@ -0,0 +1,109 @@
+#include <gtest/gtest.h>
+
+#include "AidRoutingPlanner.h"
+
+namespace {
+AidRoutingPlanner::Entry makeEntry(std::vector<uint8_t> aid, int route,
+                                   int aidInfo) {
+  return AidRoutingPlanner::Entry{aid, route, 0x3B, aidInfo};
+}
+}  // namespace
+
+TEST(AidRoutingPlannerTest, PrefixCoversSameRoute) {
+  AidRoutingPlanner planner;
+  std::vector<AidRoutingPlanner::Entry> table;
+
+  planner.setMatching(true, false);
+  planner.add(makeEntry({0xA0, 0x00, 0x01}, 0x400, 0x10));
+  planner.add(makeEntry({0xA0, 0x00, 0x01, 0x02}, 0x400, 0x00));
+  planner.add(makeEntry({0xA0, 0x00, 0x01, 0x03}, 0xC0, 0x00));
+  planner.getTable(table);
+
+  ASSERT_EQ(2u, table.size());
+  EXPECT_EQ(0xC0, table[0].route);
+  EXPECT_EQ(3u, table[1].aid.size());
+  EXPECT_EQ(4u + 4u + 4u + 3u, AidRoutingPlanner::getTableSize(table));
+}
+
+TEST(AidRoutingPlannerTest, ExactMatchingKeepsAllEntries) {
+  AidRoutingPlanner planner;
+  std::vector<AidRoutingPlanner::Entry> table;
+
+  planner.setMatching(false, false);
+  planner.add(makeEntry({0xA0, 0x00, 0x01}, 0x400, 0x10));
+  planner.add(makeEntry({0xA0, 0x00, 0x01, 0x02}, 0x400, 0x00));
+  planner.getTable(table);
+
+  EXPECT_EQ(2u, table.size());
+}
+
+TEST(AidRoutingPlannerTest, DiffSendsOnlyChanges) {
+  AidRoutingPlanner planner;
+  std::vector<AidRoutingPlanner::Entry> removes, adds;
+  uint8_t prefix[] = {0xA0, 0x00, 0x01};
+
+  planner.setMatching(true, false);
+  planner.add(makeEntry({0xA0, 0x00, 0x01}, 0x400, 0x10));
+  planner.add(makeEntry({0xA0, 0x00, 0x01, 0x02}, 0x400, 0x00));
+  planner.diff(removes, adds);
+  EXPECT_EQ(0u, removes.size());
+  ASSERT_EQ(1u, adds.size());
+
+  // without the prefix the longer AID must be programmed on its own
+  EXPECT_TRUE(planner.remove(prefix, sizeof(prefix)));
+  planner.diff(removes, adds);
+  ASSERT_EQ(1u, removes.size());
+  EXPECT_EQ(3u, removes[0].aid.size());
+  ASSERT_EQ(1u, adds.size());
+  EXPECT_EQ(4u, adds[0].aid.size());
+
+  planner.diff(removes, adds);
+  EXPECT_EQ(0u, removes.size());
+  EXPECT_EQ(0u, adds.size());
+}
+
+TEST(AidRoutingPlannerTest, ReRoutingSameAidsHasNoChanges) {
+  AidRoutingPlanner planner;
+  std::vector<AidRoutingPlanner::Entry> removes, adds;
+  uint8_t aid[] = {0xA0, 0x00, 0x02};
+
+  planner.setMatching(true, false);
+  planner.add(makeEntry({0xA0, 0x00, 0x02}, 0xC0, 0x00));
+  planner.diff(removes, adds);
+  EXPECT_FALSE(planner.hasChanges());
+
+  planner.remove(aid, sizeof(aid));
+  EXPECT_TRUE(planner.hasChanges());
+  planner.add(makeEntry({0xA0, 0x00, 0x02}, 0xC0, 0x00));
+  EXPECT_FALSE(planner.hasChanges());
+  planner.diff(removes, adds);
+  EXPECT_EQ(0u, removes.size());
+  EXPECT_EQ(0u, adds.size());
+}
+
+TEST(AidRoutingPlannerTest, ResolvePrefersExactThenLongestPrefix) {
+  AidRoutingPlanner planner;
+  AidRoutingPlanner::Entry winner;
+  std::vector<AidRoutingPlanner::Entry> conflicts;
+  uint8_t exact[] = {0xA0, 0x00, 0x01, 0x02};
+  uint8_t longer[] = {0xA0, 0x00, 0x01, 0x03, 0x04};
+  uint8_t other[] = {0xB0, 0x00};
+
+  planner.setMatching(true, false);
+  planner.add(makeEntry({}, 0x400, 0x10));
+  planner.add(makeEntry({0xA0, 0x00}, 0xC0, 0x10));
+  planner.add(makeEntry({0xA0, 0x00, 0x01}, 0xC1, 0x10));
+  planner.add(makeEntry({0xA0, 0x00, 0x01, 0x02}, 0xC2, 0x00));
+
+  ASSERT_TRUE(planner.resolve(exact, sizeof(exact), winner));
+  EXPECT_EQ(0xC2, winner.route);
+  ASSERT_TRUE(planner.resolve(longer, sizeof(longer), winner));
+  EXPECT_EQ(0xC1, winner.route);
+  ASSERT_TRUE(planner.resolve(other, sizeof(other), winner));
+  EXPECT_EQ(0x400, winner.route);
+
+  planner.getConflicts(makeEntry({0xA0, 0x00, 0x01}, 0xC1, 0x10), conflicts);
+  ASSERT_EQ(2u, conflicts.size());
+  EXPECT_EQ(0xC0, conflicts[0].route);
+  EXPECT_EQ(0xC2, conflicts[1].route);
+}
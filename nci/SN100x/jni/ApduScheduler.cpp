@@ -0,0 +1,117 @@
+/******************************************************************************
+ *
+ *  Copyright 2024 NXP
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/*
+ *  Schedule wired mode APDUs.
+ */
+#include "ApduScheduler.h"
+
+#include <android-base/stringprintf.h>
+#include <base/logging.h>
+
+using android::base::StringPrintf;
+
+extern bool nfc_debug_enabled;
+
+/*******************************************************************************
+**
+** Function:        ApduScheduler
+**
+** Description:     Initialize member variables.
+**
+** Returns:         None
+**
+*******************************************************************************/
+ApduScheduler::ApduScheduler() : mBusy(false), mNextTicket(1), mGranted(0) {}
+
+/*******************************************************************************
+**
+** Function:        acquire
+**
+** Description:     Wait for the turn of a channel to send an APDU. Turns
+**                  go round robin among channels with waiting APDUs, and
+**                  in order of arrival within a channel.
+**                  eeHandle: Handle of the secure element.
+**                  channel: Logical channel of the APDU.
+**
+** Returns:         None
+**
+*******************************************************************************/
+void ApduScheduler::acquire(uint16_t eeHandle, uint8_t channel) {
+  uint32_t key = ((uint32_t)eeHandle << 8) | channel;
+  AutoMutex lock(mMutex);
+  uint64_t ticket = mNextTicket++;
+  std::deque<uint64_t>& queue = mQueues[key];
+  if (queue.empty()) mRing.push_back(key);
+  queue.push_back(ticket);
+
+  if (!mBusy) grantNext();
+  if (mGranted != ticket) {
+    DLOG_IF(INFO, nfc_debug_enabled) << StringPrintf(
+        "%s: ee=0x%X; channel=%u; waiting", __func__, eeHandle, channel);
+    while (mGranted != ticket) mCondVar.wait(mMutex);
+  }
+}
+
+/*******************************************************************************
+**
+** Function:        release
+**
+** Description:     End the current turn, once the response is consumed.
+**
+** Returns:         None
+**
+*******************************************************************************/
+void ApduScheduler::release() {
+  AutoMutex lock(mMutex);
+  mBusy = false;
+  grantNext();
+}
+
+/*******************************************************************************
+**
+** Function:        getLogicalChannel
+**
+** Description:     Get the logical channel of a command APDU from its class
+**                  byte, as in ISO/IEC 7816-4.
+**                  cla: Class byte.
+**
+** Returns:         Logical channel, 0 to 19.
+**
+*******************************************************************************/
+uint8_t ApduScheduler::getLogicalChannel(uint8_t cla) {
+  // further interindustry class: channels 4 to 19
+  if (cla & 0x40) return 4 + (cla & 0x0F);
+  return cla & 0x03;
+}
+
+// caller must hold mMutex
+void ApduScheduler::grantNext() {
+  if (mRing.empty()) return;
+  uint32_t key = mRing.front();
+  mRing.pop_front();
+  std::deque<uint64_t>& queue = mQueues[key];
+  mGranted = queue.front();
+  queue.pop_front();
+  if (queue.empty())
+    mQueues.erase(key);
+  else
+    mRing.push_back(key);
+  mBusy = true;
+  mCondVar.notifyAll();
+}
@@ -0,0 +1,109 @@
+/******************************************************************************
+ *
+ *  Copyright 2024 NXP
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/*
+ *  Schedule wired mode APDUs. NFA has one APDU in flight at a time, so
+ *  APDUs still go one by one; but they queue per secure element and
+ *  logical channel, and the queues take turns. A client sending a long
+ *  series of APDUs on one channel then no longer holds off the clients of
+ *  other channels or secure elements until it is done.
+ */
+#pragma once
+#include <stdint.h>
+#include <deque>
+#include <list>
+#include <map>
+#include "CondVar.h"
+#include "Mutex.h"
+
+class ApduScheduler {
+ public:
+  // The caller's turn to send an APDU, from construction to destruction.
+  class Turn {
+   public:
+    Turn(ApduScheduler& scheduler, uint16_t eeHandle, uint8_t channel)
+        : mScheduler(scheduler) {
+      mScheduler.acquire(eeHandle, channel);
+    }
+    ~Turn() { mScheduler.release(); }
+
+   private:
+    ApduScheduler& mScheduler;
+  };
+
+  /*******************************************************************************
+  **
+  ** Function:        ApduScheduler
+  **
+  ** Description:     Initialize member variables.
+  **
+  ** Returns:         None
+  **
+  *******************************************************************************/
+  ApduScheduler();
+
+  /*******************************************************************************
+  **
+  ** Function:        acquire
+  **
+  ** Description:     Wait for the turn of a channel to send an APDU. Turns
+  **                  go round robin among channels with waiting APDUs, and
+  **                  in order of arrival within a channel.
+  **                  eeHandle: Handle of the secure element.
+  **                  channel: Logical channel of the APDU.
+  **
+  ** Returns:         None
+  **
+  *******************************************************************************/
+  void acquire(uint16_t eeHandle, uint8_t channel);
+
+  /*******************************************************************************
+  **
+  ** Function:        release
+  **
+  ** Description:     End the current turn, once the response is consumed.
+  **
+  ** Returns:         None
+  **
+  *******************************************************************************/
+  void release();
+
+  /*******************************************************************************
+  **
+  ** Function:        getLogicalChannel
+  **
+  ** Description:     Get the logical channel of a command APDU from its class
+  **                  byte, as in ISO/IEC 7816-4.
+  **                  cla: Class byte.
+  **
+  ** Returns:         Logical channel, 0 to 19.
+  **
+  *******************************************************************************/
+  static uint8_t getLogicalChannel(uint8_t cla);
+
+ private:
+  void grantNext();
+
+  Mutex mMutex;  // guards the members below
+  CondVar mCondVar;
+  bool mBusy;
+  uint64_t mNextTicket;
+  uint64_t mGranted;
+  std::map<uint32_t, std::deque<uint64_t>> mQueues;  // tickets per channel
+  std::list<uint32_t> mRing;  // channels with waiting APDUs, next one first
+};
@@ -0,0 +1,20 @@
+#include <benchmark/benchmark.h>
+
+#include "ApduScheduler.h"
+
+namespace {
+ApduScheduler sScheduler;
+
+// one turn per wired mode APDU; with several threads, each on its own
+// logical channel, turns go round robin between them
+void BM_ApduSchedulerTurn(benchmark::State& state) {
+  uint8_t channel = state.thread_index();
+  for (auto _ : state) {
+    ApduScheduler::Turn turn(sScheduler, 0x4C0, channel);
+    benchmark::ClobberMemory();
+  }
+}
+BENCHMARK(BM_ApduSchedulerTurn)->Threads(1)->Threads(4)->UseRealTime();
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,41 @@
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ApduScheduler.h"
+
+TEST(ApduSchedulerTest, ChannelsTakeTurns) {
+  ApduScheduler scheduler;
+  Mutex mutex;
+  std::string order;
+  std::vector<std::thread> clients;
+
+  scheduler.acquire(0x4C0, 0);
+  auto client = [&](uint16_t ee, uint8_t channel, char name) {
+    ApduScheduler::Turn turn(scheduler, ee, channel);
+    AutoMutex lock(mutex);
+    order += name;
+  };
+  // queued in this order while the first APDU is in flight
+  clients.push_back(std::thread(client, 0x4C0, 0, 'a'));
+  usleep(10000);
+  clients.push_back(std::thread(client, 0x4C0, 0, 'b'));
+  usleep(10000);
+  clients.push_back(std::thread(client, 0x4C0, 1, 'c'));
+  usleep(10000);
+  clients.push_back(std::thread(client, 0x4C1, 0, 'd'));
+  usleep(10000);
+  scheduler.release();
+  for (std::thread& c : clients) c.join();
+
+  EXPECT_EQ("acdb", order);
+}
+
+TEST(ApduSchedulerTest, LogicalChannelFromClass) {
+  EXPECT_EQ(0, ApduScheduler::getLogicalChannel(0x00));
+  EXPECT_EQ(3, ApduScheduler::getLogicalChannel(0x83));
+  EXPECT_EQ(4, ApduScheduler::getLogicalChannel(0x40));
+  EXPECT_EQ(19, ApduScheduler::getLogicalChannel(0xCF));
+}
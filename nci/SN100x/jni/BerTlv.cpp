@@ -0,0 +1,132 @@
+/******************************************************************************
+ *
+ *  Copyright 2024 NXP
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+
+/*
+ *  Decode BER-TLV.
+ */
+#include "BerTlv.h"
+
+// tag number in subsequent octets
+static const uint8_t TAG_NUMBER_MASK = 0x1F;
+// subsequent tag octet is followed by another
+static const uint8_t TAG_MORE = 0x80;
+static const uint8_t TAG_CONSTRUCTED = 0x20;
+// tags of up to four octets fit mTag
+static const size_t MAX_TAG_LEN = 4;
+// 0x84: four octets of length
+static const size_t MAX_LENGTH_OCTETS = 4;
+
+bool BerTlv::isConstructed() const {
+  uint32_t first = mTag;
+  while (first > 0xFF) first >>= 8;
+  return (first & TAG_CONSTRUCTED) != 0;
+}
+
+/*******************************************************************************
+**
+** Function:        parse
+**
+** Description:     Parse the TLV at the start of a buffer.
+**                  buf: Buffer.
+**                  bufLen: Length of the buffer.
+**                  tlv: Receives the TLV.
+**
+** Returns:         False if the TLV is malformed or does not fit.
+**
+*******************************************************************************/
+bool BerTlv::parse(const uint8_t* buf, size_t bufLen, BerTlv& tlv) {
+  if (buf == nullptr || bufLen == 0) return false;
+
+  size_t pos = 0;
+  uint32_t tag = buf[pos++];
+  if ((tag & TAG_NUMBER_MASK) == TAG_NUMBER_MASK) {
+    uint8_t octet;
+    do {
+      if (pos >= bufLen || pos >= MAX_TAG_LEN) return false;
+      octet = buf[pos++];
+      tag = (tag << 8) | octet;
+    } while (octet & TAG_MORE);
+  }
+
+  size_t length = 0;
+  size_t fieldLen = 0;
+  if (!decodeLength(buf + pos, bufLen - pos, length, fieldLen)) return false;
+  pos += fieldLen;
+  if (length > bufLen - pos) return false;
+
+  tlv.mTag = tag;
+  tlv.mValue = buf + pos;
+  tlv.mLength = length;
+  tlv.mSize = pos + length;
+  return true;
+}
+
+/*******************************************************************************
+**
+** Function:        decodeLength
+**
+** Description:     Decode a length field: one octet below 0x80, or 0x81
+**                  to 0x84 followed by that many octets of length.
+**                  buf: Buffer starting with the length field.
+**                  bufLen: Length of the buffer.
+**                  length: Receives the length.
+**                  fieldLen: Receives the length of the field itself.
+**
+** Returns:         False if the field is malformed or does not fit.
+**
+*******************************************************************************/
+bool BerTlv::decodeLength(const uint8_t* buf, size_t bufLen, size_t& length,
+                          size_t& fieldLen) {
+  if (buf == nullptr || bufLen == 0) return false;
+
+  if (buf[0] < 0x80) {
+    length = buf[0];
+    fieldLen = 1;
+    return true;
+  }
+  // 0x80 is the indefinite form, which is not used here
+  size_t octets = buf[0] & 0x7F;
+  if (octets == 0 || octets > MAX_LENGTH_OCTETS || octets >= bufLen) {
+    return false;
+  }
+  length = 0;
+  for (size_t i = 1; i <= octets; i++) length = (length << 8) | buf[i];
+  fieldLen = 1 + octets;
+  return true;
+}
+
+/*******************************************************************************
+**
+** Function:        next
+**
+** Description:     Parse the next TLV.
+**                  tlv: Receives the TLV.
+**
+** Returns:         False at the end, or at the first malformed TLV.
+**
+*******************************************************************************/
+bool BerTlvReader::next(BerTlv& tlv) {
+  if (mMalformed || mPos == mEnd) return false;
+  if (!BerTlv::parse(mPos, mEnd - mPos, tlv)) {
+    mMalformed = true;
+    return false;
+  }
+  mPos += tlv.size();
+  return true;
+}
@@ -0,0 +1,109 @@
+/******************************************************************************
+ *
+ *  Copyright 2024 NXP
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+
+/*
+ *  Decode BER-TLV, as in ISO/IEC 7816-4, without copying: a BerTlv points
+ *  into the buffer it was parsed from, which must outlive it. Every read is
+ *  checked against the end of the buffer, so malformed or truncated input
+ *  is reported rather than read past.
+ */
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+class BerTlv {
+ public:
+  BerTlv() : mTag(0), mValue(nullptr), mLength(0), mSize(0) {}
+
+  uint32_t tag() const { return mTag; }
+  const uint8_t* value() const { return mValue; }
+  size_t length() const { return mLength; }
+  // octets of tag, length and value
+  size_t size() const { return mSize; }
+  // whether the value is itself a series of TLVs
+  bool isConstructed() const;
+
+  /*******************************************************************************
+  **
+  ** Function:        parse
+  **
+  ** Description:     Parse the TLV at the start of a buffer.
+  **                  buf: Buffer.
+  **                  bufLen: Length of the buffer.
+  **                  tlv: Receives the TLV.
+  **
+  ** Returns:         False if the TLV is malformed or does not fit.
+  **
+  *******************************************************************************/
+  static bool parse(const uint8_t* buf, size_t bufLen, BerTlv& tlv);
+
+  /*******************************************************************************
+  **
+  ** Function:        decodeLength
+  **
+  ** Description:     Decode a length field: one octet below 0x80, or 0x81
+  **                  to 0x84 followed by that many octets of length.
+  **                  buf: Buffer starting with the length field.
+  **                  bufLen: Length of the buffer.
+  **                  length: Receives the length.
+  **                  fieldLen: Receives the length of the field itself.
+  **
+  ** Returns:         False if the field is malformed or does not fit.
+  **
+  *******************************************************************************/
+  static bool decodeLength(const uint8_t* buf, size_t bufLen, size_t& length,
+                           size_t& fieldLen);
+
+ private:
+  uint32_t mTag;  // tag octets, first octet most significant
+  const uint8_t* mValue;
+  size_t mLength;
+  size_t mSize;
+};
+
+// Walk a series of TLVs, such as the value of a constructed TLV.
+class BerTlvReader {
+ public:
+  BerTlvReader(const uint8_t* buf, size_t bufLen)
+      : mPos(buf), mEnd(buf + bufLen), mMalformed(false) {}
+  explicit BerTlvReader(const BerTlv& constructed)
+      : BerTlvReader(constructed.value(), constructed.length()) {}
+
+  /*******************************************************************************
+  **
+  ** Function:        next
+  **
+  ** Description:     Parse the next TLV.
+  **                  tlv: Receives the TLV.
+  **
+  ** Returns:         False at the end, or at the first malformed TLV.
+  **
+  *******************************************************************************/
+  bool next(BerTlv& tlv);
+
+  // whether next() stopped on malformed input rather than at the end
+  bool isMalformed() const { return mMalformed; }
+  // octets not read yet
+  size_t remaining() const { return mEnd - mPos; }
+
+ private:
+  const uint8_t* mPos;
+  const uint8_t* mEnd;
+  bool mMalformed;
+};
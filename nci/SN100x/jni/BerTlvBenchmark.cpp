@@ -0,0 +1,57 @@
+#include <benchmark/benchmark.h>
+
+#include <vector>
+#include "BerTlv.h"
+
+namespace {
+// EVT_TRANSACTION: AID, then parameters with a long form length
+std::vector<uint8_t> makeTransactionEvent(size_t paramsLen) {
+  std::vector<uint8_t> evt = {0x81, 0x07, 0xA0, 0x00, 0x00,
+                              0x00, 0x04, 0x10, 0x10, 0x82};
+  if (paramsLen < 0x80) {
+    evt.push_back((uint8_t)paramsLen);
+  } else if (paramsLen < 0x100) {
+    evt.insert(evt.end(), {0x81, (uint8_t)paramsLen});
+  } else {
+    evt.insert(evt.end(),
+               {0x82, (uint8_t)(paramsLen >> 8), (uint8_t)paramsLen});
+  }
+  evt.insert(evt.end(), paramsLen, 0x5A);
+  return evt;
+}
+
+void BM_BerTlvTransactionEvent(benchmark::State& state) {
+  std::vector<uint8_t> evt = makeTransactionEvent(state.range(0));
+  for (auto _ : state) {
+    BerTlvReader reader(evt.data(), evt.size());
+    BerTlv aid;
+    BerTlv params;
+    benchmark::DoNotOptimize(reader.next(aid));
+    benchmark::DoNotOptimize(reader.next(params));
+    benchmark::DoNotOptimize(params.value());
+  }
+}
+BENCHMARK(BM_BerTlvTransactionEvent)->Arg(16)->Arg(200)->Arg(1024);
+
+// walking a constructed TLV of many short entries, e.g. an FCI template
+void BM_BerTlvWalkConstructed(benchmark::State& state) {
+  std::vector<uint8_t> value;
+  for (int i = 0; i < state.range(0); i++)
+    value.insert(value.end(), {0x9F, 0x10, 0x02, (uint8_t)i, 0x00});
+  std::vector<uint8_t> tlv = {0x6F, 0x82, (uint8_t)(value.size() >> 8),
+                              (uint8_t)value.size()};
+  tlv.insert(tlv.end(), value.begin(), value.end());
+  for (auto _ : state) {
+    BerTlv outer;
+    BerTlv::parse(tlv.data(), tlv.size(), outer);
+    BerTlvReader reader(outer);
+    BerTlv entry;
+    int count = 0;
+    while (reader.next(entry)) count++;
+    benchmark::DoNotOptimize(count);
+  }
+}
+BENCHMARK(BM_BerTlvWalkConstructed)->Arg(8)->Arg(64);
+}  // namespace
+
+BENCHMARK_MAIN();
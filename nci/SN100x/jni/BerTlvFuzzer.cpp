@@ -0,0 +1,58 @@
+/******************************************************************************
+ *
+ *  Copyright 2024 NXP
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+
+/*
+ *  Fuzz the BER-TLV decoder with arbitrary event data, descending into
+ *  constructed TLVs the way the transaction event handlers walk them.
+ */
+#include <stdlib.h>
+
+#include "BerTlv.h"
+
+namespace {
+// nesting is bounded by the input size; cap it to keep the stack small
+const int MAX_DEPTH = 32;
+
+void walk(const uint8_t* buf, size_t bufLen, int depth) {
+  BerTlvReader reader(buf, bufLen);
+  BerTlv tlv;
+  while (reader.next(tlv)) {
+    // a TLV must lie entirely within the buffer it was parsed from
+    if (tlv.value() < buf || tlv.length() > bufLen ||
+        tlv.value() + tlv.length() > buf + bufLen || tlv.size() > bufLen) {
+      abort();
+    }
+    if (tlv.isConstructed() && depth < MAX_DEPTH) {
+      walk(tlv.value(), tlv.length(), depth + 1);
+    }
+  }
+}
+}  // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  walk(data, size, 0);
+
+  size_t length = 0;
+  size_t fieldLen = 0;
+  if (BerTlv::decodeLength(data, size, length, fieldLen) &&
+      (fieldLen == 0 || fieldLen > size)) {
+    abort();
+  }
+  return 0;
+}
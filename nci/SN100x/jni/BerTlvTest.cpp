@@ -0,0 +1,75 @@
+#include <gtest/gtest.h>
+
+#include "BerTlv.h"
+
+TEST(BerTlvTest, DecodesLengthForms) {
+  size_t length = 0;
+  size_t fieldLen = 0;
+  const uint8_t shortForm[] = {0x7F};
+  ASSERT_TRUE(BerTlv::decodeLength(shortForm, sizeof(shortForm), length,
+                                   fieldLen));
+  EXPECT_EQ(0x7Fu, length);
+  EXPECT_EQ(1u, fieldLen);
+
+  const uint8_t longForm[] = {0x83, 0x01, 0x02, 0x03};
+  ASSERT_TRUE(
+      BerTlv::decodeLength(longForm, sizeof(longForm), length, fieldLen));
+  EXPECT_EQ(0x010203u, length);
+  EXPECT_EQ(4u, fieldLen);
+
+  const uint8_t indefinite[] = {0x80, 0x00};
+  EXPECT_FALSE(BerTlv::decodeLength(indefinite, sizeof(indefinite), length,
+                                    fieldLen));
+  const uint8_t truncated[] = {0x82, 0x01};
+  EXPECT_FALSE(
+      BerTlv::decodeLength(truncated, sizeof(truncated), length, fieldLen));
+}
+
+TEST(BerTlvTest, WalksTransactionEvent) {
+  // AID, then parameters with a long form length
+  const uint8_t evt[] = {0x81, 0x02, 0xA0, 0x00, 0x82, 0x81, 0x01, 0x55};
+  BerTlvReader reader(evt, sizeof(evt));
+  BerTlv aid;
+  BerTlv params;
+  ASSERT_TRUE(reader.next(aid));
+  EXPECT_EQ(0x81u, aid.tag());
+  EXPECT_EQ(2u, aid.length());
+  EXPECT_EQ(evt + 2, aid.value());
+  ASSERT_TRUE(reader.next(params));
+  EXPECT_EQ(0x82u, params.tag());
+  EXPECT_EQ(1u, params.length());
+  EXPECT_EQ(0x55, params.value()[0]);
+  EXPECT_FALSE(reader.next(params));
+  EXPECT_FALSE(reader.isMalformed());
+}
+
+TEST(BerTlvTest, WalksConstructedTags) {
+  // FCI template holding a two octet tag and a primitive one
+  const uint8_t fci[] = {0x6F, 0x07, 0x9F, 0x38, 0x01, 0x11, 0x84, 0x00,
+                         0x00};
+  BerTlv outer;
+  ASSERT_TRUE(BerTlv::parse(fci, 9, outer));
+  EXPECT_TRUE(outer.isConstructed());
+  EXPECT_EQ(9u, outer.size());
+
+  BerTlvReader children(outer);
+  BerTlv child;
+  ASSERT_TRUE(children.next(child));
+  EXPECT_EQ(0x9F38u, child.tag());
+  EXPECT_FALSE(child.isConstructed());
+  EXPECT_EQ(0x11, child.value()[0]);
+  ASSERT_TRUE(children.next(child));
+  EXPECT_EQ(0x84u, child.tag());
+  EXPECT_EQ(0u, child.length());
+  // one octet left is a tag without a length
+  EXPECT_FALSE(children.next(child));
+  EXPECT_TRUE(children.isMalformed());
+}
+
+TEST(BerTlvTest, RejectsValueBeyondBuffer) {
+  const uint8_t evt[] = {0x81, 0x10, 0xA0, 0x00};
+  BerTlv tlv;
+  EXPECT_FALSE(BerTlv::parse(evt, sizeof(evt), tlv));
+  const uint8_t longTag[] = {0x1F, 0x81, 0x81, 0x81, 0x01, 0x00};
+  EXPECT_FALSE(BerTlv::parse(longTag, sizeof(longTag), tlv));
+}
@@ -93,29 +93,57 @@ void CondVar::wait(Mutex& mutex) {
 **
 *******************************************************************************/
 bool CondVar::wait(Mutex& mutex, long millisec) {
-  bool retVal = false;
   struct timespec absoluteTime;
+  getDeadline(millisec, absoluteTime);
+  return waitUntil(mutex, absoluteTime);
+}
 
-  if (clock_gettime(CLOCK_MONOTONIC, &absoluteTime) == -1) {
-    LOG(ERROR) << StringPrintf("CondVar::wait: fail get time; errno=0x%X",
-                               errno);
-  } else {
-    absoluteTime.tv_sec += millisec / 1000;
-    long ns = absoluteTime.tv_nsec + ((millisec % 1000) * 1000000);
-    if (ns > 1000000000) {
-      absoluteTime.tv_sec++;
-      absoluteTime.tv_nsec = ns - 1000000000;
-    } else
-      absoluteTime.tv_nsec = ns;
-  }
-
+/*******************************************************************************
+**
+** Function:        waitUntil
+**
+** Description:     Block the caller and wait for a condition.
+**                  deadline: Absolute CLOCK_MONOTONIC time to give up.
+**
+** Returns:         True if wait is successful; false if timeout occurs.
+**
+*******************************************************************************/
+bool CondVar::waitUntil(Mutex& mutex, const struct timespec& deadline) {
   int waitResult =
-      pthread_cond_timedwait(&mCondition, mutex.nativeHandle(), &absoluteTime);
+      pthread_cond_timedwait(&mCondition, mutex.nativeHandle(), &deadline);
   if ((waitResult != 0) && (waitResult != ETIMEDOUT))
     LOG(ERROR) << StringPrintf("CondVar::wait: fail timed wait; error=0x%X",
                                waitResult);
-  retVal = (waitResult == 0);  // waited successfully
-  return retVal;
+  return waitResult == 0;  // waited successfully
+}
+
+/*******************************************************************************
+**
+** Function:        getDeadline
+**
+** Description:     Convert a relative timeout to an absolute time.
+**                  millisec: Timeout in milliseconds.
+**                  deadline: Receives the CLOCK_MONOTONIC time.
+**
+** Returns:         None.
+**
+*******************************************************************************/
+void CondVar::getDeadline(long millisec, struct timespec& deadline) {
+  if (clock_gettime(CLOCK_MONOTONIC, &deadline) == -1) {
+    LOG(ERROR) << StringPrintf("CondVar::wait: fail get time; errno=0x%X",
+                               errno);
+    deadline.tv_sec = 0;
+    deadline.tv_nsec = 0;
+    return;
+  }
+  if (millisec < 0) millisec = 0;
+  deadline.tv_sec += millisec / 1000;
+  long ns = deadline.tv_nsec + ((millisec % 1000) * 1000000);
+  if (ns >= 1000000000) {
+    deadline.tv_sec++;
+    deadline.tv_nsec = ns - 1000000000;
+  } else
+    deadline.tv_nsec = ns;
 }
 
 /*******************************************************************************
@@ -134,3 +162,20 @@ void CondVar::notifyOne() {
                                res);
   }
 }
+
+/*******************************************************************************
+**
+** Function:        notifyAll
+**
+** Description:     Unblock all waiting threads.
+**
+** Returns:         None.
+**
+*******************************************************************************/
+void CondVar::notifyAll() {
+  int const res = pthread_cond_broadcast(&mCondition);
+  if (res) {
+    LOG(ERROR) << StringPrintf("CondVar::notifyAll: fail broadcast; error=0x%X",
+                               res);
+  }
+}
@@ -69,6 +69,31 @@ class CondVar {
   *******************************************************************************/
   bool wait(Mutex& mutex, long millisec);
 
+  /*******************************************************************************
+  **
+  ** Function:        waitUntil
+  **
+  ** Description:     Block the caller and wait for a condition.
+  **                  deadline: Absolute CLOCK_MONOTONIC time to give up.
+  **
+  ** Returns:         True if wait is successful; false if timeout occurs.
+  **
+  *******************************************************************************/
+  bool waitUntil(Mutex& mutex, const struct timespec& deadline);
+
+  /*******************************************************************************
+  **
+  ** Function:        getDeadline
+  **
+  ** Description:     Convert a relative timeout to an absolute time.
+  **                  millisec: Timeout in milliseconds.
+  **                  deadline: Receives the CLOCK_MONOTONIC time.
+  **
+  ** Returns:         None.
+  **
+  *******************************************************************************/
+  static void getDeadline(long millisec, struct timespec& deadline);
+
   /*******************************************************************************
   **
   ** Function:        notifyOne
@@ -80,6 +105,17 @@ class CondVar {
   *******************************************************************************/
   void notifyOne();
 
+  /*******************************************************************************
+  **
+  ** Function:        notifyAll
+  **
+  ** Description:     Unblock all waiting threads.
+  **
+  ** Returns:         None.
+  **
+  *******************************************************************************/
+  void notifyAll();
+
  private:
   pthread_cond_t mCondition;
 };
@@ -0,0 +1,285 @@
+/******************************************************************************
+ *
+ *  Copyright 2024 NXP
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/*
+ *  Cache the config parameter values read from the NFC controller.
+ */
+#include "ConfigParamCache.h"
+
+#include <algorithm>
+
+#include <android-base/stringprintf.h>
+#include <base/logging.h>
+
+using android::base::StringPrintf;
+
+extern bool nfc_debug_enabled;
+
+namespace {
+const uint8_t NCI_CORE_CMD = 0x20;         // message type command, group core
+const uint8_t NCI_CORE_RESET_OID = 0x00;
+const uint8_t NCI_CORE_SET_CONFIG_OID = 0x02;
+
+// parameter ID ranges NFA sets by itself on RF discovery start and stop
+const struct {
+  uint16_t first;
+  uint16_t last;
+} RF_DISCOVERY_PARAMS[] = {
+    {0x00, 0x00},  // TOTAL_DURATION
+    {0x29, 0x2A},  // PN_ATR_REQ_GEN_BYTES, PN_ATR_REQ_CONFIG
+    {0x30, 0x62},  // listen A, B, F, ISO-DEP and NFC-DEP parameters
+};
+}  // namespace
+
+/*******************************************************************************
+**
+** Function:        getInstance
+**
+** Description:     Get the singleton of this object.
+**
+** Returns:         Reference to this object.
+**
+*******************************************************************************/
+ConfigParamCache& ConfigParamCache::getInstance() {
+  static ConfigParamCache sConfigParamCache;
+  return sConfigParamCache;
+}
+
+/*******************************************************************************
+**
+** Function:        get
+**
+** Description:     Build the response to a get config request from cached
+**                  values, in the format of NFA_DM_GET_CONFIG_EVT: number
+**                  of parameters, then TLVs; the length also counts the
+**                  status byte of the NCI response.
+**                  numParam: Number of parameter IDs.
+**                  param: Parameter IDs; extended IDs take two octets.
+**                  rsp: Receives the response.
+**                  maxLen: Size of rsp.
+**                  rspLen: Receives the length of the response.
+**
+** Returns:         True if every parameter is cached.
+**
+*******************************************************************************/
+bool ConfigParamCache::get(uint8_t numParam, const tNFA_PMID* param,
+                           uint8_t* rsp, uint16_t maxLen, uint16_t* rspLen) {
+  std::vector<uint16_t> ids;
+  if (param == nullptr) return false;
+  parseIds(numParam, param, ids);
+
+  std::vector<uint8_t> out;
+  out.push_back(numParam);
+  {
+    AutoMutex lock(mMutex);
+    for (uint16_t id : ids) {
+      auto it = mValues.find(id);
+      if (it == mValues.end()) return false;
+      if (id > 0xFF) out.push_back(id >> 8);
+      out.push_back(id & 0xFF);
+      out.push_back(it->second.size());
+      out.insert(out.end(), it->second.begin(), it->second.end());
+    }
+  }
+  out.push_back(NFA_STATUS_OK);  // stands for the status byte in the length
+  if (out.size() > maxLen) return false;
+
+  std::copy(out.begin(), out.end(), rsp);
+  *rspLen = out.size();
+  DLOG_IF(INFO, nfc_debug_enabled)
+      << StringPrintf("%s: %u params from cache", __func__, numParam);
+  return true;
+}
+
+/*******************************************************************************
+**
+** Function:        getMissing
+**
+** Description:     Get the parameters of a request that are not cached.
+**                  numParam: Number of parameter IDs.
+**                  param: Parameter IDs; extended IDs take two octets.
+**                  missing: Receives the IDs of the missing parameters.
+**
+** Returns:         Number of missing parameters.
+**
+*******************************************************************************/
+uint8_t ConfigParamCache::getMissing(uint8_t numParam, const tNFA_PMID* param,
+                                     std::vector<tNFA_PMID>& missing) {
+  std::vector<uint16_t> ids;
+  missing.clear();
+  if (param == nullptr) return 0;
+  parseIds(numParam, param, ids);
+
+  uint8_t numMissing = 0;
+  AutoMutex lock(mMutex);
+  for (uint16_t id : ids) {
+    if (mValues.count(id)) continue;
+    if (id > 0xFF) missing.push_back(id >> 8);
+    missing.push_back(id & 0xFF);
+    numMissing++;
+  }
+  return numMissing;
+}
+
+/*******************************************************************************
+**
+** Function:        update
+**
+** Description:     Learn the values of a get config response.
+**                  tlvs: Response in the format of NFA_DM_GET_CONFIG_EVT.
+**                  tlvSize: Length of the response.
+**
+** Returns:         None
+**
+*******************************************************************************/
+void ConfigParamCache::update(const uint8_t* tlvs, uint16_t tlvSize) {
+  // leave out the number of parameters, and the status byte in the length
+  if (tlvs == nullptr || tlvSize < 2) return;
+  uint8_t numParam = tlvs[0];
+  size_t index = 1;
+  size_t end = tlvSize - 1;
+
+  AutoMutex lock(mMutex);
+  for (uint8_t i = 0; (i < numParam) && (index < end); i++) {
+    uint16_t id = tlvs[index++];
+    if (isExtended(id)) {
+      if (index >= end) break;
+      id = (id << 8) | tlvs[index++];
+    }
+    if (index >= end) break;
+    size_t len = tlvs[index++];
+    if (index + len > end) {
+      LOG(ERROR) << StringPrintf("%s: truncated param 0x%X", __func__, id);
+      break;
+    }
+    mValues[id].assign(tlvs + index, tlvs + index + len);
+    index += len;
+  }
+}
+
+/*******************************************************************************
+**
+** Function:        matches
+**
+** Description:     Whether a parameter is known to have a value.
+**                  id: Parameter ID.
+**                  value: Value.
+**
+** Returns:         True if the cached value of the parameter is value.
+**
+*******************************************************************************/
+bool ConfigParamCache::matches(uint16_t id, const std::vector<uint8_t>& value) {
+  AutoMutex lock(mMutex);
+  auto it = mValues.find(id);
+  return (it != mValues.end()) && (it->second == value);
+}
+
+/*******************************************************************************
+**
+** Function:        store
+**
+** Description:     Learn the value of a parameter set in the controller.
+**                  id: Parameter ID.
+**                  value: Value.
+**
+** Returns:         None
+**
+*******************************************************************************/
+void ConfigParamCache::store(uint16_t id, const std::vector<uint8_t>& value) {
+  AutoMutex lock(mMutex);
+  mValues[id] = value;
+}
+
+/*******************************************************************************
+**
+** Function:        invalidate
+**
+** Description:     Forget all values.
+**
+** Returns:         None
+**
+*******************************************************************************/
+void ConfigParamCache::invalidate() {
+  AutoMutex lock(mMutex);
+  mValues.clear();
+}
+
+/*******************************************************************************
+**
+** Function:        invalidateRfDiscovery
+**
+** Description:     Forget the values NFA sets by itself when RF discovery
+**                  starts or stops; keep the others.
+**
+** Returns:         None
+**
+*******************************************************************************/
+void ConfigParamCache::invalidateRfDiscovery() {
+  AutoMutex lock(mMutex);
+  for (const auto& range : RF_DISCOVERY_PARAMS) {
+    mValues.erase(mValues.lower_bound(range.first),
+                  mValues.upper_bound(range.last));
+  }
+}
+
+/*******************************************************************************
+**
+** Function:        onRawCommand
+**
+** Description:     Forget the values a raw NCI command may change: those
+**                  of the parameters it sets, or all of them if it resets
+**                  the controller.
+**                  cmd: NCI command.
+**                  cmdLen: Length of the command.
+**
+** Returns:         None
+**
+*******************************************************************************/
+void ConfigParamCache::onRawCommand(const uint8_t* cmd, uint16_t cmdLen) {
+  if (cmd == nullptr || cmdLen < 2 || cmd[0] != NCI_CORE_CMD) return;
+  if (cmd[1] == NCI_CORE_RESET_OID) {
+    invalidate();
+    return;
+  }
+  if (cmd[1] != NCI_CORE_SET_CONFIG_OID) return;
+
+  // header, length, number of parameters, then TLVs
+  if (cmdLen < 4) {
+    invalidate();
+    return;
+  }
+  size_t index = 4;
+  AutoMutex lock(mMutex);
+  for (uint8_t i = 0; (i < cmd[3]) && (index < cmdLen); i++) {
+    uint16_t id = cmd[index++];
+    if (isExtended(id) && (index < cmdLen)) id = (id << 8) | cmd[index++];
+    mValues.erase(id);
+    if (index >= cmdLen) break;
+    index += 1 + cmd[index];
+  }
+}
+
+void ConfigParamCache::parseIds(uint8_t numParam, const tNFA_PMID* param,
+                                std::vector<uint16_t>& ids) {
+  size_t index = 0;
+  for (uint8_t i = 0; i < numParam; i++) {
+    uint16_t id = param[index++];
+    if (isExtended(id)) id = (id << 8) | param[index++];
+    ids.push_back(id);
+  }
+}
@@ -0,0 +1,183 @@
+/******************************************************************************
+ *
+ *  Copyright 2024 NXP
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/*
+ *  Cache the config parameter values read from the NFC controller, so that
+ *  reading a parameter again does not cost an NCI round trip. Values are
+ *  learned from NFA_DM_GET_CONFIG_EVT and forgotten whenever the controller
+ *  may have changed them: on set config and on controller reset. When RF
+ *  discovery starts or stops, NFA sets the total duration, the NFC-DEP
+ *  general bytes and the listen parameters without NFA_DM_SET_CONFIG_EVT;
+ *  only those are forgotten then. An extended parameter ID is keyed by
+ *  both octets, e.g. 0xA155.
+ */
+#pragma once
+#include <stdint.h>
+#include <map>
+#include <vector>
+#include "Mutex.h"
+#include "nfa_api.h"
+
+class ConfigParamCache {
+ public:
+  /*******************************************************************************
+  **
+  ** Function:        getInstance
+  **
+  ** Description:     Get the singleton of this object.
+  **
+  ** Returns:         Reference to this object.
+  **
+  *******************************************************************************/
+  static ConfigParamCache& getInstance();
+
+  /*******************************************************************************
+  **
+  ** Function:        get
+  **
+  ** Description:     Build the response to a get config request from cached
+  **                  values, in the format of NFA_DM_GET_CONFIG_EVT: number
+  **                  of parameters, then TLVs; the length also counts the
+  **                  status byte of the NCI response.
+  **                  numParam: Number of parameter IDs.
+  **                  param: Parameter IDs; extended IDs take two octets.
+  **                  rsp: Receives the response.
+  **                  maxLen: Size of rsp.
+  **                  rspLen: Receives the length of the response.
+  **
+  ** Returns:         True if every parameter is cached.
+  **
+  *******************************************************************************/
+  bool get(uint8_t numParam, const tNFA_PMID* param, uint8_t* rsp,
+           uint16_t maxLen, uint16_t* rspLen);
+
+  /*******************************************************************************
+  **
+  ** Function:        getMissing
+  **
+  ** Description:     Get the parameters of a request that are not cached.
+  **                  numParam: Number of parameter IDs.
+  **                  param: Parameter IDs; extended IDs take two octets.
+  **                  missing: Receives the IDs of the missing parameters.
+  **
+  ** Returns:         Number of missing parameters.
+  **
+  *******************************************************************************/
+  uint8_t getMissing(uint8_t numParam, const tNFA_PMID* param,
+                     std::vector<tNFA_PMID>& missing);
+
+  /*******************************************************************************
+  **
+  ** Function:        update
+  **
+  ** Description:     Learn the values of a get config response.
+  **                  tlvs: Response in the format of NFA_DM_GET_CONFIG_EVT.
+  **                  tlvSize: Length of the response.
+  **
+  ** Returns:         None
+  **
+  *******************************************************************************/
+  void update(const uint8_t* tlvs, uint16_t tlvSize);
+
+  /*******************************************************************************
+  **
+  ** Function:        matches
+  **
+  ** Description:     Whether a parameter is known to have a value.
+  **                  id: Parameter ID.
+  **                  value: Value.
+  **
+  ** Returns:         True if the cached value of the parameter is value.
+  **
+  *******************************************************************************/
+  bool matches(uint16_t id, const std::vector<uint8_t>& value);
+
+  /*******************************************************************************
+  **
+  ** Function:        store
+  **
+  ** Description:     Learn the value of a parameter set in the controller.
+  **                  id: Parameter ID.
+  **                  value: Value.
+  **
+  ** Returns:         None
+  **
+  *******************************************************************************/
+  void store(uint16_t id, const std::vector<uint8_t>& value);
+
+  /*******************************************************************************
+  **
+  ** Function:        invalidate
+  **
+  ** Description:     Forget all values.
+  **
+  ** Returns:         None
+  **
+  *******************************************************************************/
+  void invalidate();
+
+  /*******************************************************************************
+  **
+  ** Function:        invalidateRfDiscovery
+  **
+  ** Description:     Forget the values NFA sets by itself when RF discovery
+  **                  starts or stops; keep the others.
+  **
+  ** Returns:         None
+  **
+  *******************************************************************************/
+  void invalidateRfDiscovery();
+
+  /*******************************************************************************
+  **
+  ** Function:        onRawCommand
+  **
+  ** Description:     Forget the values a raw NCI command may change: those
+  **                  of the parameters it sets, or all of them if it resets
+  **                  the controller.
+  **                  cmd: NCI command.
+  **                  cmdLen: Length of the command.
+  **
+  ** Returns:         None
+  **
+  *******************************************************************************/
+  void onRawCommand(const uint8_t* cmd, uint16_t cmdLen);
+
+  /*******************************************************************************
+  **
+  ** Function:        isExtended
+  **
+  ** Description:     Whether an octet starts a two octet parameter ID.
+  **                  id: First octet of the parameter ID.
+  **
+  ** Returns:         True if the ID is extended.
+  **
+  *******************************************************************************/
+  static bool isExtended(uint8_t id) {
+    return (id == PARAM_EXT) || (id == PARAM_EXT_ID1);
+  }
+
+ private:
+  static const uint8_t PARAM_EXT = 0xA0;      // first octet of extended IDs
+  static const uint8_t PARAM_EXT_ID1 = 0xA1;  // first octet of extended IDs
+  static void parseIds(uint8_t numParam, const tNFA_PMID* param,
+                       std::vector<uint16_t>& ids);
+
+  Mutex mMutex;  // guards mValues
+  std::map<uint16_t, std::vector<uint8_t>> mValues;
+};
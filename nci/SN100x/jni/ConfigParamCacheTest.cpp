@@ -0,0 +1,62 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+#include "ConfigParamCache.h"
+
+namespace {
+// number of parameters, TLVs, then the status byte counted in tlv_size
+const uint8_t kRsp[] = {0x02, 0x52, 0x01, 0x0A, 0xA0, 0x95, 0x01, 0x41, 0x00};
+}  // namespace
+
+TEST(ConfigParamCacheTest, BatchReadOnlyMissesUncachedParams) {
+  ConfigParamCache cache;
+  cache.update(kRsp, sizeof(kRsp));
+
+  tNFA_PMID params[] = {0xA0, 0x95, 0x52, 0x58};
+  std::vector<tNFA_PMID> missing;
+  EXPECT_EQ(1, cache.getMissing(3, params, missing));
+  EXPECT_EQ(std::vector<tNFA_PMID>({0x58}), missing);
+
+  uint8_t rsp[32];
+  uint16_t rspLen = 0;
+  EXPECT_FALSE(cache.get(3, params, rsp, sizeof(rsp), &rspLen));
+  ASSERT_TRUE(cache.get(2, params, rsp, sizeof(rsp), &rspLen));
+  const uint8_t expected[] = {0x02, 0xA0, 0x95, 0x01, 0x41,
+                              0x52, 0x01, 0x0A, 0x00};
+  EXPECT_EQ(std::vector<uint8_t>(expected, expected + sizeof(expected)),
+            std::vector<uint8_t>(rsp, rsp + rspLen));
+}
+
+TEST(ConfigParamCacheTest, SetConfigAndResetInvalidate) {
+  ConfigParamCache cache;
+  tNFA_PMID param = 0x52;
+  uint8_t rsp[32];
+  uint16_t rspLen = 0;
+
+  const uint8_t getConfig[] = {0x20, 0x03, 0x02, 0x01, 0x52};
+  const uint8_t setConfig[] = {0x20, 0x02, 0x04, 0x01, 0x52, 0x01, 0x0B};
+  const uint8_t reset[] = {0x20, 0x00, 0x01, 0x00};
+
+  cache.update(kRsp, sizeof(kRsp));
+  cache.onRawCommand(getConfig, sizeof(getConfig));
+  EXPECT_TRUE(cache.get(1, &param, rsp, sizeof(rsp), &rspLen));
+  cache.onRawCommand(setConfig, sizeof(setConfig));
+  EXPECT_FALSE(cache.get(1, &param, rsp, sizeof(rsp), &rspLen));
+
+  cache.update(kRsp, sizeof(kRsp));
+  cache.onRawCommand(reset, sizeof(reset));
+  EXPECT_FALSE(cache.get(1, &param, rsp, sizeof(rsp), &rspLen));
+}
+
+TEST(ConfigParamCacheTest, RfDiscoveryKeepsParamsNfaDoesNotSet) {
+  ConfigParamCache cache;
+  cache.update(kRsp, sizeof(kRsp));
+  cache.store(0x02, {0x01});  // CON_DISCOVERY_PARAM
+  cache.store(0x00, {0x00, 0x02});  // TOTAL_DURATION
+
+  cache.invalidateRfDiscovery();
+  EXPECT_FALSE(cache.matches(0x52, {0x0A}));
+  EXPECT_FALSE(cache.matches(0x00, {0x00, 0x02}));
+  EXPECT_TRUE(cache.matches(0x02, {0x01}));
+  EXPECT_TRUE(cache.matches(0xA095, {0x41}));
+}
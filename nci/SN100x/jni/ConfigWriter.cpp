@@ -0,0 +1,199 @@
+/******************************************************************************
+ *
+ *  Copyright 2024 NXP
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/*
+ *  Coalesce config parameter writes.
+ */
+#include "ConfigWriter.h"
+
+#include <android-base/stringprintf.h>
+#include <base/logging.h>
+
+#include "ConfigParamCache.h"
+#include "SyncEvent.h"
+
+using android::base::StringPrintf;
+
+extern bool nfc_debug_enabled;
+
+namespace android {
+#if (NXP_EXTNS == TRUE)
+extern tNFA_STATUS NxpNfc_Write_Cmd_Common(uint8_t retlen, uint8_t* buffer);
+#else
+extern SyncEvent gNfaSetConfigEvent;
+#endif
+}  // namespace android
+
+/*******************************************************************************
+**
+** Function:        getInstance
+**
+** Description:     Get the singleton of this object.
+**
+** Returns:         Reference to this object.
+**
+*******************************************************************************/
+ConfigWriter& ConfigWriter::getInstance() {
+  static ConfigWriter sConfigWriter;
+  return sConfigWriter;
+}
+
+/*******************************************************************************
+**
+** Function:        queue
+**
+** Description:     Queue the value of a parameter to write at next flush,
+**                  replacing the value queued before for it.
+**                  id: Parameter ID; an extended ID takes both octets,
+**                  e.g. 0xA155.
+**                  value: Value.
+**                  len: Length of the value.
+**
+** Returns:         None
+**
+*******************************************************************************/
+void ConfigWriter::queue(uint16_t id, const uint8_t* value, uint8_t len) {
+  AutoMutex lock(mMutex);
+  mPending[id].assign(value, value + len);
+}
+
+/*******************************************************************************
+**
+** Function:        flush
+**
+** Description:     Write the queued values the controller does not hold
+**                  yet, and wait for the controller to respond.
+**
+** Returns:         NFA_STATUS_OK if all values were written or none had
+**                  to be.
+**
+*******************************************************************************/
+tNFA_STATUS ConfigWriter::flush() {
+  tNFA_STATUS status = NFA_STATUS_OK;
+  std::vector<uint8_t> cmd;
+  while (takeCommand(cmd)) {
+    tNFA_STATUS cmdStatus = send(cmd);
+    onWritten(cmd, cmdStatus);
+    if (cmdStatus != NFA_STATUS_OK) {
+      LOG(ERROR) << StringPrintf("%s: set config failed; status=0x%X",
+                                 __func__, cmdStatus);
+      status = cmdStatus;
+    }
+  }
+  return status;
+}
+
+/*******************************************************************************
+**
+** Function:        takeCommand
+**
+** Description:     Build the CORE_SET_CONFIG command writing the queued
+**                  values, and clear the queue. Values known to be in the
+**                  controller are left out.
+**                  cmd: Receives the command.
+**
+** Returns:         False if there is nothing to write.
+**
+*******************************************************************************/
+bool ConfigWriter::takeCommand(std::vector<uint8_t>& cmd) {
+  ConfigParamCache& cache = ConfigParamCache::getInstance();
+  uint8_t numParam = 0;
+  cmd.assign({0x20, 0x02, 0x00, 0x00});
+
+  AutoMutex lock(mMutex);
+  auto it = mPending.begin();
+  while (it != mPending.end()) {
+    uint16_t id = it->first;
+    const std::vector<uint8_t>& value = it->second;
+    if (cache.matches(id, value)) {
+      DLOG_IF(INFO, nfc_debug_enabled)
+          << StringPrintf("%s: param 0x%X unchanged", __func__, id);
+      it = mPending.erase(it);
+      continue;
+    }
+    size_t tlvLen = ((id > 0xFF) ? 2 : 1) + 1 + value.size();
+    if (CMD_HEADER_LEN + tlvLen > MAX_CMD_LEN) {
+      LOG(ERROR) << StringPrintf("%s: param 0x%X too long", __func__, id);
+      it = mPending.erase(it);
+      continue;
+    }
+    // what does not fit is left for the next command
+    if (cmd.size() + tlvLen > MAX_CMD_LEN) break;
+    if (id > 0xFF) cmd.push_back(id >> 8);
+    cmd.push_back(id & 0xFF);
+    cmd.push_back(value.size());
+    cmd.insert(cmd.end(), value.begin(), value.end());
+    numParam++;
+    it = mPending.erase(it);
+  }
+  if (numParam == 0) return false;
+
+  cmd[2] = cmd.size() - 3;
+  cmd[3] = numParam;
+  DLOG_IF(INFO, nfc_debug_enabled) << StringPrintf(
+      "%s: %u params in %zu octets", __func__, numParam, cmd.size());
+  return true;
+}
+
+/*******************************************************************************
+**
+** Function:        onWritten
+**
+** Description:     Learn the values of a command built by takeCommand().
+**                  cmd: Command.
+**                  status: Status of the command.
+**
+** Returns:         None
+**
+*******************************************************************************/
+void ConfigWriter::onWritten(const std::vector<uint8_t>& cmd,
+                             tNFA_STATUS status) {
+  ConfigParamCache& cache = ConfigParamCache::getInstance();
+  if (status != NFA_STATUS_OK) {
+    // some values may have been set; read them again when needed
+    cache.onRawCommand(cmd.data(), cmd.size());
+    return;
+  }
+  size_t index = CMD_HEADER_LEN;
+  for (uint8_t i = 0; i < cmd[3]; i++) {
+    uint16_t id = cmd[index++];
+    if (ConfigParamCache::isExtended(id)) id = (id << 8) | cmd[index++];
+    uint8_t len = cmd[index++];
+    cache.store(id, std::vector<uint8_t>(&cmd[index], &cmd[index] + len));
+    index += len;
+  }
+}
+
+tNFA_STATUS ConfigWriter::send(std::vector<uint8_t>& cmd) {
+#if (NXP_EXTNS == TRUE)
+  return android::NxpNfc_Write_Cmd_Common(cmd.size(), cmd.data());
+#else
+  // NFA sets one parameter per command; they are still sent back to back
+  tNFA_STATUS status = NFA_STATUS_OK;
+  size_t index = CMD_HEADER_LEN;
+  for (uint8_t i = 0; (i < cmd[3]) && (status == NFA_STATUS_OK); i++) {
+    tNFA_PMID id = cmd[index++];
+    uint8_t len = cmd[index++];
+    SyncEventGuard guard(android::gNfaSetConfigEvent);
+    status = NFA_SetConfig(id, len, &cmd[index]);
+    if (status == NFA_STATUS_OK) android::gNfaSetConfigEvent.wait();
+    index += len;
+  }
+  return status;
+#endif
+}
@@ -0,0 +1,112 @@
+/******************************************************************************
+ *
+ *  Copyright 2024 NXP
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/*
+ *  Coalesce config parameter writes. Values queued by different callers are
+ *  kept per parameter ID, the last one winning, and written together in one
+ *  CORE_SET_CONFIG command when flushed; a value the controller is known to
+ *  hold already is not written at all. Only parameters owned by the JNI may
+ *  be queued: those NFA keeps its own copy of must go through NFA_SetConfig.
+ */
+#pragma once
+#include <stdint.h>
+#include <map>
+#include <vector>
+#include "Mutex.h"
+#include "nfa_api.h"
+
+class ConfigWriter {
+ public:
+  /*******************************************************************************
+  **
+  ** Function:        getInstance
+  **
+  ** Description:     Get the singleton of this object.
+  **
+  ** Returns:         Reference to this object.
+  **
+  *******************************************************************************/
+  static ConfigWriter& getInstance();
+
+  /*******************************************************************************
+  **
+  ** Function:        queue
+  **
+  ** Description:     Queue the value of a parameter to write at next flush,
+  **                  replacing the value queued before for it.
+  **                  id: Parameter ID; an extended ID takes both octets,
+  **                  e.g. 0xA155.
+  **                  value: Value.
+  **                  len: Length of the value.
+  **
+  ** Returns:         None
+  **
+  *******************************************************************************/
+  void queue(uint16_t id, const uint8_t* value, uint8_t len);
+
+  /*******************************************************************************
+  **
+  ** Function:        flush
+  **
+  ** Description:     Write the queued values the controller does not hold
+  **                  yet, and wait for the controller to respond.
+  **
+  ** Returns:         NFA_STATUS_OK if all values were written or none had
+  **                  to be.
+  **
+  *******************************************************************************/
+  tNFA_STATUS flush();
+
+  /*******************************************************************************
+  **
+  ** Function:        takeCommand
+  **
+  ** Description:     Build the CORE_SET_CONFIG command writing the queued
+  **                  values, and clear the queue. Values known to be in the
+  **                  controller are left out.
+  **                  cmd: Receives the command.
+  **
+  ** Returns:         False if there is nothing to write.
+  **
+  *******************************************************************************/
+  bool takeCommand(std::vector<uint8_t>& cmd);
+
+  /*******************************************************************************
+  **
+  ** Function:        onWritten
+  **
+  ** Description:     Learn the values of a command built by takeCommand().
+  **                  cmd: Command.
+  **                  status: Status of the command.
+  **
+  ** Returns:         None
+  **
+  *******************************************************************************/
+  void onWritten(const std::vector<uint8_t>& cmd, tNFA_STATUS status);
+
+ private:
+  // command header, length, and number of parameters
+  static const size_t CMD_HEADER_LEN = 4;
+  // raw commands are sent with a one octet length
+  static const size_t MAX_CMD_LEN = 0xFF;
+
+  tNFA_STATUS send(std::vector<uint8_t>& cmd);
+
+  Mutex mMutex;  // guards mPending
+  std::map<uint16_t, std::vector<uint8_t>> mPending;
+};
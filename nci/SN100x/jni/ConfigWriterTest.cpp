@@ -0,0 +1,32 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+#include "ConfigParamCache.h"
+#include "ConfigWriter.h"
+
+TEST(ConfigWriterTest, CoalescesAndSkipsKnownValues) {
+  ConfigWriter writer;
+  ConfigParamCache& cache = ConfigParamCache::getInstance();
+  cache.invalidate();
+  cache.store(0x85, {0x01});
+
+  uint8_t on = 0x01, off = 0x00;
+  uint8_t rssi[] = {0x01, 0x0A};
+  writer.queue(0x02, &on, 1);
+  writer.queue(0x85, &on, 1);
+  writer.queue(0xA155, rssi, sizeof(rssi));
+  writer.queue(0x02, &off, 1);
+
+  std::vector<uint8_t> cmd;
+  ASSERT_TRUE(writer.takeCommand(cmd));
+  const uint8_t expected[] = {0x20, 0x02, 0x09, 0x02, 0x02, 0x01,
+                              0x00, 0xA1, 0x55, 0x02, 0x01, 0x0A};
+  EXPECT_EQ(std::vector<uint8_t>(expected, expected + sizeof(expected)), cmd);
+  std::vector<uint8_t> next;
+  EXPECT_FALSE(writer.takeCommand(next));
+
+  writer.onWritten(cmd, NFA_STATUS_OK);
+  writer.queue(0x02, &off, 1);
+  writer.queue(0xA155, rssi, sizeof(rssi));
+  EXPECT_FALSE(writer.takeCommand(next));
+}
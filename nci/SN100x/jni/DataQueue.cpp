@@ -114,7 +114,7 @@ bool DataQueue::dequeue(uint8_t* buffer, uint16_t bufferMaxLen,
                         uint16_t& actualLen) {
   mMutex.lock();
 
-  tHeader* header = mQueue.front();
+  tHeader* header = mQueue.empty() ? NULL : mQueue.front();
   bool retval = false;
 
   if (header && buffer && (bufferMaxLen > 0)) {
@@ -0,0 +1,244 @@
+/******************************************************************************
+ *
+ *  Copyright 2024 NXP
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/*
+ *  Store data bytes in a fixed-size single-producer/single-consumer ring.
+ */
+
+#include "DataRing.h"
+
+#include <malloc.h>
+#include <string.h>
+
+#include <android-base/stringprintf.h>
+#include <base/logging.h>
+
+using android::base::StringPrintf;
+
+/*******************************************************************************
+**
+** Function:        DataRing
+**
+** Description:     Allocate the ring.
+**                  capacity: Number of octets, rounded up to a power of
+**                  two. Each message also takes 2 octets of header.
+**
+** Returns:         None.
+**
+*******************************************************************************/
+DataRing::DataRing(size_t capacity)
+    : mBuffer(NULL),
+      mMask(0),
+      mHead(0),
+      mTail(0),
+      mReadOffset(0),
+      mConsumerWaiting(false),
+      mClosed(false) {
+  size_t size = 4;  // smallest power of two holding a 1-octet message
+  while (size < capacity) size <<= 1;
+  mBuffer = (uint8_t*)malloc(size);
+  if (mBuffer == NULL) {
+    LOG(ERROR) << StringPrintf("DataRing: out of memory");
+    return;
+  }
+  mMask = size - 1;
+}
+
+/*******************************************************************************
+**
+** Function:        ~DataRing
+**
+** Description:     Release all resources.
+**
+** Returns:         None.
+**
+*******************************************************************************/
+DataRing::~DataRing() { free(mBuffer); }
+
+bool DataRing::isEmpty() {
+  return mHead.load(std::memory_order_acquire) ==
+         mTail.load(std::memory_order_relaxed);
+}
+
+void DataRing::copyIn(size_t pos, const uint8_t* data, size_t len) {
+  size_t start = pos & mMask;
+  size_t first = mMask + 1 - start;
+  if (first >= len) {
+    memcpy(mBuffer + start, data, len);
+  } else {
+    memcpy(mBuffer + start, data, first);
+    memcpy(mBuffer, data + first, len - first);
+  }
+}
+
+void DataRing::copyOut(size_t pos, uint8_t* data, size_t len) {
+  size_t start = pos & mMask;
+  size_t first = mMask + 1 - start;
+  if (first >= len) {
+    memcpy(data, mBuffer + start, len);
+  } else {
+    memcpy(data, mBuffer + start, first);
+    memcpy(data + first, mBuffer, len - first);
+  }
+}
+
+/*******************************************************************************
+**
+** Function:        enqueue
+**
+** Description:     Append data to the ring. Never blocks. Producer only.
+**                  data: array of bytes
+**                  dataLen: length of the data.
+**
+** Returns:         True if ok; false if the ring is full.
+**
+*******************************************************************************/
+bool DataRing::enqueue(const uint8_t* data, uint16_t dataLen) {
+  if ((data == NULL) || (dataLen == 0) || (mBuffer == NULL)) return false;
+
+  size_t head = mHead.load(std::memory_order_relaxed);
+  size_t tail = mTail.load(std::memory_order_acquire);
+  if ((mMask + 1) - (head - tail) < HEADER_LEN + dataLen) {
+    LOG(ERROR) << StringPrintf("DataRing::enqueue: full; len=%u", dataLen);
+    return false;
+  }
+
+  uint8_t header[HEADER_LEN] = {(uint8_t)(dataLen >> 8), (uint8_t)dataLen};
+  copyIn(head, header, HEADER_LEN);
+  copyIn(head + HEADER_LEN, data, dataLen);
+  // sequentially consistent, so that a consumer about to block either sees
+  // the data or is seen as waiting
+  mHead.store(head + HEADER_LEN + dataLen, std::memory_order_seq_cst);
+  wakeConsumer();
+  return true;
+}
+
+void DataRing::wakeConsumer() {
+  if (mConsumerWaiting.load(std::memory_order_seq_cst)) {
+    AutoMutex lock(mMutex);
+    mCondVar.notifyOne();
+  }
+}
+
+/*******************************************************************************
+**
+** Function:        dequeue
+**
+** Description:     Retrieve and remove data from the front of the ring.
+**                  Consumer only.
+**                  buffer: array to store the data.
+**                  bufferMaxLen: maximum size of the buffer.
+**                  actualLen: actual length of the data.
+**
+** Returns:         True if ok.
+**
+*******************************************************************************/
+bool DataRing::dequeue(uint8_t* buffer, uint16_t bufferMaxLen,
+                       uint16_t& actualLen) {
+  if ((buffer == NULL) || (bufferMaxLen == 0)) return false;
+
+  size_t tail = mTail.load(std::memory_order_relaxed);
+  if (mHead.load(std::memory_order_acquire) == tail) return false;
+
+  uint8_t header[HEADER_LEN];
+  copyOut(tail, header, HEADER_LEN);
+  uint16_t dataLen = (header[0] << 8) | header[1];
+  uint16_t remaining = dataLen - mReadOffset;
+
+  if (remaining <= bufferMaxLen) {
+    // caller's buffer is big enough to store the rest of the message
+    actualLen = remaining;
+    copyOut(tail + HEADER_LEN + mReadOffset, buffer, actualLen);
+    mReadOffset = 0;
+    mTail.store(tail + HEADER_LEN + dataLen, std::memory_order_release);
+  } else {
+    // caller's buffer is too small; the next dequeue() gets the remainder
+    actualLen = bufferMaxLen;
+    copyOut(tail + HEADER_LEN + mReadOffset, buffer, actualLen);
+    mReadOffset += actualLen;
+  }
+  return true;
+}
+
+/*******************************************************************************
+**
+** Function:        waitNotEmpty
+**
+** Description:     Block the consumer until data is available or the ring
+**                  is closed.
+**                  millisec: Timeout in milliseconds.
+**
+** Returns:         True if data is available or the ring is closed; false
+**                  if timeout occurs.
+**
+*******************************************************************************/
+bool DataRing::waitNotEmpty(long millisec) {
+  if (!isEmpty() || isClosed()) return true;
+
+  AutoMutex lock(mMutex);
+  mConsumerWaiting.store(true, std::memory_order_seq_cst);
+  bool ready;
+  while (!(ready = (mHead.load(std::memory_order_seq_cst) !=
+                    mTail.load(std::memory_order_relaxed)) ||
+                   mClosed.load(std::memory_order_seq_cst))) {
+    if (!mCondVar.wait(mMutex, millisec)) {
+      ready = !isEmpty() || isClosed();
+      break;
+    }
+  }
+  mConsumerWaiting.store(false, std::memory_order_relaxed);
+  return ready;
+}
+
+/*******************************************************************************
+**
+** Function:        close
+**
+** Description:     Tell the consumer that no more data will come, waking
+**                  it up. Any thread may call it.
+**
+** Returns:         None.
+**
+*******************************************************************************/
+void DataRing::close() {
+  mClosed.store(true, std::memory_order_seq_cst);
+  wakeConsumer();
+}
+
+/*******************************************************************************
+**
+** Function:        open
+**
+** Description:     Undo close(). Consumer only, while no producer is
+**                  active.
+**
+** Returns:         None.
+**
+*******************************************************************************/
+void DataRing::open() { mClosed.store(false, std::memory_order_seq_cst); }
+
+/*******************************************************************************
+**
+** Function:        isClosed
+**
+** Description:     Whether close() was called since open().
+**
+** Returns:         True if closed.
+**
+*******************************************************************************/
+bool DataRing::isClosed() { return mClosed.load(std::memory_order_acquire); }
@@ -0,0 +1,165 @@
+/******************************************************************************
+ *
+ *  Copyright 2024 NXP
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/*
+ *  Store data bytes in a fixed-size ring shared by exactly one producer
+ *  thread and one consumer thread. Neither side takes a lock, except the
+ *  producer when it must wake a consumer blocked in waitNotEmpty().
+ */
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include "CondVar.h"
+#include "Mutex.h"
+
+class DataRing {
+ public:
+  /*******************************************************************************
+  **
+  ** Function:        DataRing
+  **
+  ** Description:     Allocate the ring.
+  **                  capacity: Number of octets, rounded up to a power of
+  **                  two. Each message also takes 2 octets of header.
+  **
+  ** Returns:         None.
+  **
+  *******************************************************************************/
+  explicit DataRing(size_t capacity);
+
+  /*******************************************************************************
+  **
+  ** Function:        ~DataRing
+  **
+  ** Description:     Release all resources.
+  **
+  ** Returns:         None.
+  **
+  *******************************************************************************/
+  ~DataRing();
+
+  /*******************************************************************************
+  **
+  ** Function:        enqueue
+  **
+  ** Description:     Append data to the ring. Never blocks. Producer only.
+  **                  data: array of bytes
+  **                  dataLen: length of the data.
+  **
+  ** Returns:         True if ok; false if the ring is full.
+  **
+  *******************************************************************************/
+  bool enqueue(const uint8_t* data, uint16_t dataLen);
+
+  /*******************************************************************************
+  **
+  ** Function:        dequeue
+  **
+  ** Description:     Retrieve and remove data from the front of the ring.
+  **                  Consumer only.
+  **                  buffer: array to store the data.
+  **                  bufferMaxLen: maximum size of the buffer.
+  **                  actualLen: actual length of the data.
+  **
+  ** Returns:         True if ok.
+  **
+  *******************************************************************************/
+  bool dequeue(uint8_t* buffer, uint16_t bufferMaxLen, uint16_t& actualLen);
+
+  /*******************************************************************************
+  **
+  ** Function:        isEmpty
+  **
+  ** Description:     Whether the ring is empty.
+  **
+  ** Returns:         True if empty.
+  **
+  *******************************************************************************/
+  bool isEmpty();
+
+  /*******************************************************************************
+  **
+  ** Function:        waitNotEmpty
+  **
+  ** Description:     Block the consumer until data is available or the ring
+  **                  is closed.
+  **                  millisec: Timeout in milliseconds.
+  **
+  ** Returns:         True if data is available or the ring is closed; false
+  **                  if timeout occurs.
+  **
+  *******************************************************************************/
+  bool waitNotEmpty(long millisec);
+
+  /*******************************************************************************
+  **
+  ** Function:        close
+  **
+  ** Description:     Tell the consumer that no more data will come, waking
+  **                  it up. Any thread may call it.
+  **
+  ** Returns:         None.
+  **
+  *******************************************************************************/
+  void close();
+
+  /*******************************************************************************
+  **
+  ** Function:        open
+  **
+  ** Description:     Undo close(). Consumer only, while no producer is
+  **                  active.
+  **
+  ** Returns:         None.
+  **
+  *******************************************************************************/
+  void open();
+
+  /*******************************************************************************
+  **
+  ** Function:        isClosed
+  **
+  ** Description:     Whether close() was called since open().
+  **
+  ** Returns:         True if closed.
+  **
+  *******************************************************************************/
+  bool isClosed();
+
+ private:
+  static const size_t CACHE_LINE_SIZE = 64;
+  static const size_t HEADER_LEN = 2;
+
+  void copyIn(size_t pos, const uint8_t* data, size_t len);
+  void copyOut(size_t pos, uint8_t* data, size_t len);
+  void wakeConsumer();
+
+  uint8_t* mBuffer;
+  size_t mMask;
+  // positions only ever grow; each is written by one side only and sits on
+  // its own cache line so that the two threads do not share one
+  alignas(CACHE_LINE_SIZE) std::atomic<size_t> mHead;  // written by producer
+  alignas(CACHE_LINE_SIZE) std::atomic<size_t> mTail;  // written by consumer
+  size_t mReadOffset;  // octets of the front message already dequeued
+  alignas(CACHE_LINE_SIZE) std::atomic<bool> mConsumerWaiting;
+  std::atomic<bool> mClosed;
+  Mutex mMutex;  // only used to block and wake the consumer
+  CondVar mCondVar;
+};
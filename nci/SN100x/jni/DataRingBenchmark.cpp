@@ -0,0 +1,99 @@
+#include <benchmark/benchmark.h>
+
+#include <thread>
+#include <vector>
+#include "DataQueue.h"
+#include "DataRing.h"
+
+namespace {
+const size_t RING_SIZE = 64 * 1024;
+
+// one fragment in and out on the same thread: the cost of the ring itself
+void BM_DataRingEnqueueDequeue(benchmark::State& state) {
+  DataRing ring(RING_SIZE);
+  std::vector<uint8_t> frame(state.range(0), 0x5A);
+  std::vector<uint8_t> buffer(frame.size());
+  uint16_t len = 0;
+  for (auto _ : state) {
+    ring.enqueue(frame.data(), frame.size());
+    ring.dequeue(buffer.data(), buffer.size(), len);
+  }
+  state.SetBytesProcessed(state.iterations() * frame.size());
+}
+BENCHMARK(BM_DataRingEnqueueDequeue)->Arg(64)->Arg(256)->Arg(1024)->Arg(4096);
+
+// the same through the list of heap copies the ring replaced
+void BM_DataQueueEnqueueDequeue(benchmark::State& state) {
+  DataQueue queue;
+  std::vector<uint8_t> frame(state.range(0), 0x5A);
+  std::vector<uint8_t> buffer(frame.size());
+  uint16_t len = 0;
+  for (auto _ : state) {
+    queue.enqueue(frame.data(), frame.size());
+    queue.dequeue(buffer.data(), buffer.size(), len);
+  }
+  state.SetBytesProcessed(state.iterations() * frame.size());
+}
+BENCHMARK(BM_DataQueueEnqueueDequeue)->Arg(64)->Arg(256)->Arg(1024)->Arg(4096);
+
+// fragments streamed from the NFA callback thread to a blocked reader, as
+// for a streamed transceive; as many as fit, since the producer never waits
+void BM_DataRingStream(benchmark::State& state) {
+  DataRing ring(RING_SIZE);
+  std::vector<uint8_t> frame(state.range(0), 0x5A);
+  std::vector<uint8_t> buffer(frame.size());
+  const int frames = RING_SIZE / (frame.size() + 2);
+  for (auto _ : state) {
+    std::thread producer([&] {
+      for (int i = 0; i < frames; i++) ring.enqueue(frame.data(), frame.size());
+    });
+    uint16_t len = 0;
+    for (int i = 0; i < frames;) {
+      if (ring.dequeue(buffer.data(), buffer.size(), len))
+        i++;
+      else
+        ring.waitNotEmpty(100);
+    }
+    producer.join();
+  }
+  state.SetBytesProcessed(state.iterations() * frames * frame.size());
+}
+BENCHMARK(BM_DataRingStream)
+    ->Arg(64)
+    ->Arg(256)
+    ->Arg(1024)
+    ->Arg(4096)
+    ->UseRealTime();
+
+// the same number of fragments through DataQueue, which cannot be waited on;
+// the reader yields while it is empty
+void BM_DataQueueStream(benchmark::State& state) {
+  DataQueue queue;
+  std::vector<uint8_t> frame(state.range(0), 0x5A);
+  std::vector<uint8_t> buffer(frame.size());
+  const int frames = RING_SIZE / (frame.size() + 2);
+  for (auto _ : state) {
+    std::thread producer([&] {
+      for (int i = 0; i < frames; i++)
+        queue.enqueue(frame.data(), frame.size());
+    });
+    uint16_t len = 0;
+    for (int i = 0; i < frames;) {
+      if (queue.dequeue(buffer.data(), buffer.size(), len))
+        i++;
+      else
+        std::this_thread::yield();
+    }
+    producer.join();
+  }
+  state.SetBytesProcessed(state.iterations() * frames * frame.size());
+}
+BENCHMARK(BM_DataQueueStream)
+    ->Arg(64)
+    ->Arg(256)
+    ->Arg(1024)
+    ->Arg(4096)
+    ->UseRealTime();
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,82 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+#include "DataRing.h"
+
+TEST(DataRingTest, MessagesKeepBoundaries) {
+  DataRing ring(64);
+  uint8_t first[] = {0x01, 0x02, 0x03};
+  uint8_t second[] = {0x90, 0x00};
+  uint8_t buffer[16];
+  uint16_t len = 0;
+
+  ASSERT_TRUE(ring.enqueue(first, sizeof(first)));
+  ASSERT_TRUE(ring.enqueue(second, sizeof(second)));
+
+  ASSERT_TRUE(ring.dequeue(buffer, sizeof(buffer), len));
+  EXPECT_EQ(sizeof(first), len);
+  EXPECT_EQ(0, memcmp(first, buffer, len));
+  ASSERT_TRUE(ring.dequeue(buffer, sizeof(buffer), len));
+  EXPECT_EQ(sizeof(second), len);
+  EXPECT_TRUE(ring.isEmpty());
+  EXPECT_FALSE(ring.dequeue(buffer, sizeof(buffer), len));
+}
+
+TEST(DataRingTest, PartialDequeueReturnsRemainder) {
+  DataRing ring(64);
+  uint8_t data[] = {0x01, 0x02, 0x03, 0x04, 0x05};
+  uint8_t buffer[2];
+  uint16_t len = 0;
+
+  ASSERT_TRUE(ring.enqueue(data, sizeof(data)));
+  ASSERT_TRUE(ring.dequeue(buffer, sizeof(buffer), len));
+  EXPECT_EQ(2, len);
+  EXPECT_EQ(0x01, buffer[0]);
+  ASSERT_TRUE(ring.dequeue(buffer, sizeof(buffer), len));
+  EXPECT_EQ(0x03, buffer[0]);
+  ASSERT_TRUE(ring.dequeue(buffer, sizeof(buffer), len));
+  EXPECT_EQ(1, len);
+  EXPECT_EQ(0x05, buffer[0]);
+  EXPECT_TRUE(ring.isEmpty());
+}
+
+TEST(DataRingTest, FullRingRejectsAndWrapsAround) {
+  DataRing ring(16);
+  uint8_t data[6] = {0x01, 0x02, 0x03, 0x04, 0x05, 0x06};
+  uint8_t buffer[8];
+  uint16_t len = 0;
+
+  ASSERT_TRUE(ring.enqueue(data, sizeof(data)));
+  ASSERT_TRUE(ring.enqueue(data, sizeof(data)));
+  EXPECT_FALSE(ring.enqueue(data, sizeof(data)));
+
+  for (int i = 0; i < 10; i++) {
+    ASSERT_TRUE(ring.dequeue(buffer, sizeof(buffer), len));
+    EXPECT_EQ(0, memcmp(data, buffer, sizeof(data)));
+    ASSERT_TRUE(ring.enqueue(data, sizeof(data)));
+  }
+}
+
+TEST(DataRingTest, WaitWakesOnEnqueue) {
+  DataRing ring(64);
+  uint8_t data[] = {0x90, 0x00};
+
+  EXPECT_FALSE(ring.waitNotEmpty(10));
+  std::thread producer([&] { ring.enqueue(data, sizeof(data)); });
+  EXPECT_TRUE(ring.waitNotEmpty(2000));
+  producer.join();
+}
+
+TEST(DataRingTest, CloseWakesWaitingConsumer) {
+  DataRing ring(64);
+
+  std::thread closer([&] { ring.close(); });
+  EXPECT_TRUE(ring.waitNotEmpty(2000));
+  closer.join();
+  EXPECT_TRUE(ring.isClosed());
+  EXPECT_TRUE(ring.isEmpty());
+
+  ring.open();
+  EXPECT_FALSE(ring.isClosed());
+  EXPECT_FALSE(ring.waitNotEmpty(10));
+}
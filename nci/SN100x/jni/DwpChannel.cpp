@@ -74,7 +74,7 @@ bool IsWiredMode_Enable()
                 {
                     LOG(INFO) << StringPrintf("%s: Enable eSE-mode set ON", fn);
                     se.SecEle_Modeset(se.NFCEE_ENABLE);
-                    usleep(2000 * 1000);
+                    se.waitEeReady(meSE, 2000);
                     stat = NFA_STATUS_OK;
                     break;
                 }
@@ -279,12 +279,12 @@ void doeSE_Reset(void)
 
     LOG(INFO) << StringPrintf("1st mode set calling");
     se.SecEle_Modeset(se.NFCEE_DISABLE);
-    usleep(100 * 1000);
+    se.waitEeStatus(se.EE_HANDLE_0xF3, NFA_EE_STATUS_INACTIVE, 100);
     LOG(INFO) << StringPrintf("1st mode set called");
     LOG(INFO) << StringPrintf("2nd mode set calling");
     se.SecEle_Modeset(se.NFCEE_ENABLE);
     LOG(INFO) << StringPrintf("2nd mode set called");
-    usleep(3000 * 1000);
+    se.waitEeReady(se.EE_HANDLE_0xF3, 3000);
 }
 
 /*******************************************************************************
@@ -306,9 +306,9 @@ void doeSE_JcopDownLoadReset(void)
     se.setNfccPwrConfig(se.NFCC_DECIDES);
     LOG(INFO) << StringPrintf("1st mode set");
     se.SecEle_Modeset(se.NFCEE_DISABLE);
-    usleep(100 * 1000);
+    se.waitEeStatus(se.EE_HANDLE_0xF3, NFA_EE_STATUS_INACTIVE, 100);
     se.setNfccPwrConfig(se.POWER_ALWAYS_ON|se.COMM_LINK_ACTIVE);
     se.SecEle_Modeset(se.NFCEE_ENABLE);
     LOG(INFO) << StringPrintf("2nd mode set");
-    usleep(3000 * 1000);
+    se.waitEeReady(se.EE_HANDLE_0xF3, 3000);
 }
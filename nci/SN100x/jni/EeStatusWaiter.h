@@ -0,0 +1,76 @@
+/******************************************************************************
+ *
+ *  Copyright 2024 NXP
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+
+/*
+ *  Wait for an NFCEE to reach a state without polling it. The EE callback
+ *  calls notifyChanged() on every notification that may change the state
+ *  of an NFCEE; waiters re-evaluate their condition only then, and once
+ *  more at their deadline.
+ */
+#pragma once
+#include <stdint.h>
+#include "SyncEvent.h"
+
+class EeStatusWaiter {
+ public:
+  EeStatusWaiter() : mWaiters(0) {}
+
+  /*******************************************************************************
+  **
+  ** Function:        notifyChanged
+  **
+  ** Description:     Wake up every thread in waitFor(), to re-evaluate its
+  **                  condition. Update the state the conditions read before
+  **                  calling this.
+  **
+  ** Returns:         None
+  **
+  *******************************************************************************/
+  void notifyChanged() {
+    SyncEventGuard guard(mEvent);
+    // release every ticket taken so far; a re-evaluating waiter takes a
+    // new one only after the guard is released
+    for (uint32_t i = 0; i < mWaiters; i++) mEvent.notifyOne();
+  }
+
+  /*******************************************************************************
+  **
+  ** Function:        waitFor
+  **
+  ** Description:     Block until a condition holds. The condition is
+  **                  evaluated on entry and after every notifyChanged().
+  **                  maxWaitMs: Longest time to wait.
+  **                  done: Condition to wait for.
+  **
+  ** Returns:         Value of the condition when the wait ends.
+  **
+  *******************************************************************************/
+  template <typename Predicate>
+  bool waitFor(uint32_t maxWaitMs, Predicate done) {
+    SyncEventGuard guard(mEvent);
+    mWaiters++;
+    bool result = mEvent.wait(maxWaitMs, done);
+    mWaiters--;
+    return result;
+  }
+
+ private:
+  SyncEvent mEvent;
+  uint32_t mWaiters;  // threads in waitFor(); guarded by mEvent
+};
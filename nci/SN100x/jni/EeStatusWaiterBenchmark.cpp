@@ -0,0 +1,37 @@
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <thread>
+#include "EeStatusWaiter.h"
+
+namespace {
+// time from an EE notification to the waiting thread running again; the
+// polling it replaces reacted 5 to 320 ms after the change
+void BM_EeStatusWaiterWakeup(benchmark::State& state) {
+  EeStatusWaiter waiter;
+  std::atomic<int> status(0);
+  std::atomic<bool> stop(false);
+  std::atomic<int> reached(0);
+
+  std::thread ntf([&] {
+    int last = 0;
+    while (!stop) {
+      // a new round starts once the waiter saw the last change
+      if (reached != last) continue;
+      status = ++last;
+      waiter.notifyChanged();
+    }
+  });
+  int expected = 0;
+  for (auto _ : state) {
+    expected++;
+    waiter.waitFor(1000, [&] { return status >= expected; });
+    reached = expected;
+  }
+  stop = true;
+  ntf.join();
+}
+BENCHMARK(BM_EeStatusWaiterWakeup)->UseRealTime();
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,60 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+
+#include "EeStatusWaiter.h"
+
+TEST(EeStatusWaiterTest, ReturnsAtOnceWhenConditionHolds) {
+  EeStatusWaiter waiter;
+  int evaluated = 0;
+
+  EXPECT_TRUE(waiter.waitFor(10000, [&] { return ++evaluated > 0; }));
+  EXPECT_EQ(1, evaluated);
+}
+
+TEST(EeStatusWaiterTest, TimesOutWithoutNotification) {
+  EeStatusWaiter waiter;
+  int evaluated = 0;
+
+  EXPECT_FALSE(waiter.waitFor(20, [&] {
+    evaluated++;
+    return false;
+  }));
+  // on entry and at the deadline only
+  EXPECT_EQ(2, evaluated);
+}
+
+TEST(EeStatusWaiterTest, WakesUpOnStatusChange) {
+  EeStatusWaiter waiter;
+  std::atomic<int> status(0);
+
+  std::thread ntf([&] {
+    // an unrelated change first: the wait goes on
+    waiter.notifyChanged();
+    status = 1;
+    waiter.notifyChanged();
+  });
+  EXPECT_TRUE(waiter.waitFor(10000, [&] { return status == 1; }));
+  ntf.join();
+}
+
+TEST(EeStatusWaiterTest, WakesUpEveryWaiter) {
+  EeStatusWaiter waiter;
+  std::atomic<bool> ready(false);
+  std::atomic<int> woken(0);
+
+  std::thread first([&] {
+    if (waiter.waitFor(10000, [&] { return ready.load(); })) woken++;
+  });
+  std::thread second([&] {
+    if (waiter.waitFor(10000, [&] { return ready.load(); })) woken++;
+  });
+  // let both start waiting; a late starter sees ready on entry anyway
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  ready = true;
+  waiter.notifyChanged();
+  first.join();
+  second.join();
+  EXPECT_EQ(2, woken);
+}
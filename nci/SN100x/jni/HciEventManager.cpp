@@ -36,8 +36,10 @@
 #include <base/logging.h>
 #include <log/log.h>
 #include <nativehelper/ScopedLocalRef.h>
+#include "BerTlv.h"
 #include "JavaClassConstants.h"
 #include "NfcJniUtil.h"
+#include "NfcTrace.h"
 #include "nfc_config.h"
 
 extern bool nfc_debug_enabled;
@@ -52,7 +54,8 @@ uint8_t HciEventManager::sESim2Pipe;
 
 using android::base::StringPrintf;
 
-HciEventManager::HciEventManager() : mNativeData(nullptr) {}
+HciEventManager::HciEventManager()
+    : mNativeData(nullptr), mStopping(false) {}
 
 HciEventManager& HciEventManager::getInstance() {
   static HciEventManager sHciEventManager;
@@ -75,101 +78,133 @@ void HciEventManager::initialize(nfc_jni_native_data* native) {
 #endif
   sEsePipe = NfcConfig::getUnsigned(NAME_OFF_HOST_ESE_PIPE_ID, 0x16);
   sSimPipe = NfcConfig::getUnsigned(NAME_OFF_HOST_SIM_PIPE_ID, 0x0A);
+
+  {
+    AutoMutex lock(mMutex);
+    mStopping = false;
+  }
+  if (!mDispatcher.joinable()) {
+    mDispatcher = std::thread(&HciEventManager::dispatchTransactionEvents,
+                              this, native->vm);
+  }
 }
 
-void HciEventManager::notifyTransactionListenersOfAid(std::vector<uint8_t> aid,
-                                                      std::vector<uint8_t> data,
-                                                      std::string evtSrc) {
-  if (aid.empty()) {
+/**
+ * Copy a transaction event out of the NFA buffer, and leave it to the
+ * dispatcher thread. The HCI callback runs on the NFA task, which must not
+ * wait for the Java listeners.
+ */
+void HciEventManager::queueTransactionEvent(const uint8_t* aid, size_t aidLen,
+                                            const uint8_t* data,
+                                            size_t dataLen,
+                                            const char* evtSrc) {
+  if (aidLen == 0) {
+    return;
+  }
+
+  AutoMutex lock(mMutex);
+  if (mStopping || !mDispatcher.joinable()) {
+    LOG(WARNING) << StringPrintf("%s: not initialized; drop event", __func__);
+    return;
+  }
+  if (mPendingEvents.size() >= MAX_PENDING_EVENTS) {
+    LOG(ERROR) << StringPrintf("%s: %zu events pending; drop event", __func__,
+                               mPendingEvents.size());
     return;
   }
+  mPendingEvents.emplace_back();
+  TransactionEvent& evt = mPendingEvents.back();
+  evt.bytes.reserve(aidLen + dataLen);
+  evt.bytes.assign(aid, aid + aidLen);
+  evt.bytes.insert(evt.bytes.end(), data, data + dataLen);
+  evt.aidLen = aidLen;
+  evt.evtSrc = evtSrc;
+  mCondVar.notifyOne();
+}
 
+/**
+ * Body of the dispatcher thread: hand the queued events to the Java
+ * listeners, as many as MAX_BATCH_EVENTS per call, until finalize().
+ * The thread stays attached to the VM for its whole life.
+ */
+void HciEventManager::dispatchTransactionEvents(JavaVM* vm) {
   JNIEnv* e = NULL;
-  ScopedAttach attach(mNativeData->vm, &e);
+  ScopedAttach attach(vm, &e);
   CHECK(e);
 
-  ScopedLocalRef<jobject> aidJavaArray(e, e->NewByteArray(aid.size()));
-  CHECK(aidJavaArray.get());
-  e->SetByteArrayRegion((jbyteArray)aidJavaArray.get(), 0, aid.size(),
-                        (jbyte*)&aid[0]);
-  CHECK(!e->ExceptionCheck());
+  std::vector<TransactionEvent> batch;
+  batch.reserve(MAX_BATCH_EVENTS);
+  for (;;) {
+    {
+      AutoMutex lock(mMutex);
+      while (mPendingEvents.empty() && !mStopping) mCondVar.wait(mMutex);
+      // events still pending when stopping are delivered first
+      if (mPendingEvents.empty()) break;
+      while (!mPendingEvents.empty() && batch.size() < MAX_BATCH_EVENTS) {
+        batch.push_back(std::move(mPendingEvents.front()));
+        mPendingEvents.pop_front();
+      }
+    }
+    notifyTransactionListeners(e, batch);
+    batch.clear();
+  }
+  DLOG_IF(INFO, nfc_debug_enabled) << StringPrintf("%s: exit", __func__);
+}
+
+void HciEventManager::notifyTransactionListeners(
+    JNIEnv* e, std::vector<TransactionEvent>& batch) {
+  ScopedLocalRef<jclass> byteArrayClass(e, e->FindClass("[B"));
+  ScopedLocalRef<jclass> stringClass(e, e->FindClass("java/lang/String"));
+  CHECK(byteArrayClass.get() && stringClass.get());
+
+  ScopedLocalRef<jobjectArray> aids(
+      e, e->NewObjectArray(batch.size(), byteArrayClass.get(), NULL));
+  ScopedLocalRef<jobjectArray> data(
+      e, e->NewObjectArray(batch.size(), byteArrayClass.get(), NULL));
+  ScopedLocalRef<jobjectArray> evtSrcs(
+      e, e->NewObjectArray(batch.size(), stringClass.get(), NULL));
+  CHECK(aids.get() && data.get() && evtSrcs.get());
 
-  ScopedLocalRef<jobject> srcJavaString(e, e->NewStringUTF(evtSrc.c_str()));
-  CHECK(srcJavaString.get());
+  for (size_t i = 0; i < batch.size(); i++) {
+    const TransactionEvent& evt = batch[i];
+    const jbyte* bytes = (const jbyte*)evt.bytes.data();
+    size_t dataLen = evt.bytes.size() - evt.aidLen;
 
-  if (data.size() > 0) {
-    ScopedLocalRef<jobject> dataJavaArray(e, e->NewByteArray(data.size()));
-    CHECK(dataJavaArray.get());
-    e->SetByteArrayRegion((jbyteArray)dataJavaArray.get(), 0, data.size(),
-                          (jbyte*)&data[0]);
+    ScopedLocalRef<jbyteArray> aidJavaArray(e, e->NewByteArray(evt.aidLen));
+    CHECK(aidJavaArray.get());
+    e->SetByteArrayRegion(aidJavaArray.get(), 0, evt.aidLen, bytes);
+    e->SetObjectArrayElement(aids.get(), i, aidJavaArray.get());
+
+    // no data is passed as null
+    if (dataLen > 0) {
+      ScopedLocalRef<jbyteArray> dataJavaArray(e, e->NewByteArray(dataLen));
+      CHECK(dataJavaArray.get());
+      e->SetByteArrayRegion(dataJavaArray.get(), 0, dataLen,
+                            bytes + evt.aidLen);
+      e->SetObjectArrayElement(data.get(), i, dataJavaArray.get());
+    }
+
+    ScopedLocalRef<jstring> srcJavaString(e, e->NewStringUTF(evt.evtSrc));
+    CHECK(srcJavaString.get());
+    e->SetObjectArrayElement(evtSrcs.get(), i, srcJavaString.get());
     CHECK(!e->ExceptionCheck());
-    e->CallVoidMethod(mNativeData->manager,
-                      android::gCachedNfcManagerNotifyTransactionListeners,
-                      aidJavaArray.get(), dataJavaArray.get(),
-                      srcJavaString.get());
-  } else {
-    e->CallVoidMethod(mNativeData->manager,
-                      android::gCachedNfcManagerNotifyTransactionListeners,
-                      aidJavaArray.get(), NULL, srcJavaString.get());
   }
-}
 
-/**
- * BerTlv has the following format:
- *
- * byte1 byte2 byte3 byte4 byte5 byte6
- * 00-7F   -    -     -     -     -
- * 81    00-FF  -     -     -     -
- * 82    0000-FFFF    -     -     -
- * 83      000000-FFFFFF    -     -
- * 84      00000000-FFFFFFFF      -
- */
-std::vector<uint8_t> HciEventManager::getDataFromBerTlv(
-    std::vector<uint8_t> berTlv) {
-  if (berTlv.empty()) {
-    return std::vector<uint8_t>();
-  }
-  size_t lengthTag = berTlv[0];
-  DLOG_IF(INFO, nfc_debug_enabled) << "decodeBerTlv: berTlv[0]=" << berTlv[0];
-
-  /* As per ISO/IEC 7816, read the first byte to determine the length and
-   * the start index accordingly
-   */
-  if (lengthTag < 0x80 && berTlv.size() == (lengthTag + 1)) {
-    return std::vector<uint8_t>(berTlv.begin() + 1, berTlv.end());
-  } else if (lengthTag == 0x81 && berTlv.size() > 2) {
-    size_t length = berTlv[1];
-    if ((length + 2) == berTlv.size()) {
-      return std::vector<uint8_t>(berTlv.begin() + 2, berTlv.end());
-    }
-  } else if (lengthTag == 0x82 && berTlv.size() > 3) {
-    size_t length = ((berTlv[1] << 8) | berTlv[2]);
-    if ((length + 3) == berTlv.size()) {
-      return std::vector<uint8_t>(berTlv.begin() + 3, berTlv.end());
-    }
-  } else if (lengthTag == 0x83 && berTlv.size() > 4) {
-    size_t length = (berTlv[1] << 16) | (berTlv[2] << 8) | berTlv[3];
-    if ((length + 4) == berTlv.size()) {
-      return std::vector<uint8_t>(berTlv.begin() + 4, berTlv.end());
-    }
-  } else if (lengthTag == 0x84 && berTlv.size() > 5) {
-#if(NXP_EXTNS == TRUE)
-    size_t length = ((size_t)(berTlv[1] << 24) | (size_t)(berTlv[2] << 16) |
-                     (size_t)(berTlv[3] << 8) | (size_t)berTlv[4]);
-#else
-    size_t length =
-        (berTlv[1] << 24) | (berTlv[2] << 16) | (berTlv[3] << 8) | berTlv[4];
-#endif
-    if ((length + 5) == berTlv.size()) {
-      return std::vector<uint8_t>(berTlv.begin() + 5, berTlv.end());
-    }
+  DLOG_IF(INFO, nfc_debug_enabled)
+      << StringPrintf("%s: %zu events", __func__, batch.size());
+  e->CallVoidMethod(mNativeData->manager,
+                    android::gCachedNfcManagerNotifyTransactionListeners,
+                    aids.get(), data.get(), evtSrcs.get());
+  if (e->ExceptionCheck()) {
+    // the thread outlives this call; do not leave the exception pending
+    e->ExceptionClear();
+    LOG(ERROR) << StringPrintf("%s: fail notify", __func__);
   }
-  LOG(ERROR) << "Error in TLV length encoding!";
-  return std::vector<uint8_t>();
 }
 
 void HciEventManager::nfaHciCallback(tNFA_HCI_EVT event,
                                      tNFA_HCI_EVT_DATA* eventData) {
+  NFC_TRACE_INSTANT("nfa", "hciEventCallback", event);
   if (eventData == nullptr) {
     return;
   }
@@ -178,7 +213,7 @@ void HciEventManager::nfaHciCallback(tNFA_HCI_EVT event,
       "event=%d code=%d pipe=%d len=%d", event, eventData->rcvd_evt.evt_code,
       eventData->rcvd_evt.pipe, eventData->rcvd_evt.evt_len);
 
-  std::string evtSrc;
+  const char* evtSrc;
   if (eventData->rcvd_evt.pipe == sEsePipe) {
     evtSrc = "eSE1";
   } else if (eventData->rcvd_evt.pipe == sSimPipe) {
@@ -206,25 +241,40 @@ void HciEventManager::nfaHciCallback(tNFA_HCI_EVT event,
     return;
   }
 
-  uint32_t aid_len = event_buff[1];
-  if (aid_len >= (event_buff_len - 1)) {
+  // AID, tag 0x81; then parameters, tag 0x82
+  BerTlvReader reader(event_buff, event_buff_len);
+  BerTlv aid;
+  if (!reader.next(aid)) {
     android_errorWriteLog(0x534e4554, "181346545");
-    LOG(ERROR) << StringPrintf("error: aidlen(%d) is too big", aid_len);
+    LOG(ERROR) << StringPrintf("error: AID TLV malformed; length octet 0x%02x",
+                               event_buff[1]);
     return;
   }
 
-  std::vector<uint8_t> aid(event_buff + 2, event_buff + aid_len + 2);
-  int32_t berTlvStart = aid_len + 2 + 1;
-  int32_t berTlvLen = event_buff_len - berTlvStart;
-  std::vector<uint8_t> data;
-  if (berTlvLen > 0 && event_buff[2 + aid_len] == 0x82) {
-    std::vector<uint8_t> berTlv(event_buff + berTlvStart,
-                                event_buff + event_buff_len);
-    // BERTLV decoding here, to support extended data length for params.
-    data = getInstance().getDataFromBerTlv(berTlv);
+  const uint8_t* data = nullptr;
+  size_t dataLen = 0;
+  BerTlv params;
+  // BERTLV decoding here, to support extended data length for params.
+  if (reader.next(params) && params.tag() == 0x82 &&
+      reader.remaining() == 0) {
+    data = params.value();
+    dataLen = params.length();
+  } else if (reader.isMalformed()) {
+    LOG(ERROR) << "Error in TLV length encoding!";
   }
 
-  getInstance().notifyTransactionListenersOfAid(aid, data, evtSrc);
+  getInstance().queueTransactionEvent(aid.value(), aid.length(), data, dataLen,
+                                     evtSrc);
 }
 
-void HciEventManager::finalize() { mNativeData = NULL; }
+void HciEventManager::finalize() {
+  {
+    AutoMutex lock(mMutex);
+    mStopping = true;
+    mCondVar.notifyOne();
+  }
+  if (mDispatcher.joinable()) {
+    mDispatcher.join();
+  }
+  mNativeData = NULL;
+}
@@ -33,6 +33,11 @@
 ******************************************************************************/
 #pragma once
 
+#include <deque>
+#include <thread>
+#include <vector>
+#include "CondVar.h"
+#include "Mutex.h"
 #include "NfcJniUtil.h"
 #include "nfa_hci_api.h"
 #include "nfa_hci_defs.h"
@@ -53,11 +58,30 @@ class HciEventManager {
   static const uint8_t OFF_HOST_DEFAULT_PIPE_ID = 0x23;
 #endif
 
+  // bounds the events waiting for the Java listeners
+  static const size_t MAX_PENDING_EVENTS = 64;
+  // most events handed to the Java listeners in one call
+  static const size_t MAX_BATCH_EVENTS = 16;
+
+  struct TransactionEvent {
+    std::vector<uint8_t> bytes;  // AID, then data
+    size_t aidLen;
+    const char* evtSrc;
+  };
+
+  Mutex mMutex;  // guards the members below
+  CondVar mCondVar;
+  std::deque<TransactionEvent> mPendingEvents;
+  bool mStopping;
+  std::thread mDispatcher;
+
   HciEventManager();
-  std::vector<uint8_t> getDataFromBerTlv(std::vector<uint8_t> berTlv);
-  void notifyTransactionListenersOfAid(std::vector<uint8_t> aid,
-                                       std::vector<uint8_t> data,
-                                       std::string evtSrc);
+  void queueTransactionEvent(const uint8_t* aid, size_t aidLen,
+                             const uint8_t* data, size_t dataLen,
+                             const char* evtSrc);
+  void dispatchTransactionEvents(JavaVM* vm);
+  void notifyTransactionListeners(JNIEnv* e,
+                                  std::vector<TransactionEvent>& batch);
 #if(NXP_EXTNS != TRUE)
   static void nfaHciCallback(tNFA_HCI_EVT event, tNFA_HCI_EVT_DATA* eventData);
 #endif
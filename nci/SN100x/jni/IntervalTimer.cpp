@@ -35,71 +35,359 @@
 
 /*
  *  Asynchronous interval timer.
+ *
+ *  All timers share one hierarchical timer wheel (4 levels of 64 slots, 1 ms
+ *  per tick) served by a single thread, so arming and cancelling a timer is
+ *  O(1) and does not create a kernel timer per instance. Expired callbacks
+ *  are queued to a fixed pool of DISPATCH_WORKERS threads, so one blocking
+ *  callback delays neither the wheel nor the other callbacks. A callback
+ *  that blocks for long should hand its work to a worker of its own.
  */
 
 #include "IntervalTimer.h"
 
 #include <android-base/stringprintf.h>
 #include <base/logging.h>
+#include <deque>
+#include <thread>
+#include <vector>
+#include "CondVar.h"
+#include "Mutex.h"
 
 using android::base::StringPrintf;
 
-IntervalTimer::IntervalTimer() {
-  mTimerId = 0;
-  mCb = NULL;
+namespace {
+const int WHEEL_BITS = 6;
+const int WHEEL_SIZE = 1 << WHEEL_BITS;
+const uint64_t WHEEL_MASK = WHEEL_SIZE - 1;
+const int WHEEL_LEVELS = 4;
+const uint64_t WHEEL_SPAN = 1ULL << (WHEEL_BITS * WHEEL_LEVELS);
+const int DISPATCH_WORKERS = 2;  // threads calling back expired timers
+
+uint64_t monotonicMs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
 }
+}  // namespace
 
-bool IntervalTimer::set(int ms, TIMER_FUNC cb) {
-  if (mTimerId == 0) {
-    if (cb == NULL) return false;
+class TimerWheel {
+ public:
+  typedef std::vector<IntervalTimer::TIMER_FUNC> ExpiredList;
+
+  static TimerWheel& getInstance();
+  void arm(IntervalTimer* timer, int ms);
+  void cancel(IntervalTimer* timer);
+
+ private:
+  TimerWheel();
+  void place(IntervalTimer* timer);
+  void unlink(IntervalTimer* timer);
+  void cascade(int level);
+  void advance(uint64_t now, ExpiredList& expired);
+  long nextWaitMs(uint64_t now);
+  void dispatch(const ExpiredList& expired);
+  void dispatchWorker();
+  void run();
+
+  Mutex mMutex;  // guards all members below and the wheel links of timers
+  CondVar mCondVar;
+  IntervalTimer* mSlots[WHEEL_LEVELS][WHEEL_SIZE];
+  int mPending;   // number of armed timers
+  uint64_t mNow;  // next tick to be processed
+
+  Mutex mDispatchMutex;  // guards mDispatchQueue
+  CondVar mDispatchCondVar;
+  std::deque<IntervalTimer::TIMER_FUNC> mDispatchQueue;
+};
+
+/*******************************************************************************
+**
+** Function:        getInstance
+**
+** Description:     Get the wheel, starting its thread on first use. The wheel
+**                  is never destroyed so that timers with static storage can
+**                  be killed during exit.
+**
+** Returns:         Reference to the wheel.
+**
+*******************************************************************************/
+TimerWheel& TimerWheel::getInstance() {
+  static TimerWheel* sWheel = new TimerWheel();
+  return *sWheel;
+}
+
+TimerWheel::TimerWheel() : mPending(0), mNow(monotonicMs()) {
+  for (int i = 0; i < WHEEL_LEVELS; i++) {
+    for (int j = 0; j < WHEEL_SIZE; j++) mSlots[i][j] = NULL;
+  }
+  for (int i = 0; i < DISPATCH_WORKERS; i++)
+    std::thread(&TimerWheel::dispatchWorker, this).detach();
+  std::thread(&TimerWheel::run, this).detach();
+}
+
+/*******************************************************************************
+**
+** Function:        arm
+**
+** Description:     (Re)start a timer.
+**                  timer: Timer to start.
+**                  ms: Milliseconds until expiry.
+**
+** Returns:         None
+**
+*******************************************************************************/
+void TimerWheel::arm(IntervalTimer* timer, int ms) {
+  AutoMutex lock(mMutex);
+  uint64_t now = monotonicMs();
+  if (timer->mArmed) unlink(timer);
+  if (mPending == 0) mNow = now;  // nothing pending; skip the idle ticks
+  // round up so that the timer never fires early
+  timer->mExpiry = now + (ms > 0 ? ms : 0) + 1;
+  place(timer);
+  mCondVar.notifyOne();
+}
+
+/*******************************************************************************
+**
+** Function:        cancel
+**
+** Description:     Stop a timer if it is armed.
+**                  timer: Timer to stop.
+**
+** Returns:         None
+**
+*******************************************************************************/
+void TimerWheel::cancel(IntervalTimer* timer) {
+  AutoMutex lock(mMutex);
+  if (timer->mArmed) unlink(timer);
+}
+
+/*******************************************************************************
+**
+** Function:        place
+**
+** Description:     Link a timer into the slot matching its expiry. Timers
+**                  beyond the wheel span wait in the last slot of the top
+**                  level and are placed again when it cascades.
+**                  timer: Timer to link.
+**
+** Returns:         None
+**
+*******************************************************************************/
+void TimerWheel::place(IntervalTimer* timer) {
+  uint64_t expiry = timer->mExpiry < mNow ? mNow : timer->mExpiry;
+  uint64_t delta = expiry - mNow;
+  if (delta >= WHEEL_SPAN) {
+    delta = WHEEL_SPAN - 1;
+    expiry = mNow + delta;
+  }
+
+  int level = 0;
+  while (level < WHEEL_LEVELS - 1 &&
+         delta >= (1ULL << (WHEEL_BITS * (level + 1)))) {
+    level++;
+  }
+  IntervalTimer** slot =
+      &mSlots[level][(expiry >> (WHEEL_BITS * level)) & WHEEL_MASK];
+  timer->mNext = *slot;
+  if (timer->mNext != NULL) timer->mNext->mPprev = &timer->mNext;
+  timer->mPprev = slot;
+  *slot = timer;
+  timer->mArmed = true;
+  mPending++;
+}
+
+void TimerWheel::unlink(IntervalTimer* timer) {
+  *timer->mPprev = timer->mNext;
+  if (timer->mNext != NULL) timer->mNext->mPprev = timer->mPprev;
+  timer->mNext = NULL;
+  timer->mPprev = NULL;
+  timer->mArmed = false;
+  mPending--;
+}
 
-    if (!create(cb)) return false;
+/*******************************************************************************
+**
+** Function:        cascade
+**
+** Description:     Move the timers of the current slot of a level down to
+**                  the lower levels.
+**                  level: Level to cascade, 1 or higher.
+**
+** Returns:         None
+**
+*******************************************************************************/
+void TimerWheel::cascade(int level) {
+  IntervalTimer** slot =
+      &mSlots[level][(mNow >> (WHEEL_BITS * level)) & WHEEL_MASK];
+  IntervalTimer* timer = *slot;
+  *slot = NULL;
+  while (timer != NULL) {
+    IntervalTimer* next = timer->mNext;
+    timer->mArmed = false;
+    mPending--;
+    place(timer);
+    timer = next;
   }
-  if (cb != mCb) {
-    kill();
-    if (!create(cb)) return false;
+}
+
+/*******************************************************************************
+**
+** Function:        advance
+**
+** Description:     Process all ticks up to now and collect expired timers.
+**                  now: Current tick.
+**                  expired: Receives callbacks of expired timers.
+**
+** Returns:         None
+**
+*******************************************************************************/
+void TimerWheel::advance(uint64_t now, ExpiredList& expired) {
+  while (mNow <= now) {
+    if (mPending == 0) {
+      mNow = now + 1;
+      break;
+    }
+    uint64_t index = mNow & WHEEL_MASK;
+    if (index == 0) {
+      for (int level = 1; level < WHEEL_LEVELS; level++) {
+        cascade(level);
+        if (((mNow >> (WHEEL_BITS * level)) & WHEEL_MASK) != 0) break;
+      }
+    }
+    IntervalTimer* timer = mSlots[0][index];
+    mSlots[0][index] = NULL;
+    while (timer != NULL) {
+      IntervalTimer* next = timer->mNext;
+      timer->mNext = NULL;
+      timer->mPprev = NULL;
+      timer->mArmed = false;
+      mPending--;
+      // copy the callback; the timer may be gone once the lock is dropped
+      if (timer->mCb != NULL) expired.push_back(timer->mCb);
+      timer = next;
+    }
+    mNow++;
   }
+}
 
-  int stat = 0;
-  struct itimerspec ts;
-  ts.it_value.tv_sec = ms / 1000;
-  ts.it_value.tv_nsec = (ms % 1000) * 1000000;
+/*******************************************************************************
+**
+** Function:        nextWaitMs
+**
+** Description:     Compute how long the thread may sleep: until the next
+**                  occupied slot of the lowest level, or until the next
+**                  cascade.
+**                  now: Current tick.
+**
+** Returns:         Milliseconds to sleep; -1 to sleep until notified.
+**
+*******************************************************************************/
+long TimerWheel::nextWaitMs(uint64_t now) {
+  if (mPending == 0) return -1;
+  uint64_t next = (mNow | WHEEL_MASK) + 1;
+  for (uint64_t tick = mNow; tick < next; tick++) {
+    if (mSlots[0][tick & WHEEL_MASK] != NULL) {
+      next = tick;
+      break;
+    }
+  }
+  return (next > now) ? (long)(next - now) : 0;
+}
 
-  ts.it_interval.tv_sec = 0;
-  ts.it_interval.tv_nsec = 0;
+/*******************************************************************************
+**
+** Function:        dispatch
+**
+** Description:     Queue callbacks to the dispatch workers.
+**                  expired: Callbacks of expired timers, in expiry order.
+**
+** Returns:         None
+**
+*******************************************************************************/
+void TimerWheel::dispatch(const ExpiredList& expired) {
+  AutoMutex lock(mDispatchMutex);
+  for (IntervalTimer::TIMER_FUNC cb : expired) {
+    mDispatchQueue.push_back(cb);
+    mDispatchCondVar.notifyOne();
+  }
+}
 
-  stat = timer_settime(mTimerId, 0, &ts, 0);
-  if (stat == -1) LOG(ERROR) << StringPrintf("fail set timer");
-  return stat == 0;
+/*******************************************************************************
+**
+** Function:        dispatchWorker
+**
+** Description:     Call back expired timers from the queue, for ever.
+**
+** Returns:         None
+**
+*******************************************************************************/
+void TimerWheel::dispatchWorker() {
+  union sigval value;
+  value.sival_ptr = NULL;
+  mDispatchMutex.lock();
+  for (;;) {
+    while (mDispatchQueue.empty()) mDispatchCondVar.wait(mDispatchMutex);
+    IntervalTimer::TIMER_FUNC cb = mDispatchQueue.front();
+    mDispatchQueue.pop_front();
+    mDispatchMutex.unlock();
+    cb(value);
+    mDispatchMutex.lock();
+  }
+}
+
+void TimerWheel::run() {
+  ExpiredList expired;
+  mMutex.lock();
+  for (;;) {
+    uint64_t now = monotonicMs();
+    advance(now, expired);
+    if (!expired.empty()) {
+      mMutex.unlock();
+      dispatch(expired);
+      expired.clear();
+      mMutex.lock();
+      continue;
+    }
+    long waitMs = nextWaitMs(now);
+    if (waitMs < 0) {
+      mCondVar.wait(mMutex);
+    } else if (waitMs > 0) {
+      mCondVar.wait(mMutex, waitMs);
+    }
+  }
+}
+
+IntervalTimer::IntervalTimer()
+    : mCb(NULL), mNext(NULL), mPprev(NULL), mExpiry(0), mArmed(false) {}
+
+bool IntervalTimer::set(int ms, TIMER_FUNC cb) {
+  if (cb != NULL) {
+    if (cb != mCb && !create(cb)) return false;
+  } else if (mCb == NULL) {
+    return false;
+  }
+
+  TimerWheel::getInstance().arm(this, ms);
+  return true;
 }
 
 IntervalTimer::~IntervalTimer() { kill(); }
 
 void IntervalTimer::kill() {
-  if (mTimerId == 0) return;
+  if (mCb == NULL) return;
 
-  timer_delete(mTimerId);
-  mTimerId = 0;
+  TimerWheel::getInstance().cancel(this);
   mCb = NULL;
 }
 
 bool IntervalTimer::create(TIMER_FUNC cb) {
-  struct sigevent se;
-  int stat = 0;
-
-  /*
-   * Set the sigevent structure to cause the signal to be
-   * delivered by creating a new thread.
-   */
-  se.sigev_notify = SIGEV_THREAD;
-  se.sigev_value.sival_ptr = &mTimerId;
-  se.sigev_notify_function = cb;
-  se.sigev_notify_attributes = NULL;
-#if(NXP_EXTNS == TRUE)
-  se.sigev_signo = 0;
-#endif
+  if (cb == NULL) {
+    LOG(ERROR) << StringPrintf("fail create timer");
+    return false;
+  }
+  kill();
   mCb = cb;
-  stat = timer_create(CLOCK_MONOTONIC, &se, &mTimerId);
-  if (stat == -1) LOG(ERROR) << StringPrintf("fail create timer");
-  return stat == 0;
+  return true;
 }
@@ -18,9 +18,21 @@
  *  Asynchronous interval timer.
  */
 
+#pragma once
+#include <signal.h>
+#include <stdint.h>
 #include <time.h>
 
+/*
+ *  Timers are one-shot entries of a single process-wide timer wheel.
+ *  Expiries call back on a small fixed pool of threads, so a callback may
+ *  block briefly without delaying other timers; long work belongs on a
+ *  thread of the caller's own. The sigval carries no data; a timer may be
+ *  killed or destroyed while its callback runs.
+ */
 class IntervalTimer {
+  friend class TimerWheel;
+
  public:
   typedef void (*TIMER_FUNC)(union sigval);
 
@@ -31,6 +43,9 @@ class IntervalTimer {
   bool create(TIMER_FUNC);
 
  private:
-  timer_t mTimerId;
   TIMER_FUNC mCb;
+  IntervalTimer* mNext;    // next entry of the wheel slot while armed
+  IntervalTimer** mPprev;  // link pointing at this entry
+  uint64_t mExpiry;  // absolute expiry, in wheel ticks
+  bool mArmed;
 };
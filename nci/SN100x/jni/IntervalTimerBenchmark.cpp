@@ -0,0 +1,83 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+#include "IntervalTimer.h"
+
+namespace {
+void noopCb(union sigval) {}
+
+// arming and disarming a timer, as every transceive and presence check does
+void BM_IntervalTimerSetKill(benchmark::State& state) {
+  IntervalTimer timer;
+  for (auto _ : state) {
+    timer.set(1000, noopCb);
+    timer.kill();
+  }
+}
+BENCHMARK(BM_IntervalTimerSetKill);
+
+// the same with other timers armed: the cost should not grow with them
+void BM_IntervalTimerSetKillLoaded(benchmark::State& state) {
+  std::vector<IntervalTimer> armed(state.range(0));
+  for (size_t i = 0; i < armed.size(); i++)
+    armed[i].set(10000 + (int)i * 7, noopCb);
+  IntervalTimer timer;
+  for (auto _ : state) {
+    timer.set(1000, noopCb);
+    timer.kill();
+  }
+  for (IntervalTimer& t : armed) t.kill();
+}
+BENCHMARK(BM_IntervalTimerSetKillLoaded)->Arg(16)->Arg(256)->Arg(4096);
+
+typedef std::chrono::steady_clock Clock;
+std::mutex sFiredMutex;
+std::condition_variable sFiredCv;
+bool sFired = false;
+Clock::time_point sFiredAt;
+
+void firedCb(union sigval) {
+  std::lock_guard<std::mutex> lock(sFiredMutex);
+  sFiredAt = Clock::now();
+  sFired = true;
+  sFiredCv.notify_one();
+}
+
+// how late a timer of range(0) ms calls back, with range(1) other timers
+// expiring around it; reported in us as jitter_mean and jitter_max
+void BM_IntervalTimerExpiryJitter(benchmark::State& state) {
+  const int ms = state.range(0);
+  std::vector<IntervalTimer> others(state.range(1));
+  double sumUs = 0, maxUs = 0;
+  for (auto _ : state) {
+    for (size_t i = 0; i < others.size(); i++)
+      others[i].set(1 + (int)(i % (2 * ms)), noopCb);
+    IntervalTimer timer;
+    std::unique_lock<std::mutex> lock(sFiredMutex);
+    sFired = false;
+    Clock::time_point due = Clock::now() + std::chrono::milliseconds(ms);
+    timer.set(ms, firedCb);
+    sFiredCv.wait(lock, [] { return sFired; });
+    double lateUs =
+        std::chrono::duration<double, std::micro>(sFiredAt - due).count();
+    sumUs += lateUs;
+    maxUs = std::max(maxUs, lateUs);
+  }
+  for (IntervalTimer& t : others) t.kill();
+  state.counters["jitter_mean_us"] = sumUs / state.iterations();
+  state.counters["jitter_max_us"] = maxUs;
+}
+BENCHMARK(BM_IntervalTimerExpiryJitter)
+    ->Args({5, 0})
+    ->Args({20, 0})
+    ->Args({100, 0})
+    ->Args({20, 256})
+    ->Iterations(50)
+    ->UseRealTime();
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,93 @@
+#include <gtest/gtest.h>
+
+#include <time.h>
+#include <unistd.h>
+#include <atomic>
+#include "IntervalTimer.h"
+
+namespace {
+std::atomic<int> sFired;
+std::atomic<uint64_t> sFiredAt[3];
+IntervalTimer sRearmTimer;
+
+uint64_t nowMs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+void countCb(union sigval) { sFired++; }
+void firstCb(union sigval) { sFiredAt[0] = nowMs(); }
+void secondCb(union sigval) { sFiredAt[1] = nowMs(); }
+void thirdCb(union sigval) { sFiredAt[2] = nowMs(); }
+void rearmCb(union sigval) {
+  if (++sFired < 3) sRearmTimer.set(5, rearmCb);
+}
+void blockingCb(union sigval) { sleep(1); }
+
+bool waitFor(int count, int ms) {
+  for (int i = 0; i < ms && sFired < count; i++) usleep(1000);
+  return sFired >= count;
+}
+}  // namespace
+
+class IntervalTimerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    sFired = 0;
+    for (auto& at : sFiredAt) at = 0;
+  }
+};
+
+TEST_F(IntervalTimerTest, CascadedTimersFireInOrderAndNotEarly) {
+  IntervalTimer first, second, third;
+  uint64_t start = nowMs();
+  // level 0 and level 1 timers; level 1 ones cascade down to expire
+  ASSERT_TRUE(third.set(300, thirdCb));
+  ASSERT_TRUE(first.set(20, firstCb));
+  ASSERT_TRUE(second.set(100, secondCb));
+  for (int i = 0; i < 1000 && sFiredAt[2] == 0; i++) usleep(1000);
+
+  ASSERT_NE(0u, sFiredAt[0].load());
+  ASSERT_NE(0u, sFiredAt[1].load());
+  ASSERT_NE(0u, sFiredAt[2].load());
+  EXPECT_GE(sFiredAt[0] - start, 20u);
+  EXPECT_GE(sFiredAt[1] - start, 100u);
+  EXPECT_GE(sFiredAt[2] - start, 300u);
+  EXPECT_LE(sFiredAt[0], sFiredAt[1]);
+  EXPECT_LE(sFiredAt[1], sFiredAt[2]);
+}
+
+TEST_F(IntervalTimerTest, KilledTimerDoesNotFire) {
+  IntervalTimer timer;
+  ASSERT_TRUE(timer.set(20, countCb));
+  timer.kill();
+  usleep(60000);
+  EXPECT_EQ(0, sFired);
+}
+
+TEST_F(IntervalTimerTest, DestroyWhileExpiring) {
+  // destroy timers around their expiry; the wheel must not touch them
+  for (int i = 0; i < 200; i++) {
+    IntervalTimer* timer = new IntervalTimer();
+    ASSERT_TRUE(timer->set(1, countCb));
+    usleep(i % 3 * 500);
+    delete timer;
+  }
+  usleep(20000);
+  EXPECT_LE(sFired, 200);
+}
+
+TEST_F(IntervalTimerTest, RearmFromCallback) {
+  ASSERT_TRUE(sRearmTimer.set(5, rearmCb));
+  EXPECT_TRUE(waitFor(3, 500));
+  usleep(20000);
+  EXPECT_EQ(3, sFired);
+}
+
+TEST_F(IntervalTimerTest, BlockingCallbackDoesNotDelayOthers) {
+  IntervalTimer blocking, other;
+  ASSERT_TRUE(blocking.set(1, blockingCb));
+  ASSERT_TRUE(other.set(20, countCb));
+  EXPECT_TRUE(waitFor(1, 500));
+}
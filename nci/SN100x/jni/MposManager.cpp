@@ -351,14 +351,17 @@ void MposManager::notifyEEReaderEvent (uint8_t evt, uint8_t status) {
 **
 ** Description:     Decodes the HCI_TRANSACTION_EVT to check for
 **                  reader restart and POWER_OFF evt
+**                  params: Parameters TLV of the event; empty if none.
 **
 ** Returns:         OK/FAILED.
 **
 *******************************************************************************/
-tNFA_STATUS MposManager::validateHCITransactionEventParams(uint8_t *aData, int32_t aDatalen)
+tNFA_STATUS MposManager::validateHCITransactionEventParams(const BerTlv& params)
 {
   tNFA_STATUS status = NFA_STATUS_OK;
   uint8_t Event, Version, Code;
+  const uint8_t* aData = params.value();
+  size_t aDatalen = params.length();
   if(aData != NULL && aDatalen >= 3) {
     Event = *aData++;
     Version = *aData++;
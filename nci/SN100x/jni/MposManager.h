@@ -16,6 +16,7 @@
  *
  ******************************************************************************/
 #pragma once
+#include "BerTlv.h"
 #include "Mutex.h"
 #include "SyncEvent.h"
 #include "IntervalTimer.h"
@@ -167,11 +168,12 @@ public:
   **
   ** Description:     Decodes the HCI_TRANSACTION_EVT to check for
   **                  reader restart and POWER_OFF evt
+  **                  params: Parameters TLV of the event; empty if none.
   **
   ** Returns:         OK/FAILED.
   **
   *******************************************************************************/
-  tNFA_STATUS validateHCITransactionEventParams(uint8_t *aData, int32_t aDatalen);
+  tNFA_STATUS validateHCITransactionEventParams(const BerTlv& params);
 
 private:
   MposManager(); // Default Constructor
@@ -50,6 +50,8 @@
 #include <nativehelper/ScopedUtfChars.h>
 #include <semaphore.h>
 
+#include "ConfigParamCache.h"
+#include "ConfigWriter.h"
 #include "HciEventManager.h"
 #include "JavaClassConstants.h"
 #include "NfcAdaptation.h"
@@ -57,9 +59,12 @@
 #include "NfcDta.h"
 #endif /* DTA_ENABLED */
 #include "NfcJniUtil.h"
+#include "NfcStatsUtil.h"
 #include "NfcTag.h"
+#include "NfcTrace.h"
 #include "PowerSwitch.h"
 #include "RoutingManager.h"
+#include "StartupGraph.h"
 #include "SyncEvent.h"
 #if(NXP_EXTNS == TRUE)
 #include "DwpChannel.h"
@@ -430,6 +435,7 @@ static void nfaConnectionCallback(uint8_t connEvent,
   uint8_t cur_more_val = 0x00;
   NfcTagExtns& nfcTagExtns = NfcTagExtns::getInstance();
 #endif
+  NFC_TRACE_INSTANT("nfa", "connCallback", connEvent);
   DLOG_IF(INFO, nfc_debug_enabled)
       << StringPrintf("%s: event= %u", __func__, connEvent);
 #if (NXP_EXTNS == TRUE)
@@ -461,6 +467,8 @@ static void nfaConnectionCallback(uint8_t connEvent,
       DLOG_IF(INFO, nfc_debug_enabled)
           << StringPrintf("%s: NFA_RF_DISCOVERY_STARTED_EVT: status = %u",
                           __func__, eventData->status);
+      // NFA sets the RF parameters without NFA_DM_SET_CONFIG_EVT
+      ConfigParamCache::getInstance().invalidateRfDiscovery();
 
       SyncEventGuard guard(sNfaEnableDisablePollingEvent);
       sNfaEnableDisablePollingEvent.notifyOne();
@@ -471,6 +479,7 @@ static void nfaConnectionCallback(uint8_t connEvent,
       DLOG_IF(INFO, nfc_debug_enabled)
           << StringPrintf("%s: NFA_RF_DISCOVERY_STOPPED_EVT: status = %u",
                           __func__, eventData->status);
+      ConfigParamCache::getInstance().invalidateRfDiscovery();
 
       gActivated = false;
 #if (NXP_EXTNS == TRUE)
@@ -954,7 +963,8 @@ static jboolean nfcManager_initNativeStruc(JNIEnv* e, jobject o) {
       e->GetMethodID(cls.get(), "notifyCoreGenericError", "(I)V");
 #endif
   gCachedNfcManagerNotifyTransactionListeners = e->GetMethodID(
-      cls.get(), "notifyTransactionListeners", "([B[BLjava/lang/String;)V");
+      cls.get(), "notifyTransactionListeners",
+      "([[B[[B[Ljava/lang/String;)V");
   if (nfc_jni_cache_object(e, gNativeNfcTagClassName, &(nat->cached_NfcTag)) ==
       -1) {
     LOG(ERROR) << StringPrintf("%s: fail cache NativeNfcTag", __func__);
@@ -1002,6 +1012,7 @@ void nfaDeviceManagementCallback(uint8_t dmEvent,
           "%s: NFA_DM_ENABLE_EVT; status=0x%X", __func__, eventData->status);
       sIsNfaEnabled = eventData->status == NFA_STATUS_OK;
       sIsDisabling = false;
+      ConfigParamCache::getInstance().invalidate();
       sNfaEnableEvent.notifyOne();
     } break;
 
@@ -1019,6 +1030,8 @@ void nfaDeviceManagementCallback(uint8_t dmEvent,
       DLOG_IF(INFO, nfc_debug_enabled)
           << StringPrintf("%s: NFA_DM_SET_CONFIG_EVT", __func__);
       {
+        // the event does not tell which parameters were set
+        ConfigParamCache::getInstance().invalidate();
         SyncEventGuard guard(gNfaSetConfigEvent);
         gNfaSetConfigEvent.notifyOne();
       }
@@ -1034,6 +1047,7 @@ void nfaDeviceManagementCallback(uint8_t dmEvent,
           gCurrentConfigLen = eventData->get_config.tlv_size;
           memcpy(gConfig, eventData->get_config.param_tlvs,
                  eventData->get_config.tlv_size);
+          ConfigParamCache::getInstance().update(gConfig, gCurrentConfigLen);
         } else {
           LOG(ERROR) << StringPrintf("%s: NFA_DM_GET_CONFIG failed", __func__);
           gCurrentConfigLen = 0;
@@ -1053,6 +1067,9 @@ void nfaDeviceManagementCallback(uint8_t dmEvent,
       }
       SecureElement::getInstance().notifyRfFieldEvent (
                     eventData->rf_field.rf_field_status == NFA_DM_RF_FIELD_ON);
+      // a reader may write the T4T NFCEE
+      if (eventData->rf_field.rf_field_status == NFA_DM_RF_FIELD_ON)
+        NativeT4tNfcee::getInstance().invalidateCache();
 #else
 if (!sP2pActive && eventData->rf_field.status == NFA_STATUS_OK) {
         struct nfc_jni_native_data* nat = getNative(NULL, NULL);
@@ -1080,6 +1097,10 @@ if (!sP2pActive && eventData->rf_field.status == NFA_STATUS_OK) {
       else if (dmEvent == NFA_DM_NFCC_TRANSPORT_ERR_EVT)
         LOG(ERROR) << StringPrintf("%s: NFA_DM_NFCC_TRANSPORT_ERR_EVT; abort",
                                    __func__);
+      ConfigParamCache::getInstance().invalidate();
+#if (NXP_EXTNS == TRUE)
+      NativeT4tNfcee::getInstance().invalidateCache();
+#endif
       struct nfc_jni_native_data* nat = getNative(NULL, NULL);
       if (recovery_option && nat != NULL) {
         JNIEnv* e = NULL;
@@ -1379,6 +1400,7 @@ static void nfcFwUpdateStatusCallback(uint8_t status) {
 *******************************************************************************/
 static jboolean nfcManager_routeAid(JNIEnv* e, jobject, jbyteArray aid,
                                     jint route, jint aidInfo, jint power) {
+  NFC_TRACE_SCOPE("routing", "routeAid");
   uint8_t* buf;
   size_t bufLen;
 #if (NXP_EXTNS == TRUE)
@@ -1458,6 +1480,27 @@ static jboolean nfcManager_unrouteAid(JNIEnv* e, jobject, jbyteArray aid) {
   return RoutingManager::getInstance().removeAidRouting(buf, bufLen);
 }
 
+/*******************************************************************************
+**
+** Function:        nfcManager_beginRoutingTransaction
+**
+** Description:     Let routeAid and unrouteAid return without waiting for
+**                  the controller, until the next commitRouting.
+**                  e: JVM environment.
+**                  o: Java object.
+**
+** Returns:         True if ok.
+**
+*******************************************************************************/
+static jboolean nfcManager_beginRoutingTransaction(JNIEnv*, jobject) {
+#if (NXP_EXTNS == TRUE)
+  if (sIsDisabling || !sIsNfaEnabled) {
+    return false;
+  }
+#endif
+  return RoutingManager::getInstance().beginAidTransaction();
+}
+
 /*******************************************************************************
 **
 ** Function:        nfcManager_commitRouting
@@ -1478,7 +1521,10 @@ static jboolean nfcManager_commitRouting(JNIEnv* e, jobject) {
   if (sIsDisabling || !sIsNfaEnabled) {
     return status;
   }
-  if (sRfEnabled) {
+  // with nothing to send, card emulation keeps running
+  uint64_t rfStopMicros = 0;
+  if (RoutingManager::getInstance().hasRoutingChanges() && sRfEnabled) {
+    rfStopMicros = NfcStatsUtil::nowMicros();
     /*Stop RF discovery to reconfigure*/
     startRfDiscovery(false);
   }
@@ -1491,6 +1537,10 @@ static jboolean nfcManager_commitRouting(JNIEnv* e, jobject) {
     /*Stop RF discovery to reconfigure*/
     startRfDiscovery(true);
   }
+  if (rfStopMicros != 0) {
+    NfcStatsUtil::recordLatency(NfcStatsUtil::HIST_ROUTING_RF_DOWNTIME,
+                                NfcStatsUtil::nowMicros() - rfStopMicros);
+  }
   return status;
 #else
   return RoutingManager::getInstance().commitRouting();
@@ -1648,83 +1698,104 @@ static jboolean nfcManager_doInitialize(JNIEnv* e, jobject o) {
     if (stat == NFA_STATUS_OK) {
       // sIsNfaEnabled indicates whether stack started successfully
       if (sIsNfaEnabled) {
+        struct nfc_jni_native_data* nat = getNative(e, o);
+        // Stages only wait for each other where one needs the state set up
+        // by another; the rest wait for their NFA events in parallel.
+        StartupGraph graph;
+        std::vector<int> all;
 #if (NXP_EXTNS == TRUE)
-        SecureElement::getInstance().initialize (getNative(e, o));
+        int se = graph.addStage(
+            "se", {}, [nat] { SecureElement::getInstance().initialize(nat); });
+        all.push_back(se);
+        all.push_back(graph.addStage("routing", {se}, [nat] {
+          sRoutingInitialized = RoutingManager::getInstance().initialize(nat);
+        }));
+#else
+        all.push_back(graph.addStage("routing", {}, [nat] {
+          sRoutingInitialized = RoutingManager::getInstance().initialize(nat);
+        }));
 #endif
-        sRoutingInitialized =
-            RoutingManager::getInstance().initialize(getNative(e, o));
-        nativeNfcTag_registerNdefTypeHandler();
-        NfcTag::getInstance().initialize(getNative(e, o));
-        HciEventManager::getInstance().initialize(getNative(e, o));
-#if(NXP_EXTNS == TRUE)
-        MposManager::getInstance().initialize(getNative(e, o));
-        NativeT4tNfcee::getInstance().initialize();
-        NativeExtFieldDetect::getInstance().initialize(getNative(e, o));
+        all.push_back(graph.addStage("hci", {}, [nat] {
+          HciEventManager::getInstance().initialize(nat);
+        }));
+        all.push_back(graph.addStage("tag", {}, [nat] {
+          nativeNfcTag_registerNdefTypeHandler();
+          NfcTag::getInstance().initialize(nat);
+        }));
+#if (NXP_EXTNS == TRUE)
+        all.push_back(graph.addStage("extns", {se}, [nat] {
+          MposManager::getInstance().initialize(nat);
+          NativeT4tNfcee::getInstance().initialize();
+          NativeExtFieldDetect::getInstance().initialize(nat);
 #if (NXP_SRD == TRUE)
-        SecureDigitization::getInstance().initialize(getNative(e, o));
+          SecureDigitization::getInstance().initialize(nat);
 #endif
-        if(NFA_STATUS_OK != NFA_RegVSCback (true,nfaVSCNtfCallback)) { //Register CallBack for Lx Debug notifications
-          LOG(ERROR) << StringPrintf("%s:  nfaVSCNtfCallback resgister failed..!", __func__);
-        }
+          if(NFA_STATUS_OK != NFA_RegVSCback (true,nfaVSCNtfCallback)) { //Register CallBack for Lx Debug notifications
+            LOG(ERROR) << StringPrintf("%s:  nfaVSCNtfCallback resgister failed..!", "nfcManager_doInitialize");
+          }
+        }));
 #endif
         /////////////////////////////////////////////////////////////////////////////////
         // Add extra configuration here (work-arounds, etc.)
+        all.push_back(graph.addStage("config", {}, [nat] {
+          if (gIsDtaEnabled == true) {
+            uint8_t configData = 0;
+            configData = 0x01; /* Poll NFC-DEP : Highest Available Bit Rates */
+            NFA_SetConfig(NCI_PARAM_ID_BITR_NFC_DEP, sizeof(uint8_t),
+                          &configData);
+            configData = 0x0B; /* Listen NFC-DEP : Waiting Time */
+            NFA_SetConfig(NFC_PMID_WT, sizeof(uint8_t), &configData);
+            configData = 0x0F; /* Specific Parameters for NFC-DEP RF Interface */
+            NFA_SetConfig(NCI_PARAM_ID_NFC_DEP_OP, sizeof(uint8_t), &configData);
+          }
 
-        if (gIsDtaEnabled == true) {
-          uint8_t configData = 0;
-          configData = 0x01; /* Poll NFC-DEP : Highest Available Bit Rates */
-          NFA_SetConfig(NCI_PARAM_ID_BITR_NFC_DEP, sizeof(uint8_t),
-                        &configData);
-          configData = 0x0B; /* Listen NFC-DEP : Waiting Time */
-          NFA_SetConfig(NFC_PMID_WT, sizeof(uint8_t), &configData);
-          configData = 0x0F; /* Specific Parameters for NFC-DEP RF Interface */
-          NFA_SetConfig(NCI_PARAM_ID_NFC_DEP_OP, sizeof(uint8_t), &configData);
-        }
-
-        struct nfc_jni_native_data* nat = getNative(e, o);
-        if (nat) {
-          nat->tech_mask =
-              NfcConfig::getUnsigned(NAME_POLLING_TECH_MASK, DEFAULT_TECH_MASK);
-          DLOG_IF(INFO, nfc_debug_enabled) << StringPrintf(
-              "%s: tag polling tech mask=0x%X", __func__, nat->tech_mask);
-        }
-
-        // if this value exists, set polling interval.
-        nat->discovery_duration = NfcConfig::getUnsigned(
-            NAME_NFA_DM_DISC_DURATION_POLL, DEFAULT_DISCOVERY_DURATION);
-
-        NFA_SetRfDiscoveryDuration(nat->discovery_duration);
+          if (nat) {
+            nat->tech_mask =
+                NfcConfig::getUnsigned(NAME_POLLING_TECH_MASK, DEFAULT_TECH_MASK);
+            DLOG_IF(INFO, nfc_debug_enabled) << StringPrintf(
+                "%s: tag polling tech mask=0x%X", "nfcManager_doInitialize", nat->tech_mask);
+          }
 
-        // get LF_T3T_MAX
-        {
-          SyncEventGuard guard(gNfaGetConfigEvent);
-          tNFA_PMID configParam[1] = {NCI_PARAM_ID_LF_T3T_MAX};
-          stat = NFA_GetConfig(1, configParam);
-          if (stat == NFA_STATUS_OK) {
-            gNfaGetConfigEvent.wait();
-            if (gCurrentConfigLen >= 4 ||
-                gConfig[1] == NCI_PARAM_ID_LF_T3T_MAX) {
-              DLOG_IF(INFO, nfc_debug_enabled)
-                  << StringPrintf("%s: lfT3tMax=%d", __func__, gConfig[3]);
-              sLfT3tMax = gConfig[3];
+          // if this value exists, set polling interval.
+          nat->discovery_duration = NfcConfig::getUnsigned(
+              NAME_NFA_DM_DISC_DURATION_POLL, DEFAULT_DISCOVERY_DURATION);
+
+          NFA_SetRfDiscoveryDuration(nat->discovery_duration);
+
+          // get LF_T3T_MAX
+          {
+            SyncEventGuard guard(gNfaGetConfigEvent);
+            tNFA_PMID configParam[1] = {NCI_PARAM_ID_LF_T3T_MAX};
+            tNFA_STATUS stat = NFA_GetConfig(1, configParam);
+            if (stat == NFA_STATUS_OK) {
+              gNfaGetConfigEvent.wait();
+              if (gCurrentConfigLen >= 4 ||
+                  gConfig[1] == NCI_PARAM_ID_LF_T3T_MAX) {
+                DLOG_IF(INFO, nfc_debug_enabled)
+                    << StringPrintf("%s: lfT3tMax=%d", "nfcManager_doInitialize", gConfig[3]);
+                sLfT3tMax = gConfig[3];
+              }
             }
           }
-        }
 
 #if (NXP_EXTNS==TRUE)
-        if (NfcConfig::hasKey(NAME_NXP_ENABLE_DISABLE_LOGS))
-          suppressLogs =
-              NfcConfig::getUnsigned(NAME_NXP_ENABLE_DISABLE_LOGS, 1);
-        prevScreenState = NFA_SCREEN_STATE_UNKNOWN;
+          if (NfcConfig::hasKey(NAME_NXP_ENABLE_DISABLE_LOGS))
+            suppressLogs =
+                NfcConfig::getUnsigned(NAME_NXP_ENABLE_DISABLE_LOGS, 1);
+          prevScreenState = NFA_SCREEN_STATE_UNKNOWN;
 #else
-        prevScreenState = NFA_SCREEN_STATE_OFF_LOCKED;
+          prevScreenState = NFA_SCREEN_STATE_OFF_LOCKED;
 #endif
+        }));
 
-        // Do custom NFCA startup configuration.
-        doStartupConfig();
+        // Do custom NFCA startup configuration once everything else is set.
+        graph.addStage("startupConfig", all, [] {
+          doStartupConfig();
 #ifdef DTA_ENABLED
-        NfcDta::getInstance().setNfccConfigParams();
+          NfcDta::getInstance().setNfccConfigParams();
 #endif /* DTA_ENABLED */
+        });
+        graph.run();
         goto TheEnd;
       }
     }
@@ -1778,11 +1849,10 @@ static void nfcManager_configNfccConfigControl(bool flag) {
     uint8_t nfa_set_config[] = { 0x00 };
     nfa_set_config[0] = (flag == true ? 1 : 0);
 
-    tNFA_STATUS status = NFA_SetConfig(NCI_PARAM_ID_NFCC_CONFIG_CONTROL, sizeof(nfa_set_config),
-            &nfa_set_config[0]);
-    if (status != NFA_STATUS_OK) {
-      LOG(ERROR) << __func__  << ": Failed to configure NFCC_CONFIG_CONTROL";
-    }
+    // written with the other queued values when RF discovery starts
+    ConfigWriter::getInstance().queue(NCI_PARAM_ID_NFCC_CONFIG_CONTROL,
+                                      &nfa_set_config[0],
+                                      sizeof(nfa_set_config));
   }
 }
 
@@ -2121,7 +2191,9 @@ static jint nfcManager_getT4TNfceePowerState(JNIEnv* e, jobject o) {
  **
  ** Function:        getConfig
  **
- ** Description:     read the config values from NFC controller.
+ ** Description:     read the config values from NFC controller. Cached
+ **                  values are used; only the parameters not in the cache
+ **                  are read from the controller, in one request.
  **
  ** Returns:         SUCCESS/FAILURE
  **
@@ -2131,12 +2203,20 @@ tNFA_STATUS getConfig(uint16_t* rspLen, uint8_t* configValue, uint8_t numParam,
   tNFA_STATUS status = NFA_STATUS_FAILED;
   if (rspLen == NULL || configValue == NULL || param == NULL)
     return NFA_STATUS_FAILED;
+  ConfigParamCache& cache = ConfigParamCache::getInstance();
+  if (cache.get(numParam, param, configValue, sizeof(gConfig), rspLen))
+    return NFA_STATUS_OK;
+
+  std::vector<tNFA_PMID> missing;
+  uint8_t numMissing = cache.getMissing(numParam, param, missing);
   SyncEventGuard guard(gNfaGetConfigEvent);
-  status = NFA_GetConfig(numParam, param);
+  status = NFA_GetConfig(numMissing, missing.data());
   if (status == NFA_STATUS_OK) {
     if (gNfaGetConfigEvent.wait(WIRED_MODE_TRANSCEIVE_TIMEOUT) == false) {
       *rspLen = 0;
-    } else {
+    } else if (!cache.get(numParam, param, configValue, sizeof(gConfig),
+                          rspLen)) {
+      // values were not all learned, e.g. a set config came in between
       *rspLen = gCurrentConfigLen;
       memcpy(configValue, gConfig, gCurrentConfigLen);
     }
@@ -2749,6 +2829,26 @@ static void nfcManager_doDump(JNIEnv* e, jobject obj, jobject fdobj) {
 
   NfcAdaptation& theInstance = NfcAdaptation::GetInstance();
   theInstance.Dump(fd);
+  NfcStatsUtil::dump(fd);
+  StartupGraph::dump(fd);
+#if (NFC_TRACE == TRUE)
+  NfcTrace::dump(fd);
+#endif
+}
+
+/*******************************************************************************
+**
+** Function:        nfcManager_doGetMetricsSnapshot
+**
+** Description:     Get the latency histograms and error counters.
+**                  e: JVM environment.
+**                  o: Java object.
+**
+** Returns:         JSON object.
+**
+*******************************************************************************/
+static jstring nfcManager_doGetMetricsSnapshot(JNIEnv* e, jobject) {
+  return e->NewStringUTF(NfcStatsUtil::getMetricsSnapshot().c_str());
 }
 
 static jint nfcManager_doGetNciVersion(JNIEnv*, jobject) {
@@ -2848,12 +2948,12 @@ static void nfcManager_doSetScreenState(JNIEnv* e, jobject o,
         NCI_LISTEN_DH_NFCEE_ENABLE_MASK | NCI_POLLING_DH_ENABLE_MASK;
   }
 
-  SyncEventGuard guard(gNfaSetConfigEvent);
-  status = NFA_SetConfig(NCI_PARAM_ID_CON_DISCOVERY_PARAM,
-                         NCI_PARAM_LEN_CON_DISCOVERY_PARAM, &discovry_param);
-  if (status == NFA_STATUS_OK) {
-    gNfaSetConfigEvent.wait();
-  } else {
+  // not written when the controller holds the value already
+  ConfigWriter& configWriter = ConfigWriter::getInstance();
+  configWriter.queue(NCI_PARAM_ID_CON_DISCOVERY_PARAM, &discovry_param,
+                     NCI_PARAM_LEN_CON_DISCOVERY_PARAM);
+  status = configWriter.flush();
+  if (status != NFA_STATUS_OK) {
     LOG(ERROR) << StringPrintf("%s: Failed to update CON_DISCOVER_PARAM",
                                __FUNCTION__);
     return;
@@ -3087,6 +3187,9 @@ static JNINativeMethod gMethods[] = {
     {"doClearRoutingEntry", "(I)Z",
             (void*)nfcManager_clearRoutingEntry},
 
+    {"beginRoutingTransaction", "()Z",
+     (void*)nfcManager_beginRoutingTransaction},
+
     {"commitRouting", "()Z", (void*)nfcManager_commitRouting},
 
     {"setEmptyAidRoute", "(I)V", (void*)nfcManager_setEmptyAidRoute},
@@ -3207,6 +3310,8 @@ static JNINativeMethod gMethods[] = {
     {"getNfaStorageDir", "()Ljava/lang/String;",
      (void*)nfcManager_doGetNfaStorageDir},
     {"getRoutingTable", "()[B", (void*)nfcManager_doGetRoutingTable},
+    {"getMetricsSnapshot", "()Ljava/lang/String;",
+     (void*)nfcManager_doGetMetricsSnapshot},
 
     {"getMaxRoutingTableSize", "()I",
      (void*)nfcManager_doGetMaxRoutingTableSize},
@@ -3245,6 +3350,7 @@ void startRfDiscovery(bool isStart) {
 
   DLOG_IF(INFO, nfc_debug_enabled)
       << StringPrintf("%s: is start=%d", __func__, isStart);
+  if (isStart) ConfigWriter::getInstance().flush();
   nativeNfcTag_acquireRfInterfaceMutexLock();
   SyncEventGuard guard(sNfaEnableDisablePollingEvent);
   status = isStart ? NFA_StartRfDiscovery() : NFA_StopRfDiscovery();
@@ -3311,6 +3417,9 @@ void doStartupConfig() {
 
   // configure NFCC_CONFIG_CONTROL- NFCC allowed to manage RF configuration.
   nfcManager_configNfccConfigControl(true);
+  if (ConfigWriter::getInstance().flush() != NFA_STATUS_OK) {
+    LOG(ERROR) << __func__ << ": Failed to configure NFCC_CONFIG_CONTROL";
+  }
 #if (NXP_EXTNS == TRUE)
     send_flush_ram_to_flash();
 #endif
@@ -3401,7 +3510,6 @@ void startStopPolling(bool isStartPolling) {
       << StringPrintf("%s: enter; isStart=%u", __func__, isStartPolling);
 
   if (NFC_GetNCIVersion() >= NCI_VERSION_2_0) {
-    SyncEventGuard guard(gNfaSetConfigEvent);
     if (isStartPolling) {
       discovry_param =
           NCI_LISTEN_DH_NFCEE_ENABLE_MASK | NCI_POLLING_DH_ENABLE_MASK;
@@ -3409,11 +3517,11 @@ void startStopPolling(bool isStartPolling) {
       discovry_param =
           NCI_LISTEN_DH_NFCEE_ENABLE_MASK | NCI_POLLING_DH_DISABLE_MASK;
     }
-    status = NFA_SetConfig(NCI_PARAM_ID_CON_DISCOVERY_PARAM,
-                           NCI_PARAM_LEN_CON_DISCOVERY_PARAM, &discovry_param);
-    if (status == NFA_STATUS_OK) {
-      gNfaSetConfigEvent.wait();
-    } else {
+    ConfigWriter& configWriter = ConfigWriter::getInstance();
+    configWriter.queue(NCI_PARAM_ID_CON_DISCOVERY_PARAM, &discovry_param,
+                       NCI_PARAM_LEN_CON_DISCOVERY_PARAM);
+    status = configWriter.flush();
+    if (status != NFA_STATUS_OK) {
       LOG(ERROR) << StringPrintf("%s: Failed to update CON_DISCOVER_PARAM",
                                  __FUNCTION__);
     }
@@ -3828,12 +3936,14 @@ static rssi_status_t nfcManager_doSetRssiMode(
   NFA_SetFieldDetectMode(enable);
 
   tNFA_STATUS status = NFA_STATUS_REJECTED;
-  uint8_t cmd_rssi[] = {0x20, 0x02, 0x06, 0x01, 0xA1, 0x55, 0x02, 0x00, 0x00};
+  uint8_t rssi[] = {0x00, 0x00};
 
-  cmd_rssi[7] = (uint8_t)enable;  // To enable/disable RSSI
-  cmd_rssi[8] =
+  rssi[0] = (uint8_t)enable;  // To enable/disable RSSI
+  rssi[1] =
       (uint8_t)rssiNtfTimeInterval;  // RSSI NTF time Interval in value * 10 ms
-  status = android::NxpNfc_Write_Cmd_Common(sizeof(cmd_rssi), cmd_rssi);
+  ConfigWriter& configWriter = ConfigWriter::getInstance();
+  configWriter.queue(0xA155, rssi, sizeof(rssi));
+  status = configWriter.flush();
 
   if (status != FDSTATUS_SUCCESS) {
     NFA_SetFieldDetectMode(false);
@@ -3871,7 +3981,7 @@ static rssi_status_t nfcManager_doSetRssiMode(
 **                 0x01 is Nfc is off
 **********************************************************************************/
 static jint nfcManager_enableDebugNtf(JNIEnv* e, jobject o, jbyte fieldValue) {
-  uint8_t cmd_lxdebug[] = { 0x20, 0x02, 0x06, 0x01, 0xA0, 0x1D, 0x02, 0x00, 0x00 };
+  uint8_t lxdebug[] = { 0x00, 0x00 };
   tNFA_STATUS status = NFA_STATUS_REJECTED;
   DLOG_IF(INFO, nfc_debug_enabled) << StringPrintf("%s : enter", __func__);
 
@@ -3879,8 +3989,10 @@ static jint nfcManager_enableDebugNtf(JNIEnv* e, jobject o, jbyte fieldValue) {
 
   if (sRfEnabled) { startRfDiscovery(false); }
   /* As of now, bit0, bit4 and bit5 is allowed by this API */
-  cmd_lxdebug[7] = (uint8_t)(fieldValue & L2_DEBUG_BYTE0_MASK); /* Lx debug ntfs */
-  status = android::NxpNfc_Write_Cmd_Common(sizeof(cmd_lxdebug),cmd_lxdebug);
+  lxdebug[0] = (uint8_t)(fieldValue & L2_DEBUG_BYTE0_MASK); /* Lx debug ntfs */
+  ConfigWriter& configWriter = ConfigWriter::getInstance();
+  configWriter.queue(0xA01D, lxdebug, sizeof(lxdebug));
+  status = configWriter.flush();
 
   if (status) { status = NFA_STATUS_FAILED; }
 
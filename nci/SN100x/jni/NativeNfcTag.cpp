@@ -48,7 +48,11 @@
 #include "JavaClassConstants.h"
 #include "Mutex.h"
 #include "NfcJniUtil.h"
+#include "NfcStatsUtil.h"
 #include "NfcTag.h"
+#include "NfcTrace.h"
+#include "PresenceCheckEngine.h"
+#include "TagSession.h"
 #include "ndef_utils.h"
 #include "nfa_api.h"
 #include "nfa_rw_api.h"
@@ -118,16 +122,9 @@ static bool sCheckNdefCapable = false;  // whether tag has NDEF capability
 static tNFA_HANDLE sNdefTypeHandlerHandle = NFA_HANDLE_INVALID;
 static tNFA_INTF_TYPE sCurrentRfInterface = NFA_INTERFACE_ISO_DEP;
 #if (NXP_EXTNS == TRUE)
-SyncEvent sTransceiveEvent;
 static tNFA_INTF_TYPE sCurrentActivatedProtocl = NFC_PROTOCOL_UNKNOWN;
 #define DEFAULT_PRESENCE_CHECK_TIMEOUT 375
-#else
-static SyncEvent sTransceiveEvent;
 #endif
-static std::basic_string<uint8_t> sRxDataBuffer;
-static tNFA_STATUS sRxDataStatus = NFA_STATUS_OK;
-static bool sWaitingForTransceive = false;
-static bool sTransceiveRfTimeout = false;
 static Mutex sRfInterfaceMutex;
 static uint32_t sReadDataLen = 0;
 static uint8_t* sReadData = NULL;
@@ -152,6 +149,7 @@ static uint32_t sCheckNdefMaxSize = 0;
 static bool sCheckNdefCardReadOnly = false;
 static jboolean sCheckNdefWaitingForComplete = JNI_FALSE;
 static bool sIsTagPresent = false;
+static bool sPresCheckPending = false;  // NFA_RwPresenceCheck not answered yet
 static tNFA_STATUS sMakeReadonlyStatus = NFA_STATUS_FAILED;
 static jboolean sMakeReadonlyWaitingForComplete = JNI_FALSE;
 static int sCurrentConnectedTargetType = TARGET_TYPE_UNKNOWN;
@@ -161,9 +159,6 @@ static int sCurrentConnectedHandle = 0;
 void nativeNfcTag_doPresenceCheckResult(tNFA_STATUS status);
 void retrySelect(tNFA_INTF_TYPE rfInterface);
 #endif
-static int sIsoDepPresCheckCnt = 0;
-static bool sIsoDepPresCheckAlternate = false;
-static int sPresCheckErrCnt = 0;
 
 static int sPresCheckStatus = 0;
 static int reSelect(tNFA_INTF_TYPE rfInterface, bool fSwitchIfNeeded);
@@ -186,10 +181,7 @@ void nativeNfcTag_abortWaits() {
   }
   sem_post(&sWriteSem);
   sem_post(&sFormatSem);
-  {
-    SyncEventGuard g(sTransceiveEvent);
-    sTransceiveEvent.notifyOne();
-  }
+  TagSession::current()->abortTransceive();
   {
     SyncEventGuard g(sReconnectEvent);
     sReconnectEvent.notifyOne();
@@ -201,6 +193,7 @@ void nativeNfcTag_abortWaits() {
 #else
   {
     SyncEventGuard guard(sPresenceCheckEvent);
+    sPresCheckPending = false;
     sPresenceCheckEvent.notifyOne();
   }
 #endif
@@ -214,9 +207,6 @@ void nativeNfcTag_abortWaits() {
   natTag.mCurrentRequestedProtocol = NFC_PROTOCOL_UNKNOWN;
   NfcTagExtns::getInstance().abortTagOperation();
 #endif
-  sIsoDepPresCheckCnt = 0;
-  sPresCheckErrCnt = 0;
-  sIsoDepPresCheckAlternate = false;
 }
 
 /*******************************************************************************
@@ -283,7 +273,13 @@ void nativeNfcTag_setRfInterface(tNFA_INTF_TYPE rfInterface) {
  **
  *******************************************************************************/
 void nativeNfcTag_setTransceiveFlag(bool state) {
-  sWaitingForTransceive = state;
+  std::shared_ptr<TagSession> session = TagSession::current();
+  if (state) {
+    SyncEventGuard g(session->getTransceiveEvent());
+    session->prepareTransceive();
+  } else {
+    session->endTransceive();
+  }
 }
 #endif
 /*******************************************************************************
@@ -360,6 +356,7 @@ static jbyteArray nativeNfcTag_doRead(JNIEnv* e, jobject) {
   }
 
   if (sCheckNdefCurrentSize > 0) {
+    uint64_t startMicros = NfcStatsUtil::nowMicros();
     {
       SyncEventGuard g(sReadEvent);
       sIsReadingNdefMessage = true;
@@ -367,6 +364,9 @@ static jbyteArray nativeNfcTag_doRead(JNIEnv* e, jobject) {
       sReadEvent.wait();  // wait for NFA_READ_CPLT_EVT
     }
     sIsReadingNdefMessage = false;
+    if (sReadDataLen > 0)
+      NfcStatsUtil::recordLatency(NfcStatsUtil::HIST_NDEF_READ,
+                                  NfcStatsUtil::nowMicros() - startMicros);
 
     if (sReadDataLen > 0)  // if stack actually read data from the tag
     {
@@ -448,6 +448,7 @@ static jboolean nativeNfcTag_doWrite(JNIEnv* e, jobject, jbyteArray buf) {
   const int maxBufferSize = 1024;
   uint8_t buffer[maxBufferSize] = {0};
   uint32_t curDataSize = 0;
+  uint64_t startMicros = NfcStatsUtil::nowMicros();
 
   ScopedByteArrayRO bytes(e, buf);
   uint8_t* p_data = const_cast<uint8_t*>(reinterpret_cast<const uint8_t*>(
@@ -526,6 +527,9 @@ static jboolean nativeNfcTag_doWrite(JNIEnv* e, jobject, jbyteArray buf) {
   }
 
   result = sWriteOk;
+  if (result)
+    NfcStatsUtil::recordLatency(NfcStatsUtil::HIST_NDEF_WRITE,
+                                NfcStatsUtil::nowMicros() - startMicros);
 
 TheEnd:
   /* Destroy semaphore */
@@ -593,10 +597,6 @@ static jint nativeNfcTag_doConnect(JNIEnv*, jobject, jint targetHandle) {
   NfcTag& natTag = NfcTag::getInstance();
   int retCode = NFCSTATUS_SUCCESS;
 
-  sIsoDepPresCheckCnt = 0;
-  sPresCheckErrCnt = 0;
-  sIsoDepPresCheckAlternate = false;
-
   if (i >= NfcTag::MAX_NUM_TECHNOLOGY) {
     LOG(ERROR) << StringPrintf("%s: Handle not found", __func__);
     retCode = NFCSTATUS_FAILED;
@@ -609,6 +609,8 @@ static jint nativeNfcTag_doConnect(JNIEnv*, jobject, jint targetHandle) {
     goto TheEnd;
   }
 
+  // data events are routed to this target's session from now on
+  TagSession::select(natTag.mTechHandles[i])->resetPresenceCheck();
   sCurrentConnectedTargetType = natTag.mTechList[i];
   sCurrentConnectedTargetProtocol = natTag.mTechLibNfcTypes[i];
   sCurrentConnectedHandle = targetHandle;
@@ -1101,38 +1103,184 @@ TheEnd:
 *******************************************************************************/
 void nativeNfcTag_doTransceiveStatus(tNFA_STATUS status, uint8_t* buf,
                                      uint32_t bufLen) {
-  SyncEventGuard g(sTransceiveEvent);
-  DLOG_IF(INFO, nfc_debug_enabled)
-      << StringPrintf("%s: data len=%d", __func__, bufLen);
-
-  if (!sWaitingForTransceive) {
-    LOG(ERROR) << StringPrintf("%s: drop data", __func__);
-    return;
-  }
-  sRxDataStatus = status;
-  if (sRxDataStatus == NFA_STATUS_OK || sRxDataStatus == NFC_STATUS_CONTINUE)
-    sRxDataBuffer.append(buf, bufLen);
-
-  if (sRxDataStatus == NFA_STATUS_OK) sTransceiveEvent.notifyOne();
-
+  TagSession::current()->onData(status, buf, bufLen);
 }
 #if(NXP_EXTNS == TRUE)
 void nativeNfcTag_notifyRfTimeout(tNFA_STATUS status) {
+  NfcStatsUtil::incrementCounter(NfcStatsUtil::COUNT_RF_ERROR);
+  TagSession::current()->onRfTimeout(status != NFC_STATUS_RF_PROTOCOL_ERR);
+}
 #else
 void nativeNfcTag_notifyRfTimeout() {
+  NfcStatsUtil::incrementCounter(NfcStatsUtil::COUNT_RF_ERROR);
+  TagSession::current()->onRfTimeout(true);
+}
 #endif
-  SyncEventGuard g(sTransceiveEvent);
-  DLOG_IF(INFO, nfc_debug_enabled) << StringPrintf(
-      "%s: waiting for transceive: %d", __func__, sWaitingForTransceive);
-  if (!sWaitingForTransceive) return;
 
-#if(NXP_EXTNS == TRUE)
-  if(status != NFC_STATUS_RF_PROTOCOL_ERR) sTransceiveRfTimeout = true;
-#else
-  sTransceiveRfTimeout = true;
+/*******************************************************************************
+**
+** Function:        recordApduSend
+**
+** Description:     Count an APDU about to be sent; the first one since the
+**                  activation also records the activation-to-first-APDU
+**                  latency.
+**                  session: Session of the connected target.
+**
+** Returns:         Send time, to be passed to recordApduResult().
+**
+*******************************************************************************/
+static uint64_t recordApduSend(TagSession* session) {
+  uint64_t sendMicros = NfcStatsUtil::nowMicros();
+  uint64_t activatedMicros = session->takeActivatedMicros();
+  if (activatedMicros != 0) {
+    NfcStatsUtil::recordLatency(NfcStatsUtil::HIST_ACTIVATION_TO_FIRST_APDU,
+                                sendMicros - activatedMicros);
+  }
+  return sendMicros;
+}
+
+/*******************************************************************************
+**
+** Function:        recordApduResult
+**
+** Description:     Record the round trip of an APDU, or count a transceive
+**                  timeout if no response came.
+**                  sendMicros: Send time from recordApduSend().
+**                  responded: Whether the whole response was received.
+**
+** Returns:         None
+**
+*******************************************************************************/
+static void recordApduResult(uint64_t sendMicros, bool responded) {
+  if (responded) {
+    NfcStatsUtil::recordLatency(
+        NfcStatsUtil::getApduHistogram(sCurrentConnectedTargetProtocol),
+        NfcStatsUtil::nowMicros() - sendMicros);
+  } else {
+    NfcStatsUtil::incrementCounter(NfcStatsUtil::COUNT_TRANSCEIVE_TIMEOUT);
+  }
+}
+
+/*******************************************************************************
+**
+** Function:        reconnectAfterNack
+**
+** Description:     Wake a Mifare Ultralight C tag that entered the HALT state
+**                  after it responded with a NACK.
+**
+** Returns:         None
+**
+*******************************************************************************/
+static void reconnectAfterNack() {
+  DLOG_IF(INFO, nfc_debug_enabled)
+      << StringPrintf("%s: try reconnect", __func__);
+  NfcStatsUtil::incrementCounter(NfcStatsUtil::COUNT_NACK_RECONNECT);
+  nativeNfcTag_doReconnect(NULL, NULL);
+  DLOG_IF(INFO, nfc_debug_enabled)
+      << StringPrintf("%s: reconnect finish", __func__);
+}
+
+/*******************************************************************************
+**
+** Function:        transceiveFrame
+**
+** Description:     Send one raw frame and wait for the complete response. The
+**                  response lands in the session's mRxDataBuffer, or in its
+**                  direct buffer if one is armed.
+**                  session: Session of the connected target.
+**                  buf: Frame to send.
+**                  bufLen: Length of the frame.
+**                  timeout: Response timeout in milliseconds.
+**                  targetLost: Set if the tag timed out or was deactivated.
+**
+** Returns:         True if a response was received.
+**
+*******************************************************************************/
+static bool transceiveFrame(TagSession* session, uint8_t* buf, size_t bufLen,
+                            int timeout, bool& targetLost) {
+  bool waitOk = false;
+  tNFA_STATUS status;
+
+  targetLost = false;
+  {
+    SyncEventGuard g(session->getTransceiveEvent());
+    session->prepareTransceive();
+
+    NFC_TRACE_INSTANT("tag", "send", bufLen);
+    uint64_t sendMicros = recordApduSend(session);
+    status = NFA_SendRawFrame(buf, bufLen,
+                              NFA_DM_DEFAULT_PRESENCE_CHECK_START_DELAY);
+    if (status != NFA_STATUS_OK) {
+      LOG(ERROR) << StringPrintf("%s: fail send; error=%d", __func__, status);
+      return false;
+    }
+    waitOk = session->waitResponse(timeout) && !session->isRfTimeout();
+    NFC_TRACE_INSTANT("tag", "wakeup", waitOk);
+    recordApduResult(sendMicros, waitOk);
+  }
+
+  if (waitOk == false)  // if timeout occurred
+  {
+    LOG(ERROR) << StringPrintf("%s: wait response timeout", __func__);
+    targetLost = true;
+    return false;
+  }
+
+  if (NfcTag::getInstance().getActivationState() != NfcTag::Active) {
+    LOG(ERROR) << StringPrintf("%s: already deactivated", __func__);
+    targetLost = true;
+    return false;
+  }
+  return true;
+}
+
+/*******************************************************************************
+**
+** Function:        checkResponse
+**
+** Description:     Check a tag response before it is returned. An empty
+**                  response, a T2T NACK and a Mifare error are failures to
+**                  the upper layers; the tag is reconnected after the last
+**                  two.
+**                  e: JVM environment.
+**                  o: Java object.
+**                  rsp: Response.
+**                  rspLen: Length of the response.
+**
+** Returns:         True if the response is to be returned.
+**
+*******************************************************************************/
+static bool checkResponse(JNIEnv* e, jobject o, const uint8_t* rsp,
+                          size_t rspLen) {
+  NfcTag& natTag = NfcTag::getInstance();
+
+  if (rspLen == 0) return false;
+
+  if (
+#if (NXP_EXTNS == TRUE && NXP_SRD == TRUE)
+      (SecureDigitization::getInstance().getSrdState() != 0x01) &&
 #endif
+      (natTag.getProtocol() == NFA_PROTOCOL_T2T) &&
+      natTag.isT2tNackResponse(rsp, rspLen)) {
+    reconnectAfterNack();
+    return false;
+  }
 
-  sTransceiveEvent.notifyOne();
+  if ((sCurrentConnectedTargetProtocol == NFC_PROTOCOL_MIFARE) &&
+      (rspLen == 1) && (rsp[0] != 0x00)) {
+#if (NXP_EXTNS == TRUE)
+    if (NfcTagExtns::getInstance().processNonStdTagOperation(
+            TAG_API_REQUEST::TAG_DO_TRANSCEIVE_API,
+            TAG_OPERATION::TAG_RECONNECT_OPERATION) !=
+        NfcTagExtns::TAG_STATUS_SUCCESS) {
+      LOG(ERROR) << StringPrintf(
+          "%s: processNonStdTagOperation Operation failed", __func__);
+    }
+#endif
+    nativeNfcTag_doReconnect(e, o);
+    return false;
+  }
+  return true;
 }
 
 /*******************************************************************************
@@ -1151,15 +1299,13 @@ void nativeNfcTag_notifyRfTimeout() {
 static jbyteArray nativeNfcTag_doTransceive(JNIEnv* e, jobject o,
                                             jbyteArray data, jboolean raw,
                                             jintArray statusTargetLost) {
+  NFC_TRACE_SCOPE("tag", "doTransceive");
   int timeout =
       NfcTag::getInstance().getTransceiveTimeout(sCurrentConnectedTargetType);
   DLOG_IF(INFO, nfc_debug_enabled) << StringPrintf(
       "%s: enter; raw=%u; timeout = %d", __func__, raw, timeout);
 
-  bool waitOk = false;
-  bool isNack = false;
   jint* targetLost = NULL;
-  tNFA_STATUS status;
 
   if (NfcTag::getInstance().getActivationState() != NfcTag::Active) {
     if (statusTargetLost) {
@@ -1173,8 +1319,7 @@ static jbyteArray nativeNfcTag_doTransceive(JNIEnv* e, jobject o,
     return NULL;
   }
 
-  NfcTag& natTag = NfcTag::getInstance();
-  NfcTagExtns& nfcTagExtns = NfcTagExtns::getInstance();
+  std::shared_ptr<TagSession> session = TagSession::current();
 
   // get input buffer and length from java call
   ScopedByteArrayRO bytes(e, data);
@@ -1190,110 +1335,412 @@ static jbyteArray nativeNfcTag_doTransceive(JNIEnv* e, jobject o,
   sSwitchBackTimer.kill();
   ScopedLocalRef<jbyteArray> result(e, NULL);
   do {
-    {
-      SyncEventGuard g(sTransceiveEvent);
-      sTransceiveRfTimeout = false;
-      sWaitingForTransceive = true;
-      sRxDataStatus = NFA_STATUS_OK;
-      sRxDataBuffer.clear();
+    bool lost = false;
+    if (!transceiveFrame(session.get(), buf, bufLen, timeout, lost)) {
+      if (lost && targetLost)
+        *targetLost = 1;  // causes NFC service to throw TagLostException
+      break;
+    }
 
-      status = NFA_SendRawFrame(buf, bufLen,
-                                NFA_DM_DEFAULT_PRESENCE_CHECK_START_DELAY);
-      if (status != NFA_STATUS_OK) {
-        LOG(ERROR) << StringPrintf("%s: fail send; error=%d", __func__, status);
-        break;
-      }
-      waitOk = sTransceiveEvent.wait(timeout);
+    DLOG_IF(INFO, nfc_debug_enabled) << StringPrintf(
+        "%s: response %zu bytes", __func__, session->getResponse().size());
+
+    if (checkResponse(e, o, session->getResponse().data(),
+                      session->getResponse().size())) {
+      // marshall data to java for return
+      NFC_TRACE_SCOPE("tag", "marshal");
+      result.reset(e->NewByteArray(session->getResponse().size()));
+      if (result.get() != NULL) {
+        e->SetByteArrayRegion(result.get(), 0, session->getResponse().size(),
+                              (const jbyte*)session->getResponse().data());
+      } else
+        LOG(ERROR) << StringPrintf("%s: Failed to allocate java byte array",
+                                   __func__);
+    }  // else a nack is treated as a transceive failure to the upper layers
+    session->clearResponse();
+  } while (0);
+
+  session->endTransceive();
+  if (targetLost) e->ReleaseIntArrayElements(statusTargetLost, targetLost, 0);
+
+  DLOG_IF(INFO, nfc_debug_enabled) << StringPrintf("%s: exit", __func__);
+  return result.release();
+}
+
+/*******************************************************************************
+**
+** Function:        nativeNfcTag_doTransceiveDirect
+**
+** Description:     Send raw data to the tag; receive tag's response.
+**                  Both buffers are direct ByteBuffers owned by the caller, so
+**                  the frame is sent and the response fragments are written
+**                  without intermediate copies or Java array allocation.
+**                  e: JVM environment.
+**                  o: Java object.
+**                  txBuffer: Direct ByteBuffer holding the command.
+**                  txLen: Number of bytes of txBuffer to send.
+**                  rxBuffer: Direct ByteBuffer receiving the response.
+**                  statusTargetLost: Whether tag responds or times out.
+**
+** Returns:         Number of bytes written to rxBuffer, or -1 on failure.
+**
+*******************************************************************************/
+static jint nativeNfcTag_doTransceiveDirect(JNIEnv* e, jobject o,
+                                            jobject txBuffer, jint txLen,
+                                            jobject rxBuffer,
+                                            jintArray statusTargetLost) {
+  int timeout =
+      NfcTag::getInstance().getTransceiveTimeout(sCurrentConnectedTargetType);
+  DLOG_IF(INFO, nfc_debug_enabled) << StringPrintf(
+      "%s: enter; len=%d; timeout = %d", __func__, txLen, timeout);
+
+  jint* targetLost = NULL;
+  jint rxLen = -1;
+
+  if (statusTargetLost) {
+    targetLost = e->GetIntArrayElements(statusTargetLost, 0);
+    if (targetLost) *targetLost = 0;  // success, tag is still present
+  }
+
+  uint8_t* txData = NULL;
+  jlong txCapacity = 0;
+  uint8_t* rxData = NULL;
+  jlong rxCapacity = 0;
+  if (txBuffer != NULL && rxBuffer != NULL) {
+    txData = (uint8_t*)e->GetDirectBufferAddress(txBuffer);
+    txCapacity = e->GetDirectBufferCapacity(txBuffer);
+    rxData = (uint8_t*)e->GetDirectBufferAddress(rxBuffer);
+    rxCapacity = e->GetDirectBufferCapacity(rxBuffer);
+  }
+
+  NfcTag& natTag = NfcTag::getInstance();
+  std::shared_ptr<TagSession> session = TagSession::current();
+
+  do {
+    if (txData == NULL || rxData == NULL || txLen <= 0 ||
+        txLen > txCapacity || rxCapacity <= 0) {
+      LOG(ERROR) << StringPrintf("%s: invalid direct buffer", __func__);
+      break;
     }
 
-    if (waitOk == false || sTransceiveRfTimeout)  // if timeout occurred
-    {
-      LOG(ERROR) << StringPrintf("%s: wait response timeout", __func__);
+    if (natTag.getActivationState() != NfcTag::Active) {
+      DLOG_IF(INFO, nfc_debug_enabled)
+          << StringPrintf("%s: tag not active", __func__);
       if (targetLost)
         *targetLost = 1;  // causes NFC service to throw TagLostException
       break;
     }
 
-    if (NfcTag::getInstance().getActivationState() != NfcTag::Active) {
-      LOG(ERROR) << StringPrintf("%s: already deactivated", __func__);
-      if (targetLost)
+    sSwitchBackTimer.kill();
+    {
+      SyncEventGuard g(session->getTransceiveEvent());
+      session->setDirectBuffer(rxData, (size_t)rxCapacity);
+    }
+    bool lost = false;
+    bool rxOk = transceiveFrame(session.get(), txData, txLen, timeout, lost);
+    {
+      SyncEventGuard g(session->getTransceiveEvent());
+      session->setDirectBuffer(NULL, 0);
+    }
+    if (!rxOk) {
+      if (lost && targetLost)
         *targetLost = 1;  // causes NFC service to throw TagLostException
       break;
     }
 
-    DLOG_IF(INFO, nfc_debug_enabled) << StringPrintf(
-        "%s: response %zu bytes", __func__, sRxDataBuffer.size());
+    if (session->isDirectOverflow()) break;
 
-    if (
-#if (NXP_EXTNS == TRUE && NXP_SRD == TRUE)
-        (SecureDigitization::getInstance().getSrdState() != 0x01) &&
-#endif
-        (natTag.getProtocol() == NFA_PROTOCOL_T2T) &&
-        natTag.isT2tNackResponse(sRxDataBuffer.data(), sRxDataBuffer.size())) {
-      isNack = true;
+    DLOG_IF(INFO, nfc_debug_enabled)
+        << StringPrintf("%s: response %zu bytes", __func__,
+                        session->getDirectLength());
+
+    if (!checkResponse(e, o, rxData, session->getDirectLength())) break;
+
+    rxLen = (jint)session->getDirectLength();
+  } while (0);
+
+  session->endTransceive();
+  if (targetLost) e->ReleaseIntArrayElements(statusTargetLost, targetLost, 0);
+
+  DLOG_IF(INFO, nfc_debug_enabled)
+      << StringPrintf("%s: exit; rxLen=%d", __func__, rxLen);
+  return rxLen;
+}
+
+/*******************************************************************************
+**
+** Function:        nativeNfcTag_doTransceiveBatch
+**
+** Description:     Send a script of C-APDUs to an ISO-DEP tag back to back,
+**                  holding the RF interface for the whole script.
+**                  e: JVM environment.
+**                  o: Java object.
+**                  apdus: C-APDUs to send, in order.
+**                  expectedSw: Expected status word per C-APDU; may be null.
+**                  swMask: Mask applied to the status word before comparing;
+**                          0 disables the check for that C-APDU.
+**                  abortOnMismatch: Stop at the first unexpected status word.
+**                  statusTargetLost: Whether tag responds or times out.
+**
+** Returns:         R-APDUs packed as 4-byte big-endian length + data, one per
+**                  executed C-APDU; NULL on failure before the first response.
+**                  The script stops at a null or empty C-APDU.
+**
+*******************************************************************************/
+static jbyteArray nativeNfcTag_doTransceiveBatch(JNIEnv* e, jobject,
+                                                 jobjectArray apdus,
+                                                 jintArray expectedSw,
+                                                 jintArray swMask,
+                                                 jboolean abortOnMismatch,
+                                                 jintArray statusTargetLost) {
+  int timeout =
+      NfcTag::getInstance().getTransceiveTimeout(sCurrentConnectedTargetType);
+  jsize count = (apdus != NULL) ? e->GetArrayLength(apdus) : 0;
+  DLOG_IF(INFO, nfc_debug_enabled) << StringPrintf(
+      "%s: enter; count=%d; timeout = %d", __func__, count, timeout);
+
+  jint* targetLost = NULL;
+  std::basic_string<uint8_t> packed;
+  jsize executed = 0;
+
+  if (statusTargetLost) {
+    targetLost = e->GetIntArrayElements(statusTargetLost, 0);
+    if (targetLost) *targetLost = 0;  // success, tag is still present
+  }
+
+  ScopedIntArrayRO expected(e);
+  ScopedIntArrayRO masks(e);
+  if (expectedSw != NULL) expected.reset(expectedSw);
+  if (swMask != NULL) masks.reset(swMask);
+  bool checkSw = (expectedSw != NULL) && (swMask != NULL) &&
+                 ((jsize)expected.size() >= count) &&
+                 ((jsize)masks.size() >= count);
+
+  NfcTag& natTag = NfcTag::getInstance();
+  std::shared_ptr<TagSession> session = TagSession::current();
+  sRfInterfaceMutex.lock();
+  do {
+    if (natTag.getActivationState() != NfcTag::Active) {
+      DLOG_IF(INFO, nfc_debug_enabled)
+          << StringPrintf("%s: tag not active", __func__);
+      if (targetLost) *targetLost = 1;
+      break;
+    }
+    if (sCurrentConnectedTargetProtocol != NFC_PROTOCOL_ISO_DEP) {
+      LOG(ERROR) << StringPrintf("%s: protocol %d is not ISO-DEP", __func__,
+                                 sCurrentConnectedTargetProtocol);
+      break;
     }
 
-    if (sRxDataBuffer.size() > 0) {
-      if (isNack) {
-        // Some Mifare Ultralight C tags enter the HALT state after it
-        // responds with a NACK.  Need to perform a "reconnect" operation
-        // to wake it.
-        DLOG_IF(INFO, nfc_debug_enabled)
-            << StringPrintf("%s: try reconnect", __func__);
-        nativeNfcTag_doReconnect(NULL, NULL);
-        DLOG_IF(INFO, nfc_debug_enabled)
-            << StringPrintf("%s: reconnect finish", __func__);
-      } else if (sCurrentConnectedTargetProtocol == NFC_PROTOCOL_MIFARE) {
-        uint32_t transDataLen = static_cast<uint32_t>(sRxDataBuffer.size());
-        uint8_t* transData = (uint8_t*)sRxDataBuffer.data();
-        bool doReconnect = false;
+    sSwitchBackTimer.kill();
+    for (jsize i = 0; i < count; i++) {
+      ScopedLocalRef<jbyteArray> apdu(
+          e, (jbyteArray)e->GetObjectArrayElement(apdus, i));
+      if (apdu.get() == NULL) break;
+      ScopedByteArrayRO bytes(e, apdu.get());
+      if (bytes.size() == 0) {
+        LOG(ERROR) << StringPrintf("%s: apdu %d is empty", __func__, i);
+        break;
+      }
+      uint8_t* buf = const_cast<uint8_t*>(
+          reinterpret_cast<const uint8_t*>(&bytes[0]));
+      bool lost = false;
 
-        doReconnect =
-            ((transDataLen == 1) && (transData[0] != 0x00)) ? true : false;
+      if (!transceiveFrame(session.get(), buf, bytes.size(), timeout, lost)) {
+        if (lost && targetLost) *targetLost = 1;
+        break;
+      }
 
-        if (doReconnect) {
-#if (NXP_EXTNS == TRUE)
-          if (nfcTagExtns.processNonStdTagOperation(
-                  TAG_API_REQUEST::TAG_DO_TRANSCEIVE_API,
-                  TAG_OPERATION::TAG_RECONNECT_OPERATION) !=
-              NfcTagExtns::TAG_STATUS_SUCCESS) {
-            LOG(ERROR) << StringPrintf(
-                "%s: processNonStdTagOperation Operation failed", __func__);
-          }
-#endif
-          nativeNfcTag_doReconnect(e, o);
-        }
-         else {
-          if (transDataLen != 0) {
-            result.reset(e->NewByteArray(transDataLen));
-            if (result.get() != NULL) {
-              e->SetByteArrayRegion(result.get(), 0, transDataLen,
-                                  (const jbyte*)transData);
-            } else
-              LOG(ERROR) << StringPrintf("%s: Failed to allocate java byte array",
-                                       __func__);
-          }
+      size_t rspLen = session->getResponse().size();
+      packed.push_back((uint8_t)(rspLen >> 24));
+      packed.push_back((uint8_t)(rspLen >> 16));
+      packed.push_back((uint8_t)(rspLen >> 8));
+      packed.push_back((uint8_t)rspLen);
+      packed.append(session->getResponse());
+      executed++;
+
+      if (checkSw && masks[i] != 0) {
+        int sw = (rspLen >= 2) ? ((session->getResponse()[rspLen - 2] << 8) |
+                                  session->getResponse()[rspLen - 1])
+                               : -1;
+        if (sw < 0 || ((sw & masks[i]) != (expected[i] & masks[i]))) {
+          DLOG_IF(INFO, nfc_debug_enabled) << StringPrintf(
+              "%s: apdu %d: unexpected sw=0x%04X", __func__, i, sw);
+          if (abortOnMismatch) break;
         }
-      } else {
-        // marshall data to java for return
-        result.reset(e->NewByteArray(sRxDataBuffer.size()));
-        if (result.get() != NULL) {
-          e->SetByteArrayRegion(result.get(), 0, sRxDataBuffer.size(),
-                                (const jbyte*)sRxDataBuffer.data());
-        } else
+      }
+    }
+    session->clearResponse();
+  } while (0);
+  session->endTransceive();
+  sRfInterfaceMutex.unlock();
+
+  if (targetLost) e->ReleaseIntArrayElements(statusTargetLost, targetLost, 0);
+
+  ScopedLocalRef<jbyteArray> result(e, NULL);
+  if (executed > 0) {
+    result.reset(e->NewByteArray(packed.size()));
+    if (result.get() != NULL) {
+      e->SetByteArrayRegion(result.get(), 0, packed.size(),
+                            (const jbyte*)packed.data());
+    } else
+      LOG(ERROR) << StringPrintf("%s: Failed to allocate java byte array",
+                                 __func__);
+  }
+  DLOG_IF(INFO, nfc_debug_enabled)
+      << StringPrintf("%s: exit; executed=%d/%d", __func__, executed, count);
+  return result.release();
+}
+
+/*******************************************************************************
+**
+** Function:        nativeNfcTag_doTransceiveStreaming
+**
+** Description:     Send raw data to an ISO-DEP tag and stream the response.
+**                  Each chained fragment is passed to the consumer as soon as
+**                  it arrives, instead of being accumulated in mRxDataBuffer.
+**                  e: JVM environment.
+**                  o: Java object.
+**                  data: Frame to send.
+**                  consumer: Object implementing onFragment(byte[], boolean).
+**                  statusTargetLost: Whether tag responds or times out.
+**
+** Returns:         Total number of bytes received, or -1 on failure.
+**
+*******************************************************************************/
+static jint nativeNfcTag_doTransceiveStreaming(JNIEnv* e, jobject,
+                                               jbyteArray data,
+                                               jobject consumer,
+                                               jintArray statusTargetLost) {
+  const uint16_t maxChunkLen = 1024;
+  uint8_t chunk[maxChunkLen];
+  int timeout =
+      NfcTag::getInstance().getTransceiveTimeout(sCurrentConnectedTargetType);
+  DLOG_IF(INFO, nfc_debug_enabled)
+      << StringPrintf("%s: enter; timeout = %d", __func__, timeout);
+
+  jint* targetLost = NULL;
+  jint total = 0;
+  bool ok = false;
+  tNFA_STATUS status;
+  uint64_t sendMicros = 0;
+
+  if (statusTargetLost) {
+    targetLost = e->GetIntArrayElements(statusTargetLost, 0);
+    if (targetLost) *targetLost = 0;  // success, tag is still present
+  }
+
+  NfcTag& natTag = NfcTag::getInstance();
+  std::shared_ptr<TagSession> session = TagSession::current();
+  jmethodID onFragment = NULL;
+  if (consumer != NULL) {
+    ScopedLocalRef<jclass> cls(e, e->GetObjectClass(consumer));
+    onFragment = e->GetMethodID(cls.get(), "onFragment", "([BZ)V");
+  }
+
+  do {
+    if (data == NULL || onFragment == NULL) {
+      LOG(ERROR) << StringPrintf("%s: invalid argument", __func__);
+      break;
+    }
+    if (natTag.getActivationState() != NfcTag::Active) {
+      if (targetLost) *targetLost = 1;
+      break;
+    }
+    if (sCurrentConnectedTargetProtocol != NFC_PROTOCOL_ISO_DEP) {
+      LOG(ERROR) << StringPrintf("%s: protocol %d is not ISO-DEP", __func__,
+                                 sCurrentConnectedTargetProtocol);
+      break;
+    }
+
+    ScopedByteArrayRO bytes(e, data);
+    if (bytes.size() == 0) {
+      LOG(ERROR) << StringPrintf("%s: empty frame", __func__);
+      break;
+    }
+    uint8_t* buf = const_cast<uint8_t*>(
+        reinterpret_cast<const uint8_t*>(&bytes[0]));
+
+    sSwitchBackTimer.kill();
+    {
+      SyncEventGuard g(session->getTransceiveEvent());
+      session->prepareTransceive();
+      session->startStreaming();
+
+      sendMicros = recordApduSend(session.get());
+      status = NFA_SendRawFrame(buf, bytes.size(),
+                                NFA_DM_DEFAULT_PRESENCE_CHECK_START_DELAY);
+      if (status != NFA_STATUS_OK) {
+        LOG(ERROR) << StringPrintf("%s: fail send; error=%d", __func__, status);
+        break;
+      }
+    }
+
+    // fragments are taken from the queue without mTransceiveEvent; the
+    // queue is closed when the response ends, fails or is aborted
+    DataRing& queue = session->getStreamQueue();
+    bool done = false;
+    while (!done) {
+      if (!queue.waitNotEmpty(timeout)) {
+        LOG(ERROR) << StringPrintf("%s: wait fragment timeout", __func__);
+        recordApduResult(sendMicros, false);
+        if (targetLost) *targetLost = 1;
+        break;
+      }
+      if (session->isStreamOverflow()) {
+        LOG(ERROR) << StringPrintf("%s: consumer too slow", __func__);
+        break;
+      }
+
+      uint16_t len = 0;
+      while (!done && queue.dequeue(chunk, maxChunkLen, len)) {
+        done = session->isStreamDone() && queue.isEmpty();
+        ScopedLocalRef<jbyteArray> fragment(e, e->NewByteArray(len));
+        if (fragment.get() == NULL) {
           LOG(ERROR) << StringPrintf("%s: Failed to allocate java byte array",
                                      __func__);
-      }  // else a nack is treated as a transceive failure to the upper layers
-
-      sRxDataBuffer.clear();
+          break;
+        }
+        e->SetByteArrayRegion(fragment.get(), 0, len, (const jbyte*)chunk);
+        e->CallVoidMethod(consumer, onFragment, fragment.get(),
+                          done ? JNI_TRUE : JNI_FALSE);
+        if (e->ExceptionCheck()) {
+          LOG(ERROR) << StringPrintf("%s: consumer threw", __func__);
+          break;
+        }
+        total += len;
+      }
+      if (e->ExceptionCheck()) break;
+      if (done || !queue.isEmpty()) continue;
+      if (session->isStreamDone()) {
+        // the final fragment may carry no data
+        done = true;
+        ScopedLocalRef<jbyteArray> empty(e, e->NewByteArray(0));
+        e->CallVoidMethod(consumer, onFragment, empty.get(), JNI_TRUE);
+      } else if (queue.isClosed()) {
+        SyncEventGuard g(session->getTransceiveEvent());
+        if (session->isRfTimeout() ||
+            natTag.getActivationState() != NfcTag::Active) {
+          LOG(ERROR) << StringPrintf("%s: tag lost while streaming", __func__);
+          recordApduResult(sendMicros, false);
+          if (targetLost) *targetLost = 1;
+        } else {
+          LOG(ERROR) << StringPrintf("%s: stream aborted", __func__);
+        }
+        break;
+      }
     }
+    ok = done && !e->ExceptionCheck();
+    // the round trip includes the time the consumer took
+    if (done) recordApduResult(sendMicros, true);
   } while (0);
 
-  sWaitingForTransceive = false;
+  session->stopStreaming();
   if (targetLost) e->ReleaseIntArrayElements(statusTargetLost, targetLost, 0);
 
-  DLOG_IF(INFO, nfc_debug_enabled) << StringPrintf("%s: exit", __func__);
-  return result.release();
+  DLOG_IF(INFO, nfc_debug_enabled)
+      << StringPrintf("%s: exit; total=%d; ok=%d", __func__, total, ok);
+  return ok ? total : -1;
 }
 
 /*******************************************************************************
@@ -1564,10 +2011,13 @@ TheEnd:
 **
 *******************************************************************************/
 void nativeNfcTag_resetPresenceCheck() {
+  {
+    // a check still running in NFA ends with the deactivation
+    SyncEventGuard guard(sPresenceCheckEvent);
+    sPresCheckPending = false;
+  }
   sIsTagPresent = false;
-  sIsoDepPresCheckCnt = 0;
-  sPresCheckErrCnt = 0;
-  sIsoDepPresCheckAlternate = false;
+  TagSession::current()->resetPresenceCheck();
   sPresCheckStatus = 0;
 }
 
@@ -1585,9 +2035,68 @@ void nativeNfcTag_doPresenceCheckResult(tNFA_STATUS status) {
   SyncEventGuard guard(sPresenceCheckEvent);
   sIsTagPresent = status == NFA_STATUS_OK;
   sPresCheckStatus = status;
+  sPresCheckPending = false;
   sPresenceCheckEvent.notifyOne();
 }
 
+/*******************************************************************************
+**
+** Function:        startPresenceCheck
+**
+** Description:     Start a presence-check. A check whose result was not
+**                  waited for is still running in NFA; wait for it to end
+**                  first, so that its result is not taken for the result
+**                  of the new one. Caller must hold sPresenceCheckEvent.
+**                  method: Presence-check method.
+**
+** Returns:         Status of NFA_RwPresenceCheck; NFA_STATUS_BUSY if the
+**                  earlier check did not end.
+**
+*******************************************************************************/
+static tNFA_STATUS startPresenceCheck(tNFA_RW_PRES_CHK_OPTION method) {
+  if (sPresCheckPending &&
+      !sPresenceCheckEvent.wait(PresenceCheckEngine::MAX_TIMEOUT,
+                                [] { return !sPresCheckPending; })) {
+    LOG(ERROR) << StringPrintf("%s: earlier check still pending", __func__);
+    return NFA_STATUS_BUSY;
+  }
+  tNFA_STATUS status = NFA_RwPresenceCheck(method);
+  if (status == NFA_STATUS_OK) sPresCheckPending = true;
+  return status;
+}
+
+/*******************************************************************************
+**
+** Function:        waitPresenceCheckResult
+**
+** Description:     Wait for the result of presence-check and learn the
+**                  round trip of the tag if it answered.
+**                  Caller must hold sPresenceCheckEvent.
+**                  fingerprint: Tag fingerprint.
+**                  timeout: Milliseconds to wait.
+**
+** Returns:         True if a result was received.
+**
+*******************************************************************************/
+static bool waitPresenceCheckResult(uint32_t fingerprint, int timeout) {
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  // on timeout the check stays pending; startPresenceCheck() waits it out
+  bool gotResult =
+      sPresenceCheckEvent.wait(timeout, [] { return !sPresCheckPending; });
+  if (gotResult && sIsTagPresent) {
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    int rttMs = (end.tv_sec - start.tv_sec) * 1000 +
+                (end.tv_nsec - start.tv_nsec) / 1000000;
+    PresenceCheckEngine::getInstance().addSample(fingerprint, rttMs);
+    NfcStatsUtil::recordLatency(
+        NfcStatsUtil::HIST_PRESENCE_CHECK_RTT,
+        (uint64_t)(end.tv_sec - start.tv_sec) * 1000000 +
+            (end.tv_nsec - start.tv_nsec) / 1000);
+  }
+  return gotResult;
+}
+
 /*******************************************************************************
 **
 ** Function:        nativeNfcTag_doPresenceCheck
@@ -1603,6 +2112,7 @@ static jboolean nativeNfcTag_doPresenceCheck(JNIEnv*, jobject) {
   DLOG_IF(INFO, nfc_debug_enabled) << StringPrintf("%s", __func__);
   tNFA_STATUS status = NFA_STATUS_OK;
   bool isPresent = false;
+  std::shared_ptr<TagSession> session = TagSession::current();
 
   // Special case for Kovio.  The deactivation would have already occurred
   // but was ignored so that normal tag opertions could complete.  Now we
@@ -1657,16 +2167,15 @@ static jboolean nativeNfcTag_doPresenceCheck(JNIEnv*, jobject) {
     uint8_t bufLen = 0x00;
     bool waitOk = false;
 
-    SyncEventGuard g (sTransceiveEvent);
-    sTransceiveRfTimeout = false;
-    sWaitingForTransceive = true;
+    SyncEventGuard g(session->getTransceiveEvent());
+    session->prepareTransceive();
     bufLen = (uint8_t) sizeof(T3btPresenceCheckCmd);
     status = NFA_SendRawFrame (T3btPresenceCheckCmd, bufLen, NFA_DM_DEFAULT_PRESENCE_CHECK_START_DELAY);
     if (status != NFA_STATUS_OK) {
       DLOG_IF(ERROR, nfc_debug_enabled) << StringPrintf("%s: fail send; error=%d", __func__, status);
     } else
-      waitOk = sTransceiveEvent.wait (NfcTag::getInstance().getTransceiveTimeout(TARGET_TYPE_ISO14443_3B));
-    if (waitOk == false || sTransceiveRfTimeout) { //if timeout occurred
+      waitOk = session->waitResponse (NfcTag::getInstance().getTransceiveTimeout(TARGET_TYPE_ISO14443_3B));
+    if (waitOk == false || session->isRfTimeout()) { //if timeout occurred
       return JNI_FALSE;;
     } else {
       return JNI_TRUE;
@@ -1676,14 +2185,19 @@ static jboolean nativeNfcTag_doPresenceCheck(JNIEnv*, jobject) {
 
   {
     SyncEventGuard guard(sPresenceCheckEvent);
+    PresenceCheckEngine& engine = PresenceCheckEngine::getInstance();
+    uint32_t fingerprint = session->getPresCheckFingerprint();
+    int timeout = engine.getTimeout(fingerprint);
     tNFA_RW_PRES_CHK_OPTION method =
         NfcTag::getInstance().getPresenceCheckAlgorithm();
 
     if (sCurrentConnectedTargetProtocol == NFC_PROTOCOL_ISO_DEP) {
+      // start with the method that worked for this kind of tag before
+      method = engine.getMethod(fingerprint, method);
       if (method == NFA_RW_PRES_CHK_ISO_DEP_NAK) {
-        sIsoDepPresCheckCnt++;
+        session->countIsoDepNakPresCheck();
       }
-      if (sIsoDepPresCheckAlternate == true) {
+      if (session->isIsoDepPresCheckAlternate()) {
         method = NFA_RW_PRES_CHK_I_BLOCK;
       }
     }
@@ -1702,9 +2216,9 @@ static jboolean nativeNfcTag_doPresenceCheck(JNIEnv*, jobject) {
       }
     }
 #endif
-    status = NFA_RwPresenceCheck(method);
+    status = startPresenceCheck(method);
     if (status == NFA_STATUS_OK) {
-      isPresent = sPresenceCheckEvent.wait(2000);
+      isPresent = waitPresenceCheckResult(fingerprint, timeout);
 
       DLOG_IF(INFO, nfc_debug_enabled) << StringPrintf(
           "%s(%d): isPresent = %d", __FUNCTION__, __LINE__, isPresent);
@@ -1717,58 +2231,68 @@ static jboolean nativeNfcTag_doPresenceCheck(JNIEnv*, jobject) {
              (sCurrentConnectedTargetProtocol == NFC_PROTOCOL_T2T) ||
              (sCurrentConnectedTargetProtocol == NFC_PROTOCOL_T5T))) ||
            (sCurrentConnectedTargetProtocol == NFC_PROTOCOL_T3T))) {
-        sPresCheckErrCnt++;
+        session->countPresCheckError();
 #if (NXP_EXTNS == TRUE)
         int retryCount =
             NfcConfig::getUnsigned(NAME_PRESENCE_CHECK_RETRY_COUNT,
                                    DEFAULT_PRESENCE_CHECK_RETRY_COUNT);
-        while (sPresCheckErrCnt <= retryCount) {
+        while (session->getPresCheckErrors() <= retryCount) {
           DLOG_IF(INFO, nfc_debug_enabled) << StringPrintf(
               "%s(%d): pres check failed, try again (attempt #%d/%d)",
-              __FUNCTION__, __LINE__, sPresCheckErrCnt, retryCount);
+              __FUNCTION__, __LINE__, session->getPresCheckErrors(), retryCount);
 #else
-        while (sPresCheckErrCnt <= 3) {
+        while (session->getPresCheckErrors() <= 3) {
           DLOG_IF(INFO, nfc_debug_enabled) << StringPrintf(
               "%s(%d): pres check failed, try again (attempt #%d/3)",
-              __FUNCTION__, __LINE__, sPresCheckErrCnt);
+              __FUNCTION__, __LINE__, session->getPresCheckErrors());
 #endif
 
-          status = NFA_RwPresenceCheck(method);
+          status = startPresenceCheck(method);
 
           if (status == NFA_STATUS_OK) {
-            isPresent = sPresenceCheckEvent.wait(2000);
+            isPresent = waitPresenceCheckResult(fingerprint, timeout);
             DLOG_IF(INFO, nfc_debug_enabled) << StringPrintf(
                 "%s(%d): isPresent = %d", __FUNCTION__, __LINE__, isPresent);
 
             if (!isPresent) {
               break;
             } else if (isPresent && sIsTagPresent) {
-              sPresCheckErrCnt = 0;
+              session->clearPresCheckErrors();
               break;
             } else {
-              sPresCheckErrCnt++;
+              session->countPresCheckError();
             }
+          } else {
+            // no answer from the tag to count; give up on retrying
+            DLOG_IF(INFO, nfc_debug_enabled) << StringPrintf(
+                "%s(%d): cannot start check; status=0x%X", __FUNCTION__,
+                __LINE__, status);
+            break;
           }
         }
       }
 
-      if (isPresent && (sIsoDepPresCheckCnt == 1) && !sIsTagPresent) {
+      if (isPresent && (session->getIsoDepNakPresChecks() == 1) && !sIsTagPresent) {
         DLOG_IF(INFO, nfc_debug_enabled) << StringPrintf(
             "%s(%d): Try alternate method in case tag does not support RNAK",
             __FUNCTION__, __LINE__);
 
         method = NFA_RW_PRES_CHK_I_BLOCK;
-        sIsoDepPresCheckAlternate = true;
-        status = NFA_RwPresenceCheck(method);
+        session->setIsoDepPresCheckAlternate();
+        status = startPresenceCheck(method);
 
         if (status == NFA_STATUS_OK) {
-          isPresent = sPresenceCheckEvent.wait(2000);
+          isPresent = waitPresenceCheckResult(fingerprint, timeout);
           DLOG_IF(INFO, nfc_debug_enabled) << StringPrintf(
               "%s(%d): isPresent = %d", __FUNCTION__, __LINE__, isPresent);
         }
       }
 
       isPresent = isPresent && sIsTagPresent;
+      if (isPresent &&
+          sCurrentConnectedTargetProtocol == NFC_PROTOCOL_ISO_DEP) {
+        engine.learnMethod(fingerprint, method);
+      }
     }
   }
 
@@ -1782,6 +2306,22 @@ static jboolean nativeNfcTag_doPresenceCheck(JNIEnv*, jobject) {
   return isPresent ? JNI_TRUE : JNI_FALSE;
 }
 
+/*******************************************************************************
+**
+** Function:        nativeNfcTag_doGetPresenceCheckInterval
+**
+** Description:     Get the configured upper bound of the presence-check
+**                  interval.
+**                  e: JVM environment.
+**                  o: Java object.
+**
+** Returns:         Interval in milliseconds; 0 if not configured.
+**
+*******************************************************************************/
+static jint nativeNfcTag_doGetPresenceCheckInterval(JNIEnv*, jobject) {
+  return PresenceCheckEngine::getInstance().getPollInterval();
+}
+
 /*******************************************************************************
 **
 ** Function:        nativeNfcTag_doIsNdefFormatable
@@ -2123,11 +2663,21 @@ static JNINativeMethod gMethods[] = {
     {"doReconnect", "()I", (void*)nativeNfcTag_doReconnect},
     {"doHandleReconnect", "(I)I", (void*)nativeNfcTag_doHandleReconnect},
     {"doTransceive", "([BZ[I)[B", (void*)nativeNfcTag_doTransceive},
+    {"doTransceiveDirect",
+     "(Ljava/nio/ByteBuffer;ILjava/nio/ByteBuffer;[I)I",
+     (void*)nativeNfcTag_doTransceiveDirect},
+    {"doTransceiveBatch", "([[B[I[IZ[I)[B",
+     (void*)nativeNfcTag_doTransceiveBatch},
+    {"doTransceiveStreaming",
+     "([BLcom/android/nfc/dhimpl/NativeNfcTag$FragmentConsumer;[I)I",
+     (void*)nativeNfcTag_doTransceiveStreaming},
     {"doGetNdefType", "(II)I", (void*)nativeNfcTag_doGetNdefType},
     {"doCheckNdef", "([I)I", (void*)nativeNfcTag_doCheckNdef},
     {"doRead", "()[B", (void*)nativeNfcTag_doRead},
     {"doWrite", "([B)Z", (void*)nativeNfcTag_doWrite},
     {"doPresenceCheck", "()Z", (void*)nativeNfcTag_doPresenceCheck},
+    {"doGetPresenceCheckInterval", "()I",
+     (void*)nativeNfcTag_doGetPresenceCheckInterval},
     {"doIsIsoDepNdefFormatable", "([B[B)Z",
      (void*)nativeNfcTag_doIsIsoDepNdefFormatable},
     {"doNdefFormat", "([B)Z", (void*)nativeNfcTag_doNdefFormat},
@@ -23,6 +23,7 @@
 #include "NfcAdaptation.h"
 #include "NfcJniUtil.h"
 #include "RoutingManager.h"
+#include "ConfigParamCache.h"
 #include "SyncEvent.h"
 #include "config.h"
 #include "nfc_config.h"
@@ -102,6 +103,7 @@ tNFA_STATUS NxpNfc_Write_Cmd_Common(uint8_t retlen, uint8_t* buffer) {
     DLOG_IF(INFO, nfc_debug_enabled)
         << StringPrintf("%s: Success NFA_SendRawVsCommand", __func__);
     gnxpfeature_conf.NxpFeatureConfigEvt.wait(); /* wait for callback */
+    ConfigParamCache::getInstance().onRawCommand(buffer, retlen);
   } else {
     LOG(ERROR) << StringPrintf("%s: Failed NFA_SendRawVsCommand", __func__);
   }
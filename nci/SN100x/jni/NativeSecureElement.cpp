@@ -25,6 +25,7 @@
 #include <nativehelper/ScopedLocalRef.h>
 #include "JavaClassConstants.h"
 #include "NfcJniUtil.h"
+#include "NfcTrace.h"
 #include "config.h"
 #include "SecureElement.h"
 #include "NfcAdaptation.h"
@@ -290,10 +291,9 @@ static jbyteArray nativeNfcSecureElement_doGetAtr (JNIEnv* e, jobject, jint hand
 *******************************************************************************/
 static jbyteArray nativeNfcSecureElement_doTransceive (JNIEnv* e, jobject, jint handle, jbyteArray data)
 {
+    NFC_TRACE_SCOPE("se", "doTransceive");
     const int32_t recvBufferMaxSize = 0x800B;//32k(8000) datasize + 10b Protocol Header Size + 1b support neg testcase
-    std::unique_ptr<uint8_t> recvBuffer(new uint8_t[recvBufferMaxSize]);;
-    int32_t recvBufferActualSize = 0;
-    ScopedByteArrayRW bytes(e, data);
+    ScopedByteArrayRO bytes(e, data);
     LOG(INFO) << StringPrintf("%s: enter; handle=0x%X; buf len=%zu", __func__, handle, bytes.size());
     if(bytes.size() > recvBufferMaxSize) {
         LOG(ERROR) << StringPrintf("%s: datasize not supported", __func__);
@@ -309,16 +309,25 @@ static jbyteArray nativeNfcSecureElement_doTransceive (JNIEnv* e, jobject, jint
     if(!se.mIsWiredModeOpen)
         return NULL;
 
-    se.transceive(reinterpret_cast<uint8_t*>(&bytes[0]), bytes.size(),
-                  recvBuffer.get(), recvBufferMaxSize, recvBufferActualSize,
+    //copy results to java straight from the response buffer
+    jbyteArray result = NULL;
+    int32_t recvBufferActualSize = 0;
+    bool responded = false;
+    se.transceive(const_cast<uint8_t*>(reinterpret_cast<const uint8_t*>(bytes.get())),
+                  bytes.size(), recvBufferMaxSize,
+                  [&](const uint8_t* rsp, int32_t rspLen) {
+                      NFC_TRACE_SCOPE("se", "marshal");
+                      responded = true;
+                      recvBufferActualSize = rspLen;
+                      result = e->NewByteArray(rspLen);
+                      if (result != NULL)
+                      {
+                          e->SetByteArrayRegion(result, 0, rspLen, (const jbyte *) rsp);
+                      }
+                  },
                   se.SmbTransceiveTimeOutVal, handle);
-
-    //copy results back to java
-    jbyteArray result = e->NewByteArray(recvBufferActualSize);
-    if (result != NULL)
-    {
-        e->SetByteArrayRegion(result, 0, recvBufferActualSize, (jbyte *) recvBuffer.get());
-    }
+    if (!responded)
+        result = e->NewByteArray(0);
 
     LOG(INFO) << StringPrintf("%s: exit: recv len=%d", __func__, recvBufferActualSize);
     return result;
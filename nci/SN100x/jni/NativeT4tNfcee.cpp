@@ -18,6 +18,8 @@
 #if (NXP_EXTNS == TRUE)
 #include "NativeT4tNfcee.h"
 #include <android-base/stringprintf.h>
+#include <algorithm>
+#include <vector>
 #include <base/logging.h>
 #include <nativehelper/ScopedPrimitiveArray.h>
 #include "MposManager.h"
@@ -47,6 +49,11 @@ extern int nfcManager_doPartialInitialize(JNIEnv* e, jobject o, jint mode);
 extern int nfcManager_doPartialDeInitialize(JNIEnv*, jobject);
 }  // namespace android
 
+// cache key of a file ID
+static uint16_t getFileKey(const uint8_t* fileId) {
+  return (fileId[0] << 8) | fileId[1];
+}
+
 NativeT4tNfcee NativeT4tNfcee::sNativeT4tNfceeInstance;
 bool NativeT4tNfcee::sIsNfcOffTriggered = false;
 
@@ -77,6 +84,13 @@ NativeT4tNfcee& NativeT4tNfcee::getInstance() {
 void NativeT4tNfcee::initialize(void) {
   sIsNfcOffTriggered = false;
   mBusy = false;
+  // the NFCC was reset
+  mContentCache.invalidateClean();
+  AutoMutex lock(mOpMutex);
+  // the timer was killed by onNfccShutdown(), maybe with updates left
+  mWriteBackAttempts = 0;
+  mWriteBackArmed = mContentCache.hasDirty() &&
+                    mWriteBackTimer.set(WRITE_BACK_DELAY_MS, writeBackTimerCb);
 }
 
 /*****************************************************************************
@@ -89,6 +103,14 @@ void NativeT4tNfcee::initialize(void) {
 **
 *******************************************************************************/
 void NativeT4tNfcee::onNfccShutdown() {
+  mWriteBackTimer.kill();
+  /* Write pending updates while the NFCEE can be reached */
+  if (!mBusy && mOpMutex.tryLock()) {
+    mWriteBackArmed = false;
+    if (!writePending())
+      LOG(ERROR) << StringPrintf("%s: updates not written", __func__);
+    mOpMutex.unlock();
+  }
   sIsNfcOffTriggered = true;
   if(mBusy) {
     /* Unblock JNI APIs */
@@ -104,6 +126,20 @@ void NativeT4tNfcee::onNfccShutdown() {
     resetBusy();
   }
 }
+
+/*******************************************************************************
+**
+** Function:        invalidateCache
+**
+** Description:     Forget the cached file content that may have changed
+**                  on the NFCEE: after an RF field, as a reader may have
+**                  written it, or after an NFCC reset. Updates not written
+**                  yet are kept.
+**
+** Returns:         None.
+**
+*******************************************************************************/
+void NativeT4tNfcee::invalidateCache() { mContentCache.invalidateClean(); }
 /*******************************************************************************
 **
 ** Function:        t4tClearData
@@ -164,6 +200,10 @@ jboolean NativeT4tNfcee::performT4tClearData(uint8_t* fileId) {
   bool t4tClearReturn = false;
   tNFA_STATUS status = NFA_STATUS_FAILED;
 
+  AutoMutex lock(mOpMutex);
+  mContentCache.invalidate(getFileKey(fileId));
+  mWriteBackErrors.erase(getFileKey(fileId));
+
   /*Open connection and stop discovery*/
   if (setup() != NFA_STATUS_OK) return t4tClearReturn;
 
@@ -196,8 +236,6 @@ jboolean NativeT4tNfcee::performT4tClearData(uint8_t* fileId) {
 *******************************************************************************/
 jint NativeT4tNfcee::t4tWriteData(JNIEnv* e, jobject object, jbyteArray fileId,
                                   jbyteArray data, int length) {
-  tNFA_STATUS status = NFA_STATUS_FAILED;
-
   T4TNFCEE_STATUS_t t4tNfceeStatus =
       validatePreCondition(OP_WRITE, fileId, data);
   if (t4tNfceeStatus != STATUS_SUCCESS) return t4tNfceeStatus;
@@ -222,37 +260,20 @@ jint NativeT4tNfcee::t4tWriteData(JNIEnv* e, jobject object, jbyteArray fileId,
     return ERROR_INVALID_LENGTH;
   }
 
-  if (setup() != NFA_STATUS_OK) return ERROR_CONNECTION_FAILED;
-
   uint8_t* pFileId = NULL;
   pFileId = const_cast<uint8_t*>(reinterpret_cast<const uint8_t*>(&bytes[0]));
 
+  AutoMutex lock(mOpMutex);
+  // this write replaces any update not written yet
+  mContentCache.invalidate(getFileKey(pFileId));
+  mWriteBackErrors.erase(getFileKey(pFileId));
+
+  if (setup() != NFA_STATUS_OK) return ERROR_CONNECTION_FAILED;
+
   uint8_t* pData = NULL;
   pData = const_cast<uint8_t*>(reinterpret_cast<const uint8_t*>(&bytesData[0]));
 
-  jint t4tWriteReturn = STATUS_FAILED;
-  {
-    SyncEventGuard g(mT4tNfcEeRWEvent);
-    status = NFA_T4tNfcEeWrite(pFileId, pData, bytesData.size());
-    if (status == NFA_STATUS_OK) {
-      if (mT4tNfcEeRWEvent.wait(T4TNFCEE_TIMEOUT) == false)
-        t4tWriteReturn = STATUS_FAILED;
-      else {
-        if (mT4tOpStatus == NFA_STATUS_OK) {
-          /*if status is success then return length of data written*/
-          t4tWriteReturn = mReadData.len;
-        } else if (mT4tOpStatus == NFA_STATUS_REJECTED) {
-          t4tWriteReturn = ERROR_NDEF_VALIDATION_FAILED;
-        } else if (mT4tOpStatus == NFA_T4T_STATUS_INVALID_FILE_ID){
-          t4tWriteReturn = ERROR_INVALID_FILE_ID;
-        } else if (mT4tOpStatus == NFA_STATUS_READ_ONLY) {
-          t4tWriteReturn = ERROR_WRITE_PERMISSION;
-        } else {
-          t4tWriteReturn = STATUS_FAILED;
-        }
-      }
-    }
-  }
+  jint t4tWriteReturn = writeFile(pFileId, pData, bytesData.size());
 
   /*Close connection and start discovery*/
   cleanup();
@@ -261,6 +282,99 @@ jint NativeT4tNfcee::t4tWriteData(JNIEnv* e, jobject object, jbyteArray fileId,
   return t4tWriteReturn;
 }
 
+/*******************************************************************************
+**
+** Function:        t4tWriteData
+**
+** Description:     Write data at an offset of the T4T file of the specific
+**                  file ID, keeping the rest of the file. Nothing is
+**                  written if the file holds the data already, so that an
+**                  interrupted series of writes resumes at the first range
+**                  not written yet.
+**                  offset: Offset of the data in the file; at most the
+**                  size of the file.
+**
+** Returns:         Return the size of data written
+**                  Return negative number of error code
+**
+*******************************************************************************/
+jint NativeT4tNfcee::t4tWriteData(JNIEnv* e, jobject object, jbyteArray fileId,
+                                  jint offset, jbyteArray data) {
+  T4TNFCEE_STATUS_t t4tNfceeStatus =
+      validatePreCondition(OP_WRITE, fileId, data);
+  if (t4tNfceeStatus != STATUS_SUCCESS) return t4tNfceeStatus;
+
+  ScopedByteArrayRO bytes(e, fileId);
+  if (bytes.size() < FILE_ID_LEN) {
+    DLOG_IF(ERROR, nfc_debug_enabled)
+        << StringPrintf("%s:Wrong File Id", __func__);
+    return ERROR_INVALID_FILE_ID;
+  }
+
+  ScopedByteArrayRO bytesData(e, data);
+  if (bytesData.size() == 0x00) {
+    DLOG_IF(ERROR, nfc_debug_enabled)
+        << StringPrintf("%s:Empty Data", __func__);
+    return ERROR_EMPTY_PAYLOAD;
+  }
+  if (offset < 0) {
+    DLOG_IF(ERROR, nfc_debug_enabled)
+        << StringPrintf("%s:Invalid Offset", __func__);
+    return ERROR_INVALID_LENGTH;
+  }
+
+  uint8_t* pFileId = NULL;
+  pFileId = const_cast<uint8_t*>(reinterpret_cast<const uint8_t*>(&bytes[0]));
+  uint16_t fileKey = getFileKey(pFileId);
+  const uint8_t* pData = reinterpret_cast<const uint8_t*>(&bytesData[0]);
+  size_t dataLen = bytesData.size();
+
+  AutoMutex lock(mOpMutex);
+  auto failed = mWriteBackErrors.find(fileKey);
+  if (failed != mWriteBackErrors.end()) {
+    jint error = failed->second;
+    mWriteBackErrors.erase(failed);
+    LOG(ERROR) << StringPrintf("%s: earlier update of 0x%04X failed; error=%d",
+                               __func__, fileKey, error);
+    return error;
+  }
+  std::vector<uint8_t> file;
+  if (!mContentCache.get(fileKey, file)) {
+    if (setup() != NFA_STATUS_OK) return ERROR_CONNECTION_FAILED;
+    tNFA_STATUS status = readRange(pFileId, 0, UINT32_MAX, file);
+    /*Close connection and start discovery*/
+    cleanup();
+    if (status == NFA_T4T_STATUS_INVALID_FILE_ID) return ERROR_INVALID_FILE_ID;
+    if (status != NFA_STATUS_OK) return STATUS_FAILED;
+    mContentCache.put(fileKey, file, false);
+  }
+
+  if ((size_t)offset > file.size()) {
+    DLOG_IF(ERROR, nfc_debug_enabled) << StringPrintf(
+        "%s:Offset %d beyond file of %zu", __func__, offset, file.size());
+    return ERROR_INVALID_LENGTH;
+  }
+  if (((size_t)offset + dataLen <= file.size()) &&
+      std::equal(pData, pData + dataLen, file.begin() + offset)) {
+    DLOG_IF(INFO, nfc_debug_enabled)
+        << StringPrintf("%s:Data already written", __func__);
+    return dataLen;
+  }
+
+  // NFA writes whole files: updates are gathered and written back together
+  mContentCache.patch(fileKey, offset, pData, dataLen);
+  // armed by the first update only, so that steady updates are still
+  // written every WRITE_BACK_DELAY_MS
+  if (!mWriteBackArmed) {
+    mWriteBackAttempts = 0;
+    mWriteBackArmed = mWriteBackTimer.set(WRITE_BACK_DELAY_MS,
+                                          writeBackTimerCb);
+  }
+  DLOG_IF(INFO, nfc_debug_enabled) << StringPrintf(
+      "%s:Exit: %zu octets at %d queued", __func__, dataLen, offset);
+  return dataLen;
+}
+
 /*******************************************************************************
 **
 ** Function:        t4tReadData
@@ -289,29 +403,41 @@ jbyteArray NativeT4tNfcee::t4tReadData(JNIEnv* e, jobject object,
     return NULL;
   }
 
-  if (setup() != NFA_STATUS_OK) return NULL;
-
   uint8_t* pFileId = NULL;
   pFileId = const_cast<uint8_t*>(reinterpret_cast<const uint8_t*>(&bytes[0]));
-
-  { /*syncEvent code section*/
-    SyncEventGuard g(mT4tNfcEeRWEvent);
-    sRxDataBuffer.clear();
-    status = NFA_T4tNfcEeRead(pFileId);
-    if ((status != NFA_STATUS_OK) ||
-        (mT4tNfcEeRWEvent.wait(T4TNFCEE_TIMEOUT) == false)) {
-      DLOG_IF(ERROR, nfc_debug_enabled)
-          << StringPrintf("%s:Read Failed, status = 0x%X", __func__, status);
-      cleanup();
-      return NULL;
+  uint16_t fileKey = getFileKey(pFileId);
+
+  AutoMutex lock(mOpMutex);
+  std::vector<uint8_t> rxData;
+  if (mContentCache.get(fileKey, rxData) && rxData.size() > 0) {
+    DLOG_IF(INFO, nfc_debug_enabled)
+        << StringPrintf("%s:Cached file 0x%04X", __func__, fileKey);
+    result.reset(e->NewByteArray(rxData.size()));
+    if (result.get() != NULL) {
+      e->SetByteArrayRegion(result.get(), 0, rxData.size(),
+                            (const jbyte*)rxData.data());
     }
+    return result.release();
   }
 
-  if (sRxDataBuffer.size() > 0) {
-    result.reset(e->NewByteArray(sRxDataBuffer.size()));
+  if (setup() != NFA_STATUS_OK) return NULL;
+
+  status = readRange(pFileId, 0, UINT32_MAX, rxData);
+  if (status != NFA_STATUS_OK && status != NFA_T4T_STATUS_INVALID_FILE_ID) {
+    DLOG_IF(ERROR, nfc_debug_enabled)
+        << StringPrintf("%s:Read Failed, status = 0x%X", __func__, status);
+    cleanup();
+    return NULL;
+  }
+  if (status == NFA_STATUS_OK && rxData.size() > 0) {
+    mContentCache.put(fileKey, rxData, false);
+  }
+
+  if (rxData.size() > 0) {
+    result.reset(e->NewByteArray(rxData.size()));
     if (result.get() != NULL) {
-      e->SetByteArrayRegion(result.get(), 0, sRxDataBuffer.size(),
-            (const jbyte*)sRxDataBuffer.data());
+      e->SetByteArrayRegion(result.get(), 0, rxData.size(),
+            (const jbyte*)rxData.data());
     } else {
       char data[1] = {(char)0xFF};
       result.reset(e->NewByteArray(0x01));
@@ -319,8 +445,7 @@ jbyteArray NativeT4tNfcee::t4tReadData(JNIEnv* e, jobject object,
       LOG(ERROR) << StringPrintf("%s: Failed to allocate java byte array",
                __func__);
     }
-    sRxDataBuffer.clear();
-  } else if (mT4tOpStatus == NFA_T4T_STATUS_INVALID_FILE_ID){
+  } else if (status == NFA_T4T_STATUS_INVALID_FILE_ID){
     char data[1] = {(char)0xFF};
     result.reset(e->NewByteArray(0x01));
     e->SetByteArrayRegion(result.get(), 0, 0x01, (jbyte*)data);
@@ -330,6 +455,278 @@ jbyteArray NativeT4tNfcee::t4tReadData(JNIEnv* e, jobject object,
   return result.release();
 }
 
+/*******************************************************************************
+**
+** Function:        t4tReadData
+**
+** Description:     Read a range of the T4T file of the specific file ID.
+**                  offset: Offset of the range in the file.
+**                  length: Length of the range.
+**
+** Returns:         byte[] : the data of the range within the file; shorter
+**                  than length if the file ends first.
+**                  Return null if reading fails.
+**
+*******************************************************************************/
+jbyteArray NativeT4tNfcee::t4tReadData(JNIEnv* e, jobject object,
+                                       jbyteArray fileId, jint offset,
+                                       jint length) {
+  T4TNFCEE_STATUS_t t4tNfceeStatus = validatePreCondition(OP_READ, fileId);
+  if (t4tNfceeStatus != STATUS_SUCCESS) return NULL;
+
+  ScopedByteArrayRO bytes(e, fileId);
+  if (bytes.size() < FILE_ID_LEN) {
+    DLOG_IF(ERROR, nfc_debug_enabled)
+        << StringPrintf("%s:Wrong File Id", __func__);
+    return NULL;
+  }
+  if (offset < 0 || length <= 0) {
+    DLOG_IF(ERROR, nfc_debug_enabled) << StringPrintf(
+        "%s:Invalid range %d+%d", __func__, offset, length);
+    return NULL;
+  }
+
+  uint8_t* pFileId = NULL;
+  pFileId = const_cast<uint8_t*>(reinterpret_cast<const uint8_t*>(&bytes[0]));
+
+  AutoMutex lock(mOpMutex);
+  std::vector<uint8_t> rxData;
+  if (mContentCache.get(getFileKey(pFileId), rxData)) {
+    size_t start = std::min((size_t)offset, rxData.size());
+    size_t end = std::min(start + length, rxData.size());
+    rxData.erase(rxData.begin() + end, rxData.end());
+    rxData.erase(rxData.begin(), rxData.begin() + start);
+  } else {
+    if (setup() != NFA_STATUS_OK) return NULL;
+
+    // only the range is kept, however large the file
+    tNFA_STATUS status = readRange(pFileId, offset, length, rxData);
+
+    /*Close connection and start discovery*/
+    cleanup();
+    if (status != NFA_STATUS_OK) {
+      DLOG_IF(ERROR, nfc_debug_enabled)
+          << StringPrintf("%s:Read Failed, status = 0x%X", __func__, status);
+      return NULL;
+    }
+  }
+
+  jbyteArray result = e->NewByteArray(rxData.size());
+  if (result != NULL) {
+    e->SetByteArrayRegion(result, 0, rxData.size(),
+                          (const jbyte*)rxData.data());
+  }
+  return result;
+}
+
+/*******************************************************************************
+**
+** Function:        readRange
+**
+** Description:     Read a range of a file. NFA reads the whole file in one
+**                  operation; only the range is kept. The connection must
+**                  be open.
+**                  fileId: File ID.
+**                  offset: Offset of the range in the file.
+**                  length: Length of the range.
+**                  data: Receives the data of the range; shorter than
+**                  length if the file ends first.
+**
+** Returns:         Status of the read.
+**
+*******************************************************************************/
+tNFA_STATUS NativeT4tNfcee::readRange(uint8_t* fileId, uint32_t offset,
+                                      uint32_t length,
+                                      std::vector<uint8_t>& data) {
+  tNFA_STATUS status = NFA_STATUS_FAILED;
+  SyncEventGuard g(mT4tNfcEeRWEvent);
+  data.clear();
+  mReadRange = &data;
+  mReadOffset = offset;
+  mReadLength = length;
+  status = NFA_T4tNfcEeRead(fileId);
+  if (status == NFA_STATUS_OK) {
+    if (mT4tNfcEeRWEvent.wait(T4TNFCEE_TIMEOUT)) {
+      status = mT4tOpStatus;
+    } else {
+      // a late completion is dropped, as mReadRange is reset
+      LOG(ERROR) << StringPrintf("%s: timeout", __func__);
+      status = NFA_STATUS_FAILED;
+    }
+  }
+  mReadRange = nullptr;
+  return status;
+}
+
+/*******************************************************************************
+**
+** Function:        writeFile
+**
+** Description:     Write the whole content of a file. The connection must
+**                  be open.
+**                  fileId: File ID.
+**                  data: Content.
+**                  len: Length of the content.
+**
+** Returns:         Return the size of data written
+**                  Return negative number of error code
+**
+*******************************************************************************/
+jint NativeT4tNfcee::writeFile(uint8_t* fileId, uint8_t* data, uint32_t len) {
+  jint t4tWriteReturn = STATUS_FAILED;
+  SyncEventGuard g(mT4tNfcEeRWEvent);
+  tNFA_STATUS status = NFA_T4tNfcEeWrite(fileId, data, len);
+  if (status == NFA_STATUS_OK) {
+    if (mT4tNfcEeRWEvent.wait(T4TNFCEE_TIMEOUT) == false)
+      t4tWriteReturn = STATUS_FAILED;
+    else {
+      if (mT4tOpStatus == NFA_STATUS_OK) {
+        /*if status is success then return length of data written*/
+        t4tWriteReturn = mReadData.len;
+      } else if (mT4tOpStatus == NFA_STATUS_REJECTED) {
+        t4tWriteReturn = ERROR_NDEF_VALIDATION_FAILED;
+      } else if (mT4tOpStatus == NFA_T4T_STATUS_INVALID_FILE_ID){
+        t4tWriteReturn = ERROR_INVALID_FILE_ID;
+      } else if (mT4tOpStatus == NFA_STATUS_READ_ONLY) {
+        t4tWriteReturn = ERROR_WRITE_PERMISSION;
+      } else {
+        t4tWriteReturn = STATUS_FAILED;
+      }
+    }
+  }
+  return t4tWriteReturn;
+}
+
+/*******************************************************************************
+**
+** Function:        writeBack
+**
+** Description:     Write the updated files to the NFCEE, or try again
+**                  later if it cannot be reached now.
+**
+** Returns:         None
+**
+*******************************************************************************/
+void NativeT4tNfcee::writeBack() {
+  AutoMutex lock(mOpMutex);
+  mWriteBackArmed = false;
+  if (!android::nfcManager_isNfcActive() || sIsNfcOffTriggered) {
+    LOG(ERROR) << StringPrintf("%s: NFC is off; updates not written",
+                               __func__);
+    return;
+  }
+  if (!gActivated && !MposManager::getInstance().isMposOngoing() &&
+      writePending()) {
+    mWriteBackAttempts = 0;
+    return;
+  }
+  if (++mWriteBackAttempts < MAX_WRITE_BACK_ATTEMPTS) {
+    DLOG_IF(INFO, nfc_debug_enabled)
+        << StringPrintf("%s: NFCEE busy; try again", __func__);
+    mWriteBackArmed = mWriteBackTimer.set(WRITE_BACK_DELAY_MS,
+                                          writeBackTimerCb);
+    return;
+  }
+  LOG(ERROR) << StringPrintf("%s: NFCEE not reachable; updates dropped",
+                             __func__);
+  mWriteBackAttempts = 0;
+  T4tContentCache::Update update;
+  while (mContentCache.takeDirty(update)) {
+    mContentCache.invalidate(update.fileId);
+    mWriteBackErrors[update.fileId] = ERROR_CONNECTION_FAILED;
+  }
+}
+
+/*******************************************************************************
+**
+** Function:        writePending
+**
+** Description:     Write the updated files to the NFCEE. mOpMutex must be
+**                  held.
+**
+** Returns:         False if some file is still to be written.
+**
+*******************************************************************************/
+bool NativeT4tNfcee::writePending() {
+  T4tContentCache::Update update;
+  while (mContentCache.hasDirty()) {
+    if (setup() != NFA_STATUS_OK) return false;
+    if (mContentCache.takeDirty(update)) writeUpdate(update);
+    /*Close connection and start discovery*/
+    cleanup();
+  }
+  return true;
+}
+
+/*******************************************************************************
+**
+** Function:        writeUpdate
+**
+** Description:     Write an updated file, unless a reader wrote the file
+**                  since the update was based on it. The connection must
+**                  be open and mOpMutex held.
+**                  update: Updated file.
+**
+** Returns:         None; an error is kept in mWriteBackErrors.
+**
+*******************************************************************************/
+void NativeT4tNfcee::writeUpdate(const T4tContentCache::Update& update) {
+  uint8_t fileId[FILE_ID_LEN] = {(uint8_t)(update.fileId >> 8),
+                                 (uint8_t)(update.fileId & 0xFF)};
+  if (update.stale) {
+    // an RF field came up since the update was based on the file
+    std::vector<uint8_t> current;
+    tNFA_STATUS status = readRange(fileId, 0, UINT32_MAX, current);
+    if (status != NFA_STATUS_OK) {
+      LOG(ERROR) << StringPrintf("%s: file 0x%04X not checked; status=0x%X",
+                                 __func__, update.fileId, status);
+      mContentCache.invalidate(update.fileId);
+      mWriteBackErrors[update.fileId] = STATUS_FAILED;
+      return;
+    }
+    if (current != update.base) {
+      // the reader's content is kept
+      LOG(ERROR) << StringPrintf("%s: file 0x%04X written by a reader",
+                                 __func__, update.fileId);
+      mContentCache.put(update.fileId, current, false);
+      mWriteBackErrors[update.fileId] = ERROR_WRITE_BACK_CONFLICT;
+      return;
+    }
+  }
+  jint t4tWriteReturn =
+      writeFile(fileId, const_cast<uint8_t*>(update.content.data()),
+                update.content.size());
+  if (t4tWriteReturn < 0) {
+    // the NFCEE content is unknown now
+    LOG(ERROR) << StringPrintf("%s: file 0x%04X not written; status=%d",
+                               __func__, update.fileId, t4tWriteReturn);
+    mContentCache.invalidate(update.fileId);
+    mWriteBackErrors[update.fileId] = t4tWriteReturn;
+  }
+}
+
+void NativeT4tNfcee::writeBackWorker() {
+  for (;;) {
+    {
+      SyncEventGuard guard(mWriteBackEvent);
+      while (!mWriteBackRequested) mWriteBackEvent.wait();
+      mWriteBackRequested = false;
+    }
+    writeBack();
+  }
+}
+
+void NativeT4tNfcee::writeBackTimerCb(union sigval) {
+  NativeT4tNfcee& t4t = getInstance();
+  SyncEventGuard guard(t4t.mWriteBackEvent);
+  if (!t4t.mWriteBackWorkerStarted) {
+    std::thread(&NativeT4tNfcee::writeBackWorker, &t4t).detach();
+    t4t.mWriteBackWorkerStarted = true;
+  }
+  t4t.mWriteBackRequested = true;
+  t4t.mWriteBackEvent.notifyOne();
+}
+
 /*******************************************************************************
 **
 ** Function:        openConnection
@@ -498,15 +895,18 @@ T4TNFCEE_STATUS_t NativeT4tNfcee::validatePreCondition(T4TNFCEE_OPERATIONS_t op,
 **
 *******************************************************************************/
 void NativeT4tNfcee::t4tReadComplete(tNFA_STATUS status, tNFA_RX_DATA data) {
+  SyncEventGuard g(mT4tNfcEeRWEvent);
   mT4tOpStatus = status;
-  if (status == NFA_STATUS_OK) {
-    if(data.len > 0) {
-      sRxDataBuffer.append(data.p_data, data.len);
-      DLOG_IF(INFO, nfc_debug_enabled)
+  if (status == NFA_STATUS_OK && data.len > 0 && mReadRange != nullptr) {
+    DLOG_IF(INFO, nfc_debug_enabled)
         << StringPrintf("%s: Read Data len new: %d ", __func__, data.len);
+    // data is the whole file
+    if (mReadOffset < data.len) {
+      uint32_t len = std::min(mReadLength, data.len - mReadOffset);
+      mReadRange->assign(data.p_data + mReadOffset,
+                         data.p_data + mReadOffset + len);
     }
   }
-  SyncEventGuard g(mT4tNfcEeRWEvent);
   mT4tNfcEeRWEvent.notifyOne();
 }
 
@@ -16,8 +16,14 @@
  *
  ******************************************************************************/
 #if (NXP_EXTNS == TRUE)
+#include <map>
+#include <thread>
+#include <vector>
+#include "IntervalTimer.h"
+#include "Mutex.h"
 #include "NfcJniUtil.h"
 #include "SyncEvent.h"
+#include "T4tContentCache.h"
 #include "nfa_api.h"
 #include <nativehelper/ScopedLocalRef.h>
 #define t4tNfcEe (NativeT4tNfcee::getInstance())
@@ -37,6 +43,7 @@ typedef enum {
   ERROR_NDEF_VALIDATION_FAILED = -9,
   ERROR_WRITE_PERMISSION = -10,
   ERROR_NFC_OFF_TRIGGERED = -11,
+  ERROR_WRITE_BACK_CONFLICT = -12,
 } T4TNFCEE_STATUS_t;
 
 class NativeT4tNfcee {
@@ -74,6 +81,21 @@ class NativeT4tNfcee {
   *******************************************************************************/
   void onNfccShutdown();
 
+  /*******************************************************************************
+  **
+  ** Function:        invalidateCache
+  **
+  ** Description:     Forget the cached file content that may have changed
+  **                  on the NFCEE: after an RF field, as a reader may have
+  **                  written it, or after an NFCC reset. Updates not written
+  **                  yet are kept, and are dropped at write-back if the
+  **                  file was written in between.
+  **
+  ** Returns:         None.
+  **
+  *******************************************************************************/
+  void invalidateCache();
+
   /*******************************************************************************
   **
   ** Function:        t4tWriteData
@@ -88,6 +110,30 @@ class NativeT4tNfcee {
                    int length);
   /*******************************************************************************
   **
+  ** Function:        t4tWriteData
+  **
+  ** Description:     Write data at an offset of the T4T file of the specific
+  **                  file ID, keeping the rest of the file. Nothing is
+  **                  written if the file holds the data already, so that an
+  **                  interrupted series of writes resumes at the first range
+  **                  not written yet. The data goes to the cache and is
+  **                  written back after WRITE_BACK_DELAY_MS, together with
+  **                  the updates that follow it. If that write fails, the
+  **                  next call for the file returns its error and does not
+  **                  write: ERROR_WRITE_BACK_CONFLICT if a reader wrote the
+  **                  file in between, which keeps the reader's content.
+  **                  offset: Offset of the data in the file; at most the
+  **                  size of the file.
+  **
+  ** Returns:         Return the size of data written
+  **                  Return negative number of error code, maybe of an
+  **                  earlier update
+  **
+  *******************************************************************************/
+  int t4tWriteData(JNIEnv* e, jobject o, jbyteArray fileId, jint offset,
+                   jbyteArray data);
+  /*******************************************************************************
+  **
   ** Function:        t4tClearData
   **
   ** Description:     This API will set all the T4T NFCEE NDEF data to zero.
@@ -124,6 +170,21 @@ class NativeT4tNfcee {
   **
   *******************************************************************************/
   jbyteArray t4tReadData(JNIEnv* e, jobject o, jbyteArray fileId);
+  /*******************************************************************************
+  **
+  ** Function:        t4tReadData
+  **
+  ** Description:     Read a range of the T4T file of the specific file ID.
+  **                  offset: Offset of the range in the file.
+  **                  length: Length of the range.
+  **
+  ** Returns:         byte[] : the data of the range within the file; shorter
+  **                  than length if the file ends first.
+  **                  Return null if reading fails.
+  **
+  *******************************************************************************/
+  jbyteArray t4tReadData(JNIEnv* e, jobject o, jbyteArray fileId, jint offset,
+                         jint length);
 
   /*******************************************************************************
   **
@@ -271,6 +332,8 @@ class NativeT4tNfcee {
   static const int NXP_PARAM_GET_CONFIG_INDEX1 = 8;
   static const int NXP_PARAM_SET_CONFIG_LEN = 0x09;
   static const int NXP_PARAM_SET_CONFIG_PARAM = 0x02;
+  static const int WRITE_BACK_DELAY_MS = 100;
+  static const int MAX_WRITE_BACK_ATTEMPTS = 10;
   static NativeT4tNfcee sNativeT4tNfceeInstance;
   static bool sIsNfcOffTriggered;
   SyncEvent mT4tNfcOffEvent;
@@ -281,9 +344,110 @@ class NativeT4tNfcee {
   tNFA_RX_DATA mReadData;
   tNFA_STATUS mT4tOpStatus = NFA_STATUS_FAILED;
   tNFA_STATUS mT4tNfcEeEventStat = NFA_STATUS_FAILED;
-  std::basic_string<uint8_t> sRxDataBuffer;
+  // read in progress; guarded by mT4tNfcEeRWEvent
+  std::vector<uint8_t>* mReadRange = nullptr;
+  uint32_t mReadOffset = 0;
+  uint32_t mReadLength = 0;
+  Mutex mOpMutex;  // serializes NFCEE operations, write-back included
+  T4tContentCache mContentCache;
+  IntervalTimer mWriteBackTimer;
+  bool mWriteBackArmed = false;  // guarded by mOpMutex
+  int mWriteBackAttempts = 0;    // guarded by mOpMutex
+  // errors of written back updates, by file; guarded by mOpMutex
+  std::map<uint16_t, jint> mWriteBackErrors;
+  // wakes writeBackWorker(); the flags are guarded by it
+  SyncEvent mWriteBackEvent;
+  bool mWriteBackRequested = false;
+  bool mWriteBackWorkerStarted = false;
   NativeT4tNfcee();
 
+  /*******************************************************************************
+  **
+  ** Function:        writeBackWorker
+  **
+  ** Description:     Run writeBack() whenever the write-back timer expires,
+  **                  so that NFCEE I/O does not hold a timer thread.
+  **
+  ** Returns:         None
+  **
+  *******************************************************************************/
+  void writeBackWorker();
+
+  /*******************************************************************************
+  **
+  ** Function:        writeBack
+  **
+  ** Description:     Write the updated files to the NFCEE, or try again
+  **                  later if it cannot be reached now.
+  **
+  ** Returns:         None
+  **
+  *******************************************************************************/
+  void writeBack();
+
+  /*******************************************************************************
+  **
+  ** Function:        writePending
+  **
+  ** Description:     Write the updated files to the NFCEE. mOpMutex must be
+  **                  held.
+  **
+  ** Returns:         False if some file is still to be written.
+  **
+  *******************************************************************************/
+  bool writePending();
+
+  /*******************************************************************************
+  **
+  ** Function:        writeUpdate
+  **
+  ** Description:     Write an updated file, unless a reader wrote the file
+  **                  since the update was based on it. The connection must
+  **                  be open and mOpMutex held.
+  **                  update: Updated file.
+  **
+  ** Returns:         None; an error is kept in mWriteBackErrors.
+  **
+  *******************************************************************************/
+  void writeUpdate(const T4tContentCache::Update& update);
+
+  static void writeBackTimerCb(union sigval);
+
+  /*******************************************************************************
+  **
+  ** Function:        readRange
+  **
+  ** Description:     Read a range of a file. NFA reads the whole file in one
+  **                  operation; only the range is kept. The connection must
+  **                  be open.
+  **                  fileId: File ID.
+  **                  offset: Offset of the range in the file.
+  **                  length: Length of the range.
+  **                  data: Receives the data of the range; shorter than
+  **                  length if the file ends first.
+  **
+  ** Returns:         Status of the read.
+  **
+  *******************************************************************************/
+  tNFA_STATUS readRange(uint8_t* fileId, uint32_t offset, uint32_t length,
+                        std::vector<uint8_t>& data);
+
+  /*******************************************************************************
+  **
+  ** Function:        writeFile
+  **
+  ** Description:     Write the whole content of a file. The connection must
+  **                  be open.
+  **                  fileId: File ID.
+  **                  data: Content.
+  **                  len: Length of the content.
+  **
+  ** Returns:         Return the size of data written
+  **                  Return negative number of error code
+  **
+  *******************************************************************************/
+  jint writeFile(uint8_t* fileId, uint8_t* data, uint32_t len);
+
   /*******************************************************************************
   **
   ** Function:        openConnection
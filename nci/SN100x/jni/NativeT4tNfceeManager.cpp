@@ -58,6 +58,24 @@ jint t4tNfceeManager_doWriteT4tData(JNIEnv* e, jobject o, jbyteArray fileId,
 
   return t4tNfcEe.t4tWriteData(e, o, fileId, data, length);
 }
+/*******************************************************************************
+ **
+ ** Function:        t4tNfceeManager_doWriteT4tDataRange
+ **
+ ** Description:     Write data at an offset of the T4T file of the specific
+ **                  file ID, keeping the rest of the file.
+ **
+ ** Returns:         Return the size of data written
+ **                  Return negative number of error code
+ **
+ *******************************************************************************/
+jint t4tNfceeManager_doWriteT4tDataRange(JNIEnv* e, jobject o,
+                                         jbyteArray fileId, jint offset,
+                                         jbyteArray data) {
+  DLOG_IF(INFO, nfc_debug_enabled) << StringPrintf("%s: enter", __func__);
+
+  return t4tNfcEe.t4tWriteData(e, o, fileId, offset, data);
+}
 /*******************************************************************************
 **
 ** Function:        nfcManager_doReadT4tData
@@ -78,6 +96,22 @@ jbyteArray t4tNfceeManager_doReadT4tData(JNIEnv* e, jobject o,
 }
 /*******************************************************************************
 **
+** Function:        t4tNfceeManager_doReadT4tDataRange
+**
+** Description:     Read a range of the T4T file of the specific file ID.
+**
+** Returns:         byte[] : the data of the range within the file.
+**                  Return null if reading fails.
+**
+*******************************************************************************/
+jbyteArray t4tNfceeManager_doReadT4tDataRange(JNIEnv* e, jobject o,
+                                              jbyteArray fileId, jint offset,
+                                              jint length) {
+  DLOG_IF(INFO, nfc_debug_enabled) << StringPrintf("%s: enter", __func__);
+  return t4tNfcEe.t4tReadData(e, o, fileId, offset, length);
+}
+/*******************************************************************************
+**
 ** Function:        t4tNfceeManager_doLockT4tData
 **
 ** Description:     Lock/Unlock the data in the T4T NDEF file.
@@ -115,6 +149,10 @@ jboolean t4tNfceeManager_isLockedT4tData(JNIEnv* e, jobject o) {
 static JNINativeMethod gMethods[] = {
     {"doWriteT4tData", "([B[BI)I", (void*)t4tNfceeManager_doWriteT4tData},
     {"doReadT4tData", "([B)[B", (void*)t4tNfceeManager_doReadT4tData},
+    {"doWriteT4tDataRange", "([BI[B)I",
+     (void*)t4tNfceeManager_doWriteT4tDataRange},
+    {"doReadT4tDataRange", "([BII)[B",
+     (void*)t4tNfceeManager_doReadT4tDataRange},
     {"doLockT4tData", "(Z)Z", (void*)t4tNfceeManager_doLockT4tData},
     {"isLockedT4tData", "()Z", (void*)t4tNfceeManager_isLockedT4tData},
     {"doClearNdefT4tData", "()Z", (void*)t4tNfceeManager_doClearNdefT4tData},
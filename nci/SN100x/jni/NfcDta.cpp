@@ -28,9 +28,8 @@ extern bool nfc_debug_enabled;
 
 namespace android {
 extern SyncEvent gNfaSetConfigEvent;
-extern SyncEvent gNfaGetConfigEvent;
-extern uint16_t gCurrentConfigLen;
-extern uint8_t gConfig[256];
+extern tNFA_STATUS getConfig(uint16_t* rspLen, uint8_t* configValue,
+                             uint8_t numParam, tNFA_PMID* param);
 }  // namespace android
 
 using namespace android;
@@ -139,27 +138,27 @@ std::vector<uint8_t> NfcDta::getNonupdatedConfigParamIds(
 tNFA_STATUS NfcDta::getConfigParamValues(std::vector<uint8_t> paramIds) {
   tNFA_STATUS status = NFA_STATUS_OK;
   if (!paramIds.empty()) {
-    SyncEventGuard guard(gNfaGetConfigEvent);
-    status = NFA_GetConfig(paramIds.size(), paramIds.data());
+    uint8_t config[256];
+    uint16_t configLen = 0;
+    status = getConfig(&configLen, config, paramIds.size(), paramIds.data());
     if (status == NFA_STATUS_OK) {
-      gNfaGetConfigEvent.wait();
-      // gCurrentConfigLen contains number of bytes without NCI header length.
+      // configLen contains number of bytes without NCI header length.
       // i.e., status(one byte) + config tag count(one byte) + NCI config
       // Tag(one byte) + length(one byte) + value(bytes). So valid getConfig
       // response length should be greater than 4.
-      if (gCurrentConfigLen > 4) {
-        // Config tlv length = gCurrentConfigLen - status byte - tag count byte
-        uint16_t len = gCurrentConfigLen - 2;
-        // First Config TLV starts from index 1 of gConfig
+      if (configLen > 4) {
+        // Config tlv length = configLen - status byte - tag count byte
+        uint16_t len = configLen - 2;
+        // First Config TLV starts from index 1 of config
         uint16_t index = 1;
         DLOG_IF(INFO, nfc_debug_enabled)
             << StringPrintf("%s: default_config len: %d", __func__, len);
         while (index <= len) {
-          mDefaultTlv.push_back(gConfig[index++]);
+          mDefaultTlv.push_back(config[index++]);
         }
       } else {
         DLOG_IF(INFO, nfc_debug_enabled) << StringPrintf(
-            "%s: getConfig failed len: %d", __func__, gCurrentConfigLen);
+            "%s: getConfig failed len: %d", __func__, configLen);
         status = NFA_STATUS_FAILED;
       }
     } else {
@@ -17,6 +17,7 @@
  ******************************************************************************/
 
 #include "NfcSelfTest.h"
+#include "ConfigParamCache.h"
 #include "NfcJniUtil.h" // for JNIEnv, jobject & jint
 #include "nfc_config.h"
 #include <android-base/logging.h>
@@ -665,6 +666,8 @@ tNFA_STATUS NfcSelfTest::PerformTransacAB(uint8_t aType) {
                                NxpResponse_SelfTest_Cb);
       if (status == NFA_STATUS_OK)
         gselfTestData.NxpSelfTestEvt.wait(2 * ONE_SECOND_MS);
+      ConfigParamCache::getInstance().onRawCommand(
+          readerProfileSelCfg, sizeof(readerProfileSelCfg));
     }
   } else {
     LOG(INFO)
@@ -880,6 +883,7 @@ tNFA_STATUS NfcSelfTest::executeCmdSeq(uint8_t* aCmdType, uint8_t aNumOfCmds) {
 
       SyncEventGuard guard(gselfTestData.NxpSelfTestEvt);
       status = NFA_SendRawVsCommand(cmdLen, cmdBuf, NxpResponse_SelfTest_Cb);
+      ConfigParamCache::getInstance().onRawCommand(cmdBuf, cmdLen);
       if (status == NFA_STATUS_OK &&
           gselfTestData.NxpSelfTestEvt.wait(RESONANT_FREQ_CMD_WAIT)) {
         if (aCmdType[count] == CMD_TYPE_CORE_RESET) {
@@ -21,12 +21,72 @@
 #include <log/log.h>
 #include <statslog_nfc.h>
 
+#include <stdio.h>
+#include <time.h>
+#include <algorithm>
+#include <atomic>
+
 #include "nfc_api.h"
 
 using android::base::StringPrintf;
 
 extern bool nfc_debug_enabled;
 
+namespace {
+// Log-linear buckets: exact below 8 us, then 8 buckets per power of two, so
+// that any percentile is reported within 12.5% of the true value.
+const int SUB_BUCKET_BITS = 3;
+const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+const int NUM_BUCKETS = (32 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+const uint64_t MAX_LATENCY = 0xFFFFFFFF;  // us; longer samples are clamped
+
+struct HistogramData {
+  std::atomic<uint64_t> buckets[NUM_BUCKETS];
+  std::atomic<uint64_t> count;
+  std::atomic<uint64_t> sum;
+  std::atomic<uint64_t> max;
+};
+
+// static storage: zero before any sample is recorded
+HistogramData sHistograms[NfcStatsUtil::NUM_HISTOGRAMS];
+std::atomic<uint64_t> sCounters[NfcStatsUtil::NUM_COUNTERS];
+
+const char* const sHistogramNames[NfcStatsUtil::NUM_HISTOGRAMS] = {
+    "activation_to_first_apdu", "apdu_rtt_iso_dep", "apdu_rtt_t2t",
+    "apdu_rtt_t3t",             "apdu_rtt_t5t",     "apdu_rtt_mifare",
+    "apdu_rtt_other",           "ndef_read",        "ndef_write",
+    "presence_check_rtt",       "se_transceive_rtt", "routing_commit",
+    "routing_rf_downtime"};
+const char* const sCounterNames[NfcStatsUtil::NUM_COUNTERS] = {
+    "transceive_timeout", "nack_reconnect", "rf_error"};
+
+int getBucket(uint64_t micros) {
+  if (micros < SUB_BUCKETS) return micros;
+  int msb = 63 - __builtin_clzll(micros);
+  int shift = msb - SUB_BUCKET_BITS;
+  return (shift + 1) * SUB_BUCKETS +
+         ((micros >> shift) & (SUB_BUCKETS - 1));
+}
+
+uint64_t getBucketUpperBound(int bucket) {
+  if (bucket < SUB_BUCKETS) return bucket;
+  int shift = bucket / SUB_BUCKETS - 1;
+  uint64_t lower = (uint64_t)(SUB_BUCKETS + bucket % SUB_BUCKETS) << shift;
+  return lower + (1ULL << shift) - 1;
+}
+
+uint64_t getPercentile(const uint64_t* buckets, uint64_t count, uint64_t max,
+                       int percent) {
+  uint64_t rank = (count * percent + 99) / 100;
+  uint64_t seen = 0;
+  for (int i = 0; i < NUM_BUCKETS; i++) {
+    seen += buckets[i];
+    if (seen >= rank && seen > 0) return std::min(getBucketUpperBound(i), max);
+  }
+  return 0;
+}
+}  // namespace
+
 /*******************************************************************************
 **
 ** Function:        logNfcTagType
@@ -89,3 +149,143 @@ void NfcStatsUtil::writeNfcStatsTagTypeOccurred(int tagType) {
 
   nfc::stats::stats_write(nfc::stats::NFC_TAG_TYPE_OCCURRED, tagType);
 }
+
+/*******************************************************************************
+**
+** Function:        nowMicros
+**
+** Description:     Get the clock used for latencies.
+**
+** Returns:         CLOCK_MONOTONIC time in microseconds.
+**
+*******************************************************************************/
+uint64_t NfcStatsUtil::nowMicros() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/*******************************************************************************
+**
+** Function:        recordLatency
+**
+** Description:     Add a sample to a histogram. Lock-free.
+**                  histogram: Histogram to update.
+**                  micros: Latency in microseconds.
+**
+** Returns:         None
+**
+*******************************************************************************/
+void NfcStatsUtil::recordLatency(Histogram histogram, uint64_t micros) {
+  if (histogram < 0 || histogram >= NUM_HISTOGRAMS) return;
+  if (micros > MAX_LATENCY) micros = MAX_LATENCY;
+
+  HistogramData& data = sHistograms[histogram];
+  data.buckets[getBucket(micros)].fetch_add(1, std::memory_order_relaxed);
+  data.count.fetch_add(1, std::memory_order_relaxed);
+  data.sum.fetch_add(micros, std::memory_order_relaxed);
+  uint64_t max = data.max.load(std::memory_order_relaxed);
+  while (micros > max && !data.max.compare_exchange_weak(
+                             max, micros, std::memory_order_relaxed)) {
+  }
+}
+
+/*******************************************************************************
+**
+** Function:        getApduHistogram
+**
+** Description:     Get the APDU round-trip histogram of a tag protocol.
+**                  protocol: tag protocol
+**
+** Returns:         Histogram.
+**
+*******************************************************************************/
+NfcStatsUtil::Histogram NfcStatsUtil::getApduHistogram(int protocol) {
+  switch (protocol) {
+    case NFC_PROTOCOL_ISO_DEP:
+      return HIST_APDU_RTT_ISO_DEP;
+    case NFC_PROTOCOL_T2T:
+      return HIST_APDU_RTT_T2T;
+    case NFC_PROTOCOL_T3T:
+      return HIST_APDU_RTT_T3T;
+    case NFC_PROTOCOL_T5T:
+      return HIST_APDU_RTT_T5T;
+    case NFC_PROTOCOL_MIFARE:
+      return HIST_APDU_RTT_MIFARE;
+    default:
+      return HIST_APDU_RTT_OTHER;
+  }
+}
+
+/*******************************************************************************
+**
+** Function:        incrementCounter
+**
+** Description:     Add one to a counter. Lock-free.
+**                  counter: Counter to update.
+**
+** Returns:         None
+**
+*******************************************************************************/
+void NfcStatsUtil::incrementCounter(Counter counter) {
+  if (counter < 0 || counter >= NUM_COUNTERS) return;
+  sCounters[counter].fetch_add(1, std::memory_order_relaxed);
+}
+
+/*******************************************************************************
+**
+** Function:        getMetricsSnapshot
+**
+** Description:     Summarize all histograms (count, mean, p50, p90, p99,
+**                  max) and counters.
+**
+** Returns:         JSON object.
+**
+*******************************************************************************/
+std::string NfcStatsUtil::getMetricsSnapshot() {
+  std::string json = "{\"histograms\":{";
+  for (int h = 0; h < NUM_HISTOGRAMS; h++) {
+    HistogramData& data = sHistograms[h];
+    // buckets are read one by one while writers may still add samples, so
+    // the count is taken from the copied buckets
+    uint64_t buckets[NUM_BUCKETS];
+    uint64_t count = 0;
+    for (int i = 0; i < NUM_BUCKETS; i++) {
+      buckets[i] = data.buckets[i].load(std::memory_order_relaxed);
+      count += buckets[i];
+    }
+    uint64_t sum = data.sum.load(std::memory_order_relaxed);
+    uint64_t max = data.max.load(std::memory_order_relaxed);
+    json += StringPrintf(
+        "%s\"%s\":{\"count\":%llu,\"mean_us\":%llu,\"p50_us\":%llu,"
+        "\"p90_us\":%llu,\"p99_us\":%llu,\"max_us\":%llu}",
+        (h == 0) ? "" : ",", sHistogramNames[h], (unsigned long long)count,
+        (unsigned long long)(count ? sum / count : 0),
+        (unsigned long long)getPercentile(buckets, count, max, 50),
+        (unsigned long long)getPercentile(buckets, count, max, 90),
+        (unsigned long long)getPercentile(buckets, count, max, 99),
+        (unsigned long long)max);
+  }
+  json += "},\"counters\":{";
+  for (int c = 0; c < NUM_COUNTERS; c++) {
+    json += StringPrintf(
+        "%s\"%s\":%llu", (c == 0) ? "" : ",", sCounterNames[c],
+        (unsigned long long)sCounters[c].load(std::memory_order_relaxed));
+  }
+  json += "}}";
+  return json;
+}
+
+/*******************************************************************************
+**
+** Function:        dump
+**
+** Description:     Write the metrics snapshot.
+**                  fd: File descriptor to write to.
+**
+** Returns:         None
+**
+*******************************************************************************/
+void NfcStatsUtil::dump(int fd) {
+  dprintf(fd, "NFC JNI metrics:\n%s\n", getMetricsSnapshot().c_str());
+}
@@ -15,10 +15,39 @@
  */
 
 /*
- *  Util class to handle Nfc statsd logging
+ *  Util class to handle Nfc statsd logging, and latency histograms and
+ *  counters reported through dump and NativeNfcManager.getMetricsSnapshot().
  */
+#pragma once
+#include <stdint.h>
+#include <string>
+
 class NfcStatsUtil {
  public:
+  enum Histogram {
+    HIST_ACTIVATION_TO_FIRST_APDU,
+    HIST_APDU_RTT_ISO_DEP,
+    HIST_APDU_RTT_T2T,
+    HIST_APDU_RTT_T3T,
+    HIST_APDU_RTT_T5T,
+    HIST_APDU_RTT_MIFARE,
+    HIST_APDU_RTT_OTHER,
+    HIST_NDEF_READ,
+    HIST_NDEF_WRITE,
+    HIST_PRESENCE_CHECK_RTT,
+    HIST_SE_TRANSCEIVE_RTT,
+    HIST_ROUTING_COMMIT,
+    HIST_ROUTING_RF_DOWNTIME,
+    NUM_HISTOGRAMS
+  };
+
+  enum Counter {
+    COUNT_TRANSCEIVE_TIMEOUT,
+    COUNT_NACK_RECONNECT,
+    COUNT_RF_ERROR,
+    NUM_COUNTERS
+  };
+
   virtual ~NfcStatsUtil() = default;
 
   /*******************************************************************************
@@ -35,6 +64,78 @@ class NfcStatsUtil {
   *******************************************************************************/
   void logNfcTagType(int protocol, int discoveryMode);
 
+  /*******************************************************************************
+  **
+  ** Function:        nowMicros
+  **
+  ** Description:     Get the clock used for latencies.
+  **
+  ** Returns:         CLOCK_MONOTONIC time in microseconds.
+  **
+  *******************************************************************************/
+  static uint64_t nowMicros();
+
+  /*******************************************************************************
+  **
+  ** Function:        recordLatency
+  **
+  ** Description:     Add a sample to a histogram. Lock-free.
+  **                  histogram: Histogram to update.
+  **                  micros: Latency in microseconds.
+  **
+  ** Returns:         None
+  **
+  *******************************************************************************/
+  static void recordLatency(Histogram histogram, uint64_t micros);
+
+  /*******************************************************************************
+  **
+  ** Function:        getApduHistogram
+  **
+  ** Description:     Get the APDU round-trip histogram of a tag protocol.
+  **                  protocol: tag protocol
+  **
+  ** Returns:         Histogram.
+  **
+  *******************************************************************************/
+  static Histogram getApduHistogram(int protocol);
+
+  /*******************************************************************************
+  **
+  ** Function:        incrementCounter
+  **
+  ** Description:     Add one to a counter. Lock-free.
+  **                  counter: Counter to update.
+  **
+  ** Returns:         None
+  **
+  *******************************************************************************/
+  static void incrementCounter(Counter counter);
+
+  /*******************************************************************************
+  **
+  ** Function:        getMetricsSnapshot
+  **
+  ** Description:     Summarize all histograms (count, mean, p50, p90, p99,
+  **                  max) and counters.
+  **
+  ** Returns:         JSON object.
+  **
+  *******************************************************************************/
+  static std::string getMetricsSnapshot();
+
+  /*******************************************************************************
+  **
+  ** Function:        dump
+  **
+  ** Description:     Write the metrics snapshot.
+  **                  fd: File descriptor to write to.
+  **
+  ** Returns:         None
+  **
+  *******************************************************************************/
+  static void dump(int fd);
+
  private:
   /*******************************************************************************
   **
@@ -0,0 +1,23 @@
+#include <benchmark/benchmark.h>
+
+#include "NfcStatsUtil.h"
+
+namespace {
+// one sample per transceive; also from several threads at once, since
+// reader, card emulation and secure element paths record concurrently
+void BM_NfcStatsUtilRecordLatency(benchmark::State& state) {
+  uint64_t micros = 100 + state.thread_index() * 37;
+  for (auto _ : state) {
+    NfcStatsUtil::recordLatency(NfcStatsUtil::HIST_APDU_RTT_ISO_DEP, micros);
+    micros = (micros * 13) % 500000;
+  }
+}
+BENCHMARK(BM_NfcStatsUtilRecordLatency)->Threads(1)->Threads(4);
+
+void BM_NfcStatsUtilNowMicros(benchmark::State& state) {
+  for (auto _ : state) benchmark::DoNotOptimize(NfcStatsUtil::nowMicros());
+}
+BENCHMARK(BM_NfcStatsUtilNowMicros);
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -47,6 +47,8 @@
 
 #include "JavaClassConstants.h"
 #include "nfc_brcm_defs.h"
+#include "PresenceCheckEngine.h"
+#include "TagSession.h"
 #include "nfc_config.h"
 #include "rw_int.h"
 #if (NXP_EXTNS == TRUE)
@@ -160,6 +162,7 @@ void NfcTag::initialize(nfc_jni_native_data* native) {
   if (NfcConfig::hasKey(NAME_PRESENCE_CHECK_ALGORITHM))
     mPresenceCheckAlgorithm =
         NfcConfig::getUnsigned(NAME_PRESENCE_CHECK_ALGORITHM);
+  PresenceCheckEngine::getInstance().initialize();
 }
 
 /*******************************************************************************
@@ -646,6 +649,18 @@ void NfcTag::createNativeNfcTag(tNFA_ACTIVATED& activationData) {
     e->DeleteGlobalRef(mNativeData->tag);
   }
   mNativeData->tag = e->NewGlobalRef(tag.get());
+
+  // one transaction session per target of this tag
+  TagSession::createSessions(mTechHandles, mNumTechList);
+  uint64_t activatedMicros = NfcStatsUtil::nowMicros();
+  for (int i = 0; i < mNumTechList; i++) {
+    std::shared_ptr<TagSession> session = TagSession::find(mTechHandles[i]);
+    if (session) {
+      session->setPresCheckFingerprint(
+          getPresenceCheckFingerprint(i, activationData));
+      session->setActivatedMicros(activatedMicros);
+    }
+  }
   DLOG_IF(INFO, nfc_debug_enabled)
      << StringPrintf("%s; mNumDiscNtf=%x", fn, mNumDiscNtf);
 /*  if(isNfcCombiCard() || !mNumDiscNtf || NfcTag::getInstance().checkNextValidProtocol() == -1) {*/
@@ -733,6 +748,51 @@ static void deleteglobaldata(JNIEnv* e) {
   DLOG_IF(INFO, nfc_debug_enabled) << StringPrintf("%s: exit", fn);
 }
 
+/*******************************************************************************
+**
+** Function:        getPresenceCheckFingerprint
+**
+** Description:     Compute the fingerprint under which presence-check
+**                  timing and method are learned for a target. UIDs are
+**                  left out since many tags use random ones.
+**                  index: Index into mTechParams.
+**                  activationData: Data from activation.
+**
+** Returns:         Fingerprint.
+**
+*******************************************************************************/
+uint32_t NfcTag::getPresenceCheckFingerprint(int index,
+                                             tNFA_ACTIVATED& activationData) {
+  std::basic_string<uint8_t> id;
+  tNFC_RF_TECH_PARAMS& params = mTechParams[index];
+
+  if (params.mode == NFC_DISCOVERY_TYPE_POLL_A ||
+      params.mode == NFC_DISCOVERY_TYPE_POLL_A_ACTIVE) {
+    // ATQA and SAK
+    id.append(params.param.pa.sens_res, 2);
+    id.push_back(params.param.pa.sel_rsp);
+  } else if (params.mode == NFC_DISCOVERY_TYPE_POLL_B &&
+             params.param.pb.sensb_res_len > 4) {
+    // SENSB_RES without NFCID0: application data and protocol info
+    id.append(params.param.pb.sensb_res + 4,
+              params.param.pb.sensb_res_len - 4);
+  }
+  if (mTechLibNfcTypes[index] == NFC_PROTOCOL_ISO_DEP &&
+      activationData.activate_ntf.intf_param.type == NFC_INTERFACE_ISO_DEP) {
+    if (params.mode == NFC_DISCOVERY_TYPE_POLL_A) {
+      tNFC_INTF_PA_ISO_DEP& pa_iso =
+          activationData.activate_ntf.intf_param.intf_param.pa_iso;
+      id.append(pa_iso.his_byte, pa_iso.his_byte_len);  // ATS
+    } else if (params.mode == NFC_DISCOVERY_TYPE_POLL_B) {
+      tNFC_INTF_PB_ISO_DEP& pb_iso =
+          activationData.activate_ntf.intf_param.intf_param.pb_iso;
+      id.append(pb_iso.hi_info, pb_iso.hi_info_len);
+    }
+  }
+  return PresenceCheckEngine::makeFingerprint(mTechLibNfcTypes[index],
+                                              id.data(), id.size());
+}
+
 /*******************************************************************************
 **
 ** Function:        fillNativeNfcTagMembers1
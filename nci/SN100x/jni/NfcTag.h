@@ -602,6 +602,21 @@ class NfcTag {
   *******************************************************************************/
   void createNativeNfcTag(tNFA_ACTIVATED& activationData);
 
+  /*******************************************************************************
+  **
+  ** Function:        getPresenceCheckFingerprint
+  **
+  ** Description:     Compute the fingerprint under which presence-check
+  **                  timing and method are learned for a target.
+  **                  index: Index into mTechParams.
+  **                  activationData: Data from activation.
+  **
+  ** Returns:         Fingerprint.
+  **
+  *******************************************************************************/
+  uint32_t getPresenceCheckFingerprint(int index,
+                                       tNFA_ACTIVATED& activationData);
+
 #if (NXP_EXTNS == TRUE)
   /*******************************************************************************
   **
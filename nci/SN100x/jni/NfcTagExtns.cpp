@@ -24,12 +24,12 @@
 #include <base/logging.h>
 #include <errno.h>
 
+#include "TagSession.h"
 #include "nfc_config.h"
 
 namespace android {
 extern void nativeNfcTag_setTransceiveFlag(bool state);
 extern void nativeNfcTag_abortWaits();
-extern SyncEvent sTransceiveEvent;
 extern bool nfc_debug_enabled;
 extern bool gIsSelectingRfInterface;
 extern void nativeNfcTag_doConnectStatus(jboolean is_connect_ok);
@@ -695,21 +695,24 @@ tTagStatus NfcTagExtns::performHaltPICC() {
              getActivatedMode() == TARGET_TYPE_ISO14443_3B) {
     uint8_t halt_b[5] = {0x50, 0, 0, 0, 0};
     memcpy(&halt_b[1], mNfcID0, 4);
-    android::nativeNfcTag_setTransceiveFlag(true);
-    SyncEventGuard g(android::sTransceiveEvent);
-    status = NFA_SendRawFrame(halt_b, sizeof(halt_b), 0);
-    if (status != NFA_STATUS_OK) {
-      DLOG_IF(ERROR, android::nfc_debug_enabled)
-          << StringPrintf("%s: fail send; error=%d", __func__, status);
-      ret = TAG_STATUS_FAILED;
-    } else {
-      if (android::sTransceiveEvent.wait(100) == false) {
-        ret = TAG_STATUS_FAILED;
+    std::shared_ptr<TagSession> session = TagSession::current();
+    {
+      SyncEventGuard g(session->getTransceiveEvent());
+      session->prepareTransceive();
+      status = NFA_SendRawFrame(halt_b, sizeof(halt_b), 0);
+      if (status != NFA_STATUS_OK) {
         DLOG_IF(ERROR, android::nfc_debug_enabled)
-            << StringPrintf("%s: timeout on HALTB", __func__);
+            << StringPrintf("%s: fail send; error=%d", __func__, status);
+        ret = TAG_STATUS_FAILED;
+      } else {
+        if (session->waitResponse(100) == false) {
+          ret = TAG_STATUS_FAILED;
+          DLOG_IF(ERROR, android::nfc_debug_enabled)
+              << StringPrintf("%s: timeout on HALTB", __func__);
+        }
       }
     }
-    android::nativeNfcTag_setTransceiveFlag(false);
+    session->endTransceive();
   }
   return ret;
 }
@@ -0,0 +1,206 @@
+/******************************************************************************
+ *
+ *  Copyright 2024 NXP
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/*
+ *  Latency tracing of JNI entry points and NFA callbacks.
+ */
+#include "NfcTrace.h"
+
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include <atomic>
+#include <vector>
+#include "Mutex.h"
+
+namespace {
+const uint32_t RING_SIZE = 512;  // spans kept per thread; power of two
+const size_t MAX_EXITED_RINGS = 4;  // rings of exited threads kept for dump()
+
+/*
+ *  Each slot is a sequence lock: odd while the owner thread writes it, so
+ *  that dump() can skip slots torn by a concurrent write. The fields are
+ *  relaxed atomics, so that reading a slot being written is no data race.
+ */
+struct Span {
+  std::atomic<uint32_t> seq;
+  std::atomic<char> phase;
+  std::atomic<int> arg;
+  std::atomic<const char*> cat;
+  std::atomic<const char*> name;
+  std::atomic<uint64_t> startNs;
+  std::atomic<uint64_t> durNs;
+};
+
+struct Ring {
+  pid_t tid;
+  std::atomic<uint32_t> next;
+  Span spans[RING_SIZE];
+};
+
+/*
+ *  Owns the ring of a thread. On thread exit the ring moves to the exited
+ *  rings, so that dump() still shows the last threads that exited; only the
+ *  newest MAX_EXITED_RINGS of those are kept.
+ */
+struct RingOwner {
+  Ring* ring = NULL;
+  bool exited = false;
+  ~RingOwner();
+};
+
+Mutex sRingsMutex;
+std::vector<Ring*> sRings;         // rings of live threads
+std::vector<Ring*> sExitedRings;   // oldest first
+thread_local RingOwner tRing;
+
+RingOwner::~RingOwner() {
+  exited = true;
+  if (ring == NULL) return;
+  AutoMutex lock(sRingsMutex);
+  for (size_t i = 0; i < sRings.size(); i++) {
+    if (sRings[i] == ring) {
+      sRings.erase(sRings.begin() + i);
+      break;
+    }
+  }
+  sExitedRings.push_back(ring);
+  if (sExitedRings.size() > MAX_EXITED_RINGS) {
+    delete sExitedRings.front();
+    sExitedRings.erase(sExitedRings.begin());
+  }
+  ring = NULL;
+}
+
+// NULL once the thread is exiting
+Ring* getRing() {
+  if ((tRing.ring == NULL) && !tRing.exited) {
+    Ring* ring = new Ring();
+    ring->tid = gettid();
+    ring->next.store(0, std::memory_order_relaxed);
+    for (uint32_t i = 0; i < RING_SIZE; i++)
+      ring->spans[i].seq.store(0, std::memory_order_relaxed);
+    AutoMutex lock(sRingsMutex);
+    sRings.push_back(ring);
+    tRing.ring = ring;
+  }
+  return tRing.ring;
+}
+}  // namespace
+
+/*******************************************************************************
+**
+** Function:        now
+**
+** Description:     Get the trace clock.
+**
+** Returns:         CLOCK_MONOTONIC time in nanoseconds.
+**
+*******************************************************************************/
+uint64_t NfcTrace::now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/*******************************************************************************
+**
+** Function:        record
+**
+** Description:     Append a span to the ring of the calling thread.
+**                  phase: 'X' for a complete span, 'i' for an instant.
+**                  cat: Category, e.g. "tag".
+**                  name: Span name.
+**                  startNs: Start time from now().
+**                  durNs: Duration; 0 for an instant.
+**                  arg: Event code, length or status to show with the span.
+**
+** Returns:         None
+**
+*******************************************************************************/
+void NfcTrace::record(char phase, const char* cat, const char* name,
+                      uint64_t startNs, uint64_t durNs, int arg) {
+  Ring* ring = getRing();
+  if (ring == NULL) return;
+  uint32_t index = ring->next.load(std::memory_order_relaxed);
+  Span& span = ring->spans[index & (RING_SIZE - 1)];
+  uint32_t seq = span.seq.load(std::memory_order_relaxed);
+
+  span.seq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  span.phase.store(phase, std::memory_order_relaxed);
+  span.arg.store(arg, std::memory_order_relaxed);
+  span.cat.store(cat, std::memory_order_relaxed);
+  span.name.store(name, std::memory_order_relaxed);
+  span.startNs.store(startNs, std::memory_order_relaxed);
+  span.durNs.store(durNs, std::memory_order_relaxed);
+  span.seq.store(seq + 2, std::memory_order_release);
+  ring->next.store(index + 1, std::memory_order_release);
+}
+
+/*******************************************************************************
+**
+** Function:        dump
+**
+** Description:     Write the spans of all threads as Chrome trace JSON.
+**                  fd: File descriptor to write to.
+**
+** Returns:         None
+**
+*******************************************************************************/
+void NfcTrace::dump(int fd) {
+  // held throughout so that no ring is freed while it is read
+  AutoMutex lock(sRingsMutex);
+  std::vector<Ring*> rings(sExitedRings);
+  rings.insert(rings.end(), sRings.begin(), sRings.end());
+
+  dprintf(fd, "NFC JNI trace (Chrome trace JSON):\n{\"traceEvents\":[");
+  bool first = true;
+  pid_t pid = getpid();
+  for (Ring* ring : rings) {
+    uint32_t end = ring->next.load(std::memory_order_acquire);
+    uint32_t begin = (end > RING_SIZE) ? end - RING_SIZE : 0;
+    for (uint32_t i = begin; i < end; i++) {
+      Span& span = ring->spans[i & (RING_SIZE - 1)];
+      uint32_t seq = span.seq.load(std::memory_order_acquire);
+      if (seq & 1) continue;
+      char phase = span.phase.load(std::memory_order_relaxed);
+      int arg = span.arg.load(std::memory_order_relaxed);
+      const char* cat = span.cat.load(std::memory_order_relaxed);
+      const char* name = span.name.load(std::memory_order_relaxed);
+      uint64_t startNs = span.startNs.load(std::memory_order_relaxed);
+      uint64_t durNs = span.durNs.load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (span.seq.load(std::memory_order_relaxed) != seq) continue;
+
+      dprintf(fd,
+              "%s\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%c\","
+              "\"ts\":%.3f,",
+              first ? "" : ",", name, cat, phase, startNs / 1000.0);
+      if (phase == 'X') {
+        dprintf(fd, "\"dur\":%.3f,", durNs / 1000.0);
+      } else {
+        dprintf(fd, "\"s\":\"t\",");
+      }
+      dprintf(fd, "\"pid\":%d,\"tid\":%d,\"args\":{\"arg\":%d}}", pid,
+              ring->tid, arg);
+      first = false;
+    }
+  }
+  dprintf(fd, "\n],\"displayTimeUnit\":\"ms\"}\n");
+}
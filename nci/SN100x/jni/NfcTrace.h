@@ -0,0 +1,106 @@
+/******************************************************************************
+ *
+ *  Copyright 2024 NXP
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/*
+ *  Latency tracing of JNI entry points and NFA callbacks. Every thread
+ *  records spans into its own ring without locking; nfcManager_doDump
+ *  exports all rings as Chrome trace JSON (loadable in Perfetto).
+ *
+ *  Category and name must be string literals. Build with
+ *  -DNFC_TRACE_DISABLED to compile all tracing out.
+ */
+#pragma once
+#include <stdint.h>
+
+class NfcTrace {
+ public:
+  /*******************************************************************************
+  **
+  ** Function:        now
+  **
+  ** Description:     Get the trace clock.
+  **
+  ** Returns:         CLOCK_MONOTONIC time in nanoseconds.
+  **
+  *******************************************************************************/
+  static uint64_t now();
+
+  /*******************************************************************************
+  **
+  ** Function:        record
+  **
+  ** Description:     Append a span to the ring of the calling thread.
+  **                  phase: 'X' for a complete span, 'i' for an instant.
+  **                  cat: Category, e.g. "tag".
+  **                  name: Span name.
+  **                  startNs: Start time from now().
+  **                  durNs: Duration; 0 for an instant.
+  **                  arg: Event code, length or status to show with the span.
+  **
+  ** Returns:         None
+  **
+  *******************************************************************************/
+  static void record(char phase, const char* cat, const char* name,
+                     uint64_t startNs, uint64_t durNs, int arg);
+
+  /*******************************************************************************
+  **
+  ** Function:        dump
+  **
+  ** Description:     Write the spans of all threads as Chrome trace JSON.
+  **                  fd: File descriptor to write to.
+  **
+  ** Returns:         None
+  **
+  *******************************************************************************/
+  static void dump(int fd);
+};
+
+/*****************************************************************************
+**
+**  Name:           NfcTraceScope
+**
+**  Description:    Record a complete span covering the enclosing scope.
+**
+*****************************************************************************/
+class NfcTraceScope {
+ public:
+  NfcTraceScope(const char* cat, const char* name)
+      : mCat(cat), mName(name), mStart(NfcTrace::now()) {}
+  ~NfcTraceScope() {
+    NfcTrace::record('X', mCat, mName, mStart, NfcTrace::now() - mStart, 0);
+  }
+
+ private:
+  const char* mCat;
+  const char* mName;
+  uint64_t mStart;
+};
+
+#ifndef NFC_TRACE_DISABLED
+#define NFC_TRACE_CONCAT_(a, b) a##b
+#define NFC_TRACE_CONCAT(a, b) NFC_TRACE_CONCAT_(a, b)
+#define NFC_TRACE_SCOPE(cat, name) \
+  NfcTraceScope NFC_TRACE_CONCAT(nfcTraceScope, __LINE__)(cat, name)
+#define NFC_TRACE_INSTANT(cat, name, arg) \
+  NfcTrace::record('i', cat, name, NfcTrace::now(), 0, arg)
+#else
+#define NFC_TRACE_SCOPE(cat, name)
+// arg is not evaluated, but counts as used
+#define NFC_TRACE_INSTANT(cat, name, arg) ((void)sizeof(arg))
+#endif
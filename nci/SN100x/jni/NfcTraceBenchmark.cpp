@@ -0,0 +1,46 @@
+#include <benchmark/benchmark.h>
+
+#include <stdint.h>
+#include "NfcTrace.h"
+
+// Built twice: nqnfc_trace_benchmark, and nqnfc_trace_disabled_benchmark
+// with -DNFC_TRACE_DISABLED; the difference is the cost of tracing.
+namespace {
+// stands for the work of a short JNI entry point, about a microsecond
+uint32_t work(uint32_t seed) {
+  for (int i = 0; i < 256; i++) seed = seed * 1664525 + 1013904223;
+  return seed;
+}
+
+void BM_TraceScope(benchmark::State& state) {
+  for (auto _ : state) {
+    NFC_TRACE_SCOPE("bench", "scope");
+    benchmark::ClobberMemory();
+  }
+}
+BENCHMARK(BM_TraceScope);
+
+void BM_TraceInstant(benchmark::State& state) {
+  int arg = 0;
+  for (auto _ : state) {
+    NFC_TRACE_INSTANT("bench", "instant", arg++);
+    benchmark::ClobberMemory();
+  }
+}
+BENCHMARK(BM_TraceInstant);
+
+// a traced entry point that records one span and one instant; compare with
+// the disabled build for the overhead relative to the work
+void BM_TraceEntryPoint(benchmark::State& state) {
+  uint32_t seed = 1;
+  for (auto _ : state) {
+    NFC_TRACE_SCOPE("bench", "entry");
+    seed = work(seed);
+    NFC_TRACE_INSTANT("bench", "event", (int)(seed & 0xFF));
+    benchmark::DoNotOptimize(seed);
+  }
+}
+BENCHMARK(BM_TraceEntryPoint);
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,222 @@
+/******************************************************************************
+ *
+ *  Copyright 2024 NXP
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/*
+ *  Learned presence-check timing and method, keyed by tag fingerprint.
+ */
+#include "PresenceCheckEngine.h"
+
+#include <android-base/stringprintf.h>
+#include <base/logging.h>
+#include <algorithm>
+#include "nfc_config.h"
+
+using android::base::StringPrintf;
+
+extern bool nfc_debug_enabled;
+
+namespace {
+const int DEFAULT_MIN_TIMEOUT = 50;  // ms
+const int RTT_MULTIPLIER = 4;
+const int RTT_SLACK = 20;  // ms; covers scheduling jitter of the stack
+
+// erase the entry of the fingerprint used least recently
+template <typename Map>
+void evictLeastRecentlyUsed(Map& entries) {
+  auto oldest = entries.begin();
+  for (auto it = entries.begin(); it != entries.end(); ++it) {
+    if (it->second.lastUsed < oldest->second.lastUsed) oldest = it;
+  }
+  if (oldest != entries.end()) entries.erase(oldest);
+}
+}  // namespace
+
+const int PresenceCheckEngine::MAX_TIMEOUT;
+
+/*******************************************************************************
+**
+** Function:        PresenceCheckEngine
+**
+** Description:     Initialize member variables.
+**
+** Returns:         None
+**
+*******************************************************************************/
+PresenceCheckEngine::PresenceCheckEngine()
+    : mUseCount(0), mMinTimeout(DEFAULT_MIN_TIMEOUT), mPollInterval(0) {}
+
+/*******************************************************************************
+**
+** Function:        getInstance
+**
+** Description:     Get the singleton of this object.
+**
+** Returns:         Reference to this object.
+**
+*******************************************************************************/
+PresenceCheckEngine& PresenceCheckEngine::getInstance() {
+  static PresenceCheckEngine engine;
+  return engine;
+}
+
+/*******************************************************************************
+**
+** Function:        initialize
+**
+** Description:     Read the configuration.
+**
+** Returns:         None
+**
+*******************************************************************************/
+void PresenceCheckEngine::initialize() {
+  AutoMutex lock(mMutex);
+  mMinTimeout = NfcConfig::getUnsigned(NAME_PRESENCE_CHECK_MIN_TIMEOUT,
+                                       DEFAULT_MIN_TIMEOUT);
+  if (mMinTimeout > MAX_TIMEOUT) mMinTimeout = MAX_TIMEOUT;
+  mPollInterval = NfcConfig::getUnsigned(NAME_PRESENCE_CHECK_INTERVAL, 0);
+  DLOG_IF(INFO, nfc_debug_enabled)
+      << StringPrintf("%s: min timeout=%d; interval=%d", __func__,
+                      mMinTimeout, mPollInterval);
+}
+
+/*******************************************************************************
+**
+** Function:        makeFingerprint
+**
+** Description:     Hash the bytes identifying a kind of tag: protocol,
+**                  ATQA/SAK or SENSB_RES, and ATS historical bytes.
+**                  protocol: RF protocol of the target.
+**                  data: Identifying bytes.
+**                  len: Length of data.
+**
+** Returns:         Fingerprint.
+**
+*******************************************************************************/
+uint32_t PresenceCheckEngine::makeFingerprint(int protocol,
+                                              const uint8_t* data,
+                                              size_t len) {
+  // FNV-1a
+  uint32_t hash = 2166136261u;
+  hash = (hash ^ (uint8_t)protocol) * 16777619u;
+  for (size_t i = 0; i < len; i++) hash = (hash ^ data[i]) * 16777619u;
+  return hash;
+}
+
+/*******************************************************************************
+**
+** Function:        getTimeout
+**
+** Description:     Get how long to wait for NFA_PRESENCE_CHECK_EVT: a
+**                  multiple of the 95th percentile of the observed round
+**                  trips, bounded by the configured minimum and
+**                  MAX_TIMEOUT.
+**                  fingerprint: Tag fingerprint.
+**
+** Returns:         Timeout in milliseconds.
+**
+*******************************************************************************/
+int PresenceCheckEngine::getTimeout(uint32_t fingerprint) {
+  AutoMutex lock(mMutex);
+  auto it = mRtt.find(fingerprint);
+  if (it == mRtt.end()) return MAX_TIMEOUT;
+  RttHistory& history = it->second;
+  history.lastUsed = ++mUseCount;
+  if (history.count < MIN_SAMPLES) return MAX_TIMEOUT;
+
+  uint16_t sorted[RTT_SAMPLES];
+  std::copy(history.samples, history.samples + history.count, sorted);
+  int rank = (history.count * 95 + 99) / 100 - 1;
+  std::nth_element(sorted, sorted + rank, sorted + history.count);
+
+  int timeout = sorted[rank] * RTT_MULTIPLIER + RTT_SLACK;
+  return std::min(std::max(timeout, mMinTimeout), (int)MAX_TIMEOUT);
+}
+
+/*******************************************************************************
+**
+** Function:        addSample
+**
+** Description:     Record the round trip of a successful presence-check.
+**                  fingerprint: Tag fingerprint.
+**                  rttMs: Round trip in milliseconds.
+**
+** Returns:         None
+**
+*******************************************************************************/
+void PresenceCheckEngine::addSample(uint32_t fingerprint, int rttMs) {
+  AutoMutex lock(mMutex);
+  auto it = mRtt.find(fingerprint);
+  if (it == mRtt.end()) {
+    if (mRtt.size() >= MAX_FINGERPRINTS) evictLeastRecentlyUsed(mRtt);
+    it = mRtt.insert(std::make_pair(fingerprint, RttHistory())).first;
+    it->second.count = 0;
+    it->second.next = 0;
+  }
+  RttHistory& history = it->second;
+  history.lastUsed = ++mUseCount;
+  history.samples[history.next] =
+      (uint16_t)std::min(std::max(rttMs, 0), (int)MAX_TIMEOUT);
+  history.next = (history.next + 1) % RTT_SAMPLES;
+  if (history.count < RTT_SAMPLES) history.count++;
+}
+
+/*******************************************************************************
+**
+** Function:        getMethod
+**
+** Description:     Get the method that last worked for this kind of tag.
+**                  fingerprint: Tag fingerprint.
+**                  method: Method to use if nothing was learned.
+**
+** Returns:         Presence-check method.
+**
+*******************************************************************************/
+tNFA_RW_PRES_CHK_OPTION PresenceCheckEngine::getMethod(
+    uint32_t fingerprint, tNFA_RW_PRES_CHK_OPTION method) {
+  AutoMutex lock(mMutex);
+  auto it = mMethods.find(fingerprint);
+  if (it == mMethods.end()) return method;
+  it->second.lastUsed = ++mUseCount;
+  return it->second.method;
+}
+
+/*******************************************************************************
+**
+** Function:        learnMethod
+**
+** Description:     Remember the method that worked for this kind of tag.
+**                  fingerprint: Tag fingerprint.
+**                  method: Presence-check method.
+**
+** Returns:         None
+**
+*******************************************************************************/
+void PresenceCheckEngine::learnMethod(uint32_t fingerprint,
+                                      tNFA_RW_PRES_CHK_OPTION method) {
+  AutoMutex lock(mMutex);
+  auto it = mMethods.find(fingerprint);
+  if (it != mMethods.end()) {
+    it->second.lastUsed = ++mUseCount;
+    if (it->second.method == method) return;
+  } else if (mMethods.size() >= MAX_FINGERPRINTS) {
+    evictLeastRecentlyUsed(mMethods);
+  }
+  mMethods[fingerprint] = {method, ++mUseCount};
+  DLOG_IF(INFO, nfc_debug_enabled) << StringPrintf(
+      "%s: fingerprint=0x%08X; method=%u", __func__, fingerprint, method);
+}
@@ -0,0 +1,166 @@
+/******************************************************************************
+ *
+ *  Copyright 2024 NXP
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/*
+ *  Learned presence-check timing and method, keyed by tag fingerprint.
+ */
+#pragma once
+#include <stdint.h>
+#include <map>
+#include "Mutex.h"
+#include "nfa_rw_api.h"
+
+#define NAME_PRESENCE_CHECK_MIN_TIMEOUT "PRESENCE_CHECK_MIN_TIMEOUT"
+#define NAME_PRESENCE_CHECK_INTERVAL "PRESENCE_CHECK_INTERVAL"
+
+class PresenceCheckEngine {
+  friend class PresenceCheckEngineTest;
+
+ public:
+  static const int MAX_TIMEOUT = 2000;  // ms; used until enough samples
+
+  /*******************************************************************************
+  **
+  ** Function:        getInstance
+  **
+  ** Description:     Get the singleton of this object.
+  **
+  ** Returns:         Reference to this object.
+  **
+  *******************************************************************************/
+  static PresenceCheckEngine& getInstance();
+
+  /*******************************************************************************
+  **
+  ** Function:        initialize
+  **
+  ** Description:     Read the configuration.
+  **
+  ** Returns:         None
+  **
+  *******************************************************************************/
+  void initialize();
+
+  /*******************************************************************************
+  **
+  ** Function:        makeFingerprint
+  **
+  ** Description:     Hash the bytes identifying a kind of tag: protocol,
+  **                  ATQA/SAK or SENSB_RES, and ATS historical bytes.
+  **                  protocol: RF protocol of the target.
+  **                  data: Identifying bytes.
+  **                  len: Length of data.
+  **
+  ** Returns:         Fingerprint.
+  **
+  *******************************************************************************/
+  static uint32_t makeFingerprint(int protocol, const uint8_t* data,
+                                  size_t len);
+
+  /*******************************************************************************
+  **
+  ** Function:        getTimeout
+  **
+  ** Description:     Get how long to wait for NFA_PRESENCE_CHECK_EVT: a
+  **                  multiple of the 95th percentile of the observed round
+  **                  trips, bounded by the configured minimum and
+  **                  MAX_TIMEOUT.
+  **                  fingerprint: Tag fingerprint.
+  **
+  ** Returns:         Timeout in milliseconds.
+  **
+  *******************************************************************************/
+  int getTimeout(uint32_t fingerprint);
+
+  /*******************************************************************************
+  **
+  ** Function:        addSample
+  **
+  ** Description:     Record the round trip of a successful presence-check.
+  **                  fingerprint: Tag fingerprint.
+  **                  rttMs: Round trip in milliseconds.
+  **
+  ** Returns:         None
+  **
+  *******************************************************************************/
+  void addSample(uint32_t fingerprint, int rttMs);
+
+  /*******************************************************************************
+  **
+  ** Function:        getMethod
+  **
+  ** Description:     Get the method that last worked for this kind of tag.
+  **                  fingerprint: Tag fingerprint.
+  **                  method: Method to use if nothing was learned.
+  **
+  ** Returns:         Presence-check method.
+  **
+  *******************************************************************************/
+  tNFA_RW_PRES_CHK_OPTION getMethod(uint32_t fingerprint,
+                                    tNFA_RW_PRES_CHK_OPTION method);
+
+  /*******************************************************************************
+  **
+  ** Function:        learnMethod
+  **
+  ** Description:     Remember the method that worked for this kind of tag.
+  **                  fingerprint: Tag fingerprint.
+  **                  method: Presence-check method.
+  **
+  ** Returns:         None
+  **
+  *******************************************************************************/
+  void learnMethod(uint32_t fingerprint, tNFA_RW_PRES_CHK_OPTION method);
+
+  /*******************************************************************************
+  **
+  ** Function:        getPollInterval
+  **
+  ** Description:     Get the configured upper bound of the interval between
+  **                  two presence-checks of the service watchdog.
+  **
+  ** Returns:         Interval in milliseconds; 0 if not configured.
+  **
+  *******************************************************************************/
+  int getPollInterval() { return mPollInterval; }
+
+ private:
+  static const int RTT_SAMPLES = 32;
+  static const int MIN_SAMPLES = 8;
+  static const size_t MAX_FINGERPRINTS = 32;
+
+  struct RttHistory {
+    uint16_t samples[RTT_SAMPLES];
+    int count;
+    int next;
+    uint64_t lastUsed;
+  };
+  struct LearnedMethod {
+    tNFA_RW_PRES_CHK_OPTION method;
+    uint64_t lastUsed;
+  };
+
+  Mutex mMutex;
+  std::map<uint32_t, RttHistory> mRtt;
+  std::map<uint32_t, LearnedMethod> mMethods;
+  uint64_t mUseCount;  // stamps lastUsed; the least recently used goes first
+  int mMinTimeout;
+  int mPollInterval;
+
+  PresenceCheckEngine();
+};
@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+#include "PresenceCheckEngine.h"
+
+class PresenceCheckEngineTest : public ::testing::Test {
+ protected:
+  void SetUp() override { mEngine.reset(new PresenceCheckEngine()); }
+  bool hasSamples(uint32_t fingerprint) {
+    return mEngine->mRtt.count(fingerprint) != 0;
+  }
+
+  std::unique_ptr<PresenceCheckEngine> mEngine;
+};
+
+TEST_F(PresenceCheckEngineTest, MaxTimeoutUntilEnoughSamples) {
+  uint8_t atqaSak[] = {0x44, 0x00, 0x20};
+  uint32_t fingerprint =
+      PresenceCheckEngine::makeFingerprint(4, atqaSak, sizeof(atqaSak));
+
+  EXPECT_EQ(PresenceCheckEngine::MAX_TIMEOUT,
+            mEngine->getTimeout(fingerprint));
+  for (int i = 0; i < 7; i++) mEngine->addSample(fingerprint, 10);
+  EXPECT_EQ(PresenceCheckEngine::MAX_TIMEOUT,
+            mEngine->getTimeout(fingerprint));
+
+  mEngine->addSample(fingerprint, 10);
+  int timeout = mEngine->getTimeout(fingerprint);
+  EXPECT_GE(timeout, 10);
+  EXPECT_LT(timeout, PresenceCheckEngine::MAX_TIMEOUT);
+}
+
+TEST_F(PresenceCheckEngineTest, TimeoutFollowsSlowRoundTrips) {
+  uint32_t fingerprint = PresenceCheckEngine::makeFingerprint(4, NULL, 0);
+
+  for (int i = 0; i < 8; i++) mEngine->addSample(fingerprint, 10);
+  int fastTimeout = mEngine->getTimeout(fingerprint);
+  for (int i = 0; i < 32; i++) mEngine->addSample(fingerprint, 200);
+
+  EXPECT_GT(mEngine->getTimeout(fingerprint), fastTimeout);
+}
+
+TEST_F(PresenceCheckEngineTest, LearnedMethodPerFingerprint) {
+  uint8_t ats1[] = {0x80, 0x31};
+  uint8_t ats2[] = {0x80, 0x32};
+  uint32_t fingerprint1 = PresenceCheckEngine::makeFingerprint(4, ats1, 2);
+  uint32_t fingerprint2 = PresenceCheckEngine::makeFingerprint(4, ats2, 2);
+
+  mEngine->learnMethod(fingerprint1, NFA_RW_PRES_CHK_I_BLOCK);
+
+  EXPECT_EQ(NFA_RW_PRES_CHK_I_BLOCK,
+            mEngine->getMethod(fingerprint1, NFA_RW_PRES_CHK_ISO_DEP_NAK));
+  EXPECT_EQ(NFA_RW_PRES_CHK_ISO_DEP_NAK,
+            mEngine->getMethod(fingerprint2, NFA_RW_PRES_CHK_ISO_DEP_NAK));
+}
+
+TEST_F(PresenceCheckEngineTest, EvictsLeastRecentlyUsedFingerprint) {
+  for (uint8_t i = 0; i < 32; i++) {
+    mEngine->addSample(PresenceCheckEngine::makeFingerprint(4, &i, 1), 10);
+  }
+  uint8_t first = 0;
+  uint8_t second = 1;
+  uint8_t extra = 32;
+  uint32_t firstFingerprint =
+      PresenceCheckEngine::makeFingerprint(4, &first, 1);
+  uint32_t secondFingerprint =
+      PresenceCheckEngine::makeFingerprint(4, &second, 1);
+  mEngine->getTimeout(firstFingerprint);
+
+  mEngine->addSample(PresenceCheckEngine::makeFingerprint(4, &extra, 1), 10);
+
+  EXPECT_TRUE(hasSamples(firstFingerprint));
+  EXPECT_FALSE(hasSamples(secondFingerprint));
+}
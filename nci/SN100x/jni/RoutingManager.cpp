@@ -40,9 +40,13 @@
 #include <base/logging.h>
 #include <nativehelper/JNIHelp.h>
 #include <nativehelper/ScopedLocalRef.h>
+#include <nativehelper/ScopedPrimitiveArray.h>
 
 #include "JavaClassConstants.h"
+#include "NfcStatsUtil.h"
+#include "NfcTrace.h"
 #include "RoutingManager.h"
+#include "debug_lmrt.h"
 #include "nfa_ce_api.h"
 #include "nfa_ee_api.h"
 #include "nfc_config.h"
@@ -82,7 +86,12 @@ const JNINativeMethod RoutingManager::sMethods[] = {
          RoutingManager::com_android_nfc_cardemulation_doGetAidMatchingMode},
     {"doGetDefaultIsoDepRouteDestination", "()I",
      (void*)RoutingManager::
-         com_android_nfc_cardemulation_doGetDefaultIsoDepRouteDestination}};
+         com_android_nfc_cardemulation_doGetDefaultIsoDepRouteDestination},
+    {"doGetPlannedAidTableSize", "([B)I",
+     (void*)RoutingManager::
+         com_android_nfc_cardemulation_doGetPlannedAidTableSize},
+    {"doResolveAidRoute", "([B)I",
+     (void*)RoutingManager::com_android_nfc_cardemulation_doResolveAidRoute}};
 
 static const int MAX_NUM_EE = 6;
 // SCBR from host works only when App is in foreground
@@ -100,6 +109,15 @@ extern bool isDynamicUiccEnabled;
 static const uint8_t AID_ROUTE_QUAL_PREFIX = 0x10;
 RoutingManager::RoutingManager()
     : mSecureNfcEnabled(false),
+      mAidTransactionOpen(false),
+      mAidTransactionAborted(false),
+      mAidTransactionStaged(0),
+      mAidTransactionPending(0),
+      mAidTransactionFailed(0),
+      mAidFlush(0),
+      mAidShadowValid(false),
+      mRoutingDirty(true),
+      mAidShadowGeneration(0),
       mNativeData(NULL)
 #if (NXP_EXTNS != TRUE)
       ,
@@ -129,6 +147,8 @@ RoutingManager::RoutingManager()
 
   mAidMatchingMode =
       NfcConfig::getUnsigned(NAME_AID_MATCHING_MODE, AID_MATCHING_EXACT_ONLY);
+  mAidPlanner.setMatching(mAidMatchingMode != AID_MATCHING_EXACT_ONLY,
+                          mAidMatchingMode == AID_MATCHING_PREFIX_ONLY);
 
   mDefaultSysCodeRoute =
       NfcConfig::getUnsigned(NAME_DEFAULT_SYS_CODE_ROUTE, 0xC0);
@@ -444,7 +464,6 @@ bool RoutingManager::addAidRouting(const uint8_t* aid, uint8_t aidLen,
   {
     return false;
   }
-  SyncEventGuard guard(mAidAddRemoveEvent);
   if (!mSecureNfcEnabled) {
     /*masking lower 8 bits as power states will be available only in that
      * region*/
@@ -463,6 +482,25 @@ bool RoutingManager::addAidRouting(const uint8_t* aid, uint8_t aidLen,
                        : power;
     }
   }
+  if (aidLen > 0) return planAidRoute(aid, aidLen, seId, powerState, aidInfo);
+  if (isAidRouted(aid, aidLen, seId, powerState, aidInfo)) {
+    DLOG_IF(INFO, nfc_debug_enabled) << fn << ": AID already routed";
+    return true;
+  }
+  updateAidShadow(aid, aidLen, seId, powerState, aidInfo);
+  {
+    SyncEventGuard guard(mAidTransactionEvent);
+    if (mAidTransactionOpen) {
+      if (!waitAidTransaction(AID_TRANSACTION_WINDOW - 1)) {
+        invalidateAidShadow();
+        return false;
+      }
+      return stageAidRequest(
+          true, NFA_EeAddAidRouting(seId, aidLen, (uint8_t*)aid, powerState,
+                                    aidInfo));
+    }
+  }
+  SyncEventGuard guard(mAidAddRemoveEvent);
   tNFA_STATUS nfaStat =
       NFA_EeAddAidRouting(seId, aidLen, (uint8_t*)aid, powerState, aidInfo);
   #else
@@ -475,6 +513,24 @@ bool RoutingManager::addAidRouting(const uint8_t* aid, uint8_t aidLen,
           (route != 0x00) ? mOffHostAidRoutingPowerState & power : power;
     }
   }
+  if (aidLen > 0) return planAidRoute(aid, aidLen, route, powerState, aidInfo);
+  if (isAidRouted(aid, aidLen, route, powerState, aidInfo)) {
+    DLOG_IF(INFO, nfc_debug_enabled) << fn << ": AID already routed";
+    return true;
+  }
+  updateAidShadow(aid, aidLen, route, powerState, aidInfo);
+  {
+    SyncEventGuard guard(mAidTransactionEvent);
+    if (mAidTransactionOpen) {
+      if (!waitAidTransaction(AID_TRANSACTION_WINDOW - 1)) {
+        invalidateAidShadow();
+        return false;
+      }
+      return stageAidRequest(
+          true, NFA_EeAddAidRouting(route, aidLen, (uint8_t*)aid, powerState,
+                                    aidInfo));
+    }
+  }
   SyncEventGuard guard(mRoutingEvent);
   mAidRoutingConfigured = false;
   tNFA_STATUS nfaStat =
@@ -493,6 +549,7 @@ bool RoutingManager::addAidRouting(const uint8_t* aid, uint8_t aidLen,
     return true;
   } else {
     LOG(ERROR) << fn << ": failed to route AID";
+    invalidateAidShadow();
     return false;
   }
 }
@@ -501,6 +558,26 @@ bool RoutingManager::addAidRouting(const uint8_t* aid, uint8_t aidLen,
 bool RoutingManager::removeAidRouting(const uint8_t* aid, uint8_t aidLen) {
   static const char fn[] = "RoutingManager::removeAidRouting";
   DLOG_IF(INFO, nfc_debug_enabled) << fn << ": enter";
+  if (aidLen > 0) {
+    {
+      AutoMutex lock(mAidPlannerMutex);
+      mAidPlanner.remove(aid, aidLen);
+    }
+    return applyAidPlan();
+  }
+  // the empty AID is set by setEmptyAidEntry(), outside of the planner
+  removeFromAidShadow(aid, aidLen);
+  {
+    SyncEventGuard guard(mAidTransactionEvent);
+    if (mAidTransactionOpen) {
+      if (!waitAidTransaction(AID_TRANSACTION_WINDOW - 1)) {
+        invalidateAidShadow();
+        return false;
+      }
+      return stageAidRequest(false,
+                             NFA_EeRemoveAidRouting(aidLen, (uint8_t*)aid));
+    }
+  }
 #if(NXP_EXTNS == TRUE)
   SyncEventGuard guard(mAidAddRemoveEvent);
 #else
@@ -521,28 +598,505 @@ bool RoutingManager::removeAidRouting(const uint8_t* aid, uint8_t aidLen) {
     return true;
   } else {
     LOG(WARNING) << fn << ": failed to remove AID";
+    invalidateAidShadow();
+    return false;
+  }
+}
+
+/*******************************************************************************
+**
+** Function:        beginAidTransaction
+**
+** Description:     Start staging AID routes. Until the next commitRouting(),
+**                  addAidRouting() and removeAidRouting() only update the
+**                  planner; commitRouting() then sends the net changes to
+**                  NFA, keeping up to AID_TRANSACTION_WINDOW requests in
+**                  flight.
+**
+** Returns:         True if ok.
+**
+*******************************************************************************/
+bool RoutingManager::beginAidTransaction() {
+  static const char fn[] = "RoutingManager::beginAidTransaction";
+  SyncEventGuard guard(mAidTransactionEvent);
+  if (mAidTransactionOpen) {
+    DLOG_IF(INFO, nfc_debug_enabled)
+        << StringPrintf("%s: already open; staged=%d", fn,
+                        mAidTransactionStaged);
+    return true;
+  }
+  DLOG_IF(INFO, nfc_debug_enabled) << fn;
+  mAidTransactionOpen = true;
+  mAidTransactionAborted = false;
+  mAidTransactionStaged = 0;
+  mAidTransactionFailed = 0;
+  return true;
+}
+
+/*******************************************************************************
+**
+** Function:        waitAidTransaction
+**
+** Description:     Wait until few enough staged requests are in flight.
+**                  Caller must hold mAidTransactionEvent.
+**                  maxPending: Number of requests allowed to stay in flight.
+**
+** Returns:         True if ok; false if timeout occurs or the transaction
+**                  was aborted by notifyAllEvents().
+**
+*******************************************************************************/
+bool RoutingManager::waitAidTransaction(int maxPending) {
+  bool waitOk =
+      mAidTransactionEvent.wait(AID_TRANSACTION_TIMEOUT, [this, maxPending] {
+        return mAidTransactionAborted ||
+               (mAidTransactionPending <= maxPending);
+      });
+  if (mAidTransactionAborted) {
+    LOG(ERROR) << StringPrintf("RoutingManager::waitAidTransaction: aborted");
+    return false;
+  }
+  if (!waitOk) {
+    LOG(ERROR) << StringPrintf(
+        "RoutingManager::waitAidTransaction: timeout; pending=%d",
+        mAidTransactionPending);
+  }
+  return waitOk;
+}
+
+/*******************************************************************************
+**
+** Function:        stageAidRequest
+**
+** Description:     Account for an AID request sent in a transaction.
+**                  Caller must hold mAidTransactionEvent.
+**                  add: Whether the request adds an AID.
+**                  nfaStat: Status of the NFA call.
+**
+** Returns:         True if NFA accepted the request.
+**
+*******************************************************************************/
+bool RoutingManager::stageAidRequest(bool add, tNFA_STATUS nfaStat) {
+  mAidTransactionStaged++;
+  if (nfaStat != NFA_STATUS_OK) {
+    LOG(ERROR) << StringPrintf(
+        "RoutingManager::stageAidRequest: fail send; error=0x%X", nfaStat);
+    invalidateAidShadow();
+    mAidTransactionFailed++;
+    return false;
+  }
+  mAidRequests.push_back({mAidFlush, add});
+  mAidTransactionPending++;
+  return true;
+}
+
+/*******************************************************************************
+**
+** Function:        onAidTransactionEvent
+**
+** Description:     Complete the oldest staged request. NFA reports AID
+**                  requests in the order they were sent. The event of a
+**                  request staged by an earlier flush, reported after that
+**                  flush gave up on it, is consumed but not counted.
+**                  add: Whether the event is NFA_EE_ADD_AID_EVT.
+**                  status: Status of NFA_EE_ADD_AID_EVT/NFA_EE_REMOVE_AID_EVT.
+**
+** Returns:         True if the event belonged to a staged request.
+**
+*******************************************************************************/
+bool RoutingManager::onAidTransactionEvent(bool add, tNFA_STATUS status) {
+  SyncEventGuard guard(mAidTransactionEvent);
+  if (mAidRequests.empty()) return false;
+  AidRequest request = mAidRequests.front();
+  if (request.add != add) {
+    // not the next staged request: one sent outside of a transaction
+    LOG(ERROR) << StringPrintf(
+        "RoutingManager::onAidTransactionEvent: expected %s event",
+        request.add ? "add" : "remove");
     return false;
   }
+  mAidRequests.pop_front();
+  if (request.flush != mAidFlush) {
+    DLOG_IF(INFO, nfc_debug_enabled) << StringPrintf(
+        "RoutingManager::onAidTransactionEvent: late event of flush %u; "
+        "status=0x%X",
+        request.flush, status);
+    return true;
+  }
+  mAidTransactionPending--;
+  if (status != NFA_STATUS_OK) mAidTransactionFailed++;
+  mAidTransactionEvent.notifyOne();
+  return true;
+}
+
+/*******************************************************************************
+**
+** Function:        finishAidTransaction
+**
+** Description:     Close the transaction and send the planned AID routes.
+**
+** Returns:         True if no transaction was open or all requests succeeded.
+**
+*******************************************************************************/
+bool RoutingManager::finishAidTransaction() {
+  static const char fn[] = "RoutingManager::finishAidTransaction";
+  {
+    SyncEventGuard guard(mAidTransactionEvent);
+    if (!mAidTransactionOpen) return true;
+    mAidTransactionOpen = false;
+  }
+
+  bool flushOk = flushAidPlanner();
+  SyncEventGuard guard(mAidTransactionEvent);
+  DLOG_IF(INFO, nfc_debug_enabled)
+      << StringPrintf("%s: staged=%d; failed=%d", fn, mAidTransactionStaged,
+                      mAidTransactionFailed);
+  return flushOk && (mAidTransactionFailed == 0);
+}
+
+/*******************************************************************************
+**
+** Function:        planAidRoute
+**
+** Description:     Register an AID in the planner and apply the plan.
+**                  aid: AID.
+**                  aidLen: Length of the AID.
+**                  route: NFCEE handle.
+**                  power: Power state.
+**                  aidInfo: AID qualifier.
+**
+** Returns:         True if ok.
+**
+*******************************************************************************/
+bool RoutingManager::planAidRoute(const uint8_t* aid, uint8_t aidLen,
+                                  int route, uint8_t power, int aidInfo) {
+  static const char fn[] = "RoutingManager::planAidRoute";
+  AidRoutingPlanner::Entry entry = {std::vector<uint8_t>(aid, aid + aidLen),
+                                    route, power, aidInfo};
+  {
+    AutoMutex lock(mAidPlannerMutex);
+    if (nfc_debug_enabled) {
+      std::vector<AidRoutingPlanner::Entry> conflicts;
+      mAidPlanner.getConflicts(entry, conflicts);
+      for (const AidRoutingPlanner::Entry& conflict : conflicts) {
+        DLOG_IF(INFO, nfc_debug_enabled) << StringPrintf(
+            "%s: overlaps AID of len %zu on route 0x%X", fn,
+            conflict.aid.size(), conflict.route);
+      }
+    }
+    mAidPlanner.add(entry);
+  }
+  return applyAidPlan();
+}
+
+/*******************************************************************************
+**
+** Function:        applyAidPlan
+**
+** Description:     Send the planned AID routes now, unless a transaction
+**                  defers them to commitRouting().
+**
+** Returns:         True if ok.
+**
+*******************************************************************************/
+bool RoutingManager::applyAidPlan() {
+  {
+    SyncEventGuard guard(mAidTransactionEvent);
+    if (mAidTransactionOpen) return true;
+  }
+  return flushAidPlanner();
+}
+
+/*******************************************************************************
+**
+** Function:        flushAidPlanner
+**
+** Description:     Send the difference between the planned AID routes and
+**                  those sent before: removes first, then adds, keeping up
+**                  to AID_TRANSACTION_WINDOW requests in flight.
+**
+** Returns:         True if all requests succeeded.
+**
+*******************************************************************************/
+bool RoutingManager::flushAidPlanner() {
+  static const char fn[] = "RoutingManager::flushAidPlanner";
+  std::vector<AidRoutingPlanner::Entry> removes, adds;
+  {
+    AutoMutex lock(mAidPlannerMutex);
+    mAidPlanner.diff(removes, adds);
+  }
+
+  SyncEventGuard guard(mAidTransactionEvent);
+  int failed = mAidTransactionFailed;
+  bool waitOk = true;
+  mAidTransactionAborted = false;
+  for (const AidRoutingPlanner::Entry& entry : removes) {
+    waitOk = waitAidTransaction(AID_TRANSACTION_WINDOW - 1);
+    if (!waitOk) break;
+    removeFromAidShadow(entry.aid.data(), entry.aid.size());
+    stageAidRequest(false, NFA_EeRemoveAidRouting(entry.aid.size(),
+                                                  (uint8_t*)entry.aid.data()));
+  }
+  for (const AidRoutingPlanner::Entry& entry : adds) {
+    if (!waitOk) break;
+    if (isAidRouted(entry.aid.data(), entry.aid.size(), entry.route,
+                    entry.power, entry.aidInfo))
+      continue;
+    waitOk = waitAidTransaction(AID_TRANSACTION_WINDOW - 1);
+    if (!waitOk) break;
+    updateAidShadow(entry.aid.data(), entry.aid.size(), entry.route,
+                    entry.power, entry.aidInfo);
+    stageAidRequest(true, NFA_EeAddAidRouting(entry.route, entry.aid.size(),
+                                              (uint8_t*)entry.aid.data(),
+                                              entry.power, entry.aidInfo));
+  }
+  if (waitOk) waitOk = waitAidTransaction(0);
+  // requests still in flight stay queued: their late events are dropped
+  // rather than counted for the next flush
+  mAidTransactionPending = 0;
+  mAidFlush++;
+
+  if (!waitOk || (mAidTransactionFailed != failed)) {
+    LOG(ERROR) << StringPrintf("%s: failed=%d", fn,
+                               mAidTransactionFailed - failed);
+    invalidateAidShadow();
+    AutoMutex lock(mAidPlannerMutex);
+    mAidPlanner.forgetProgrammed(removes);
+    return false;
+  }
+  DLOG_IF(INFO, nfc_debug_enabled) << StringPrintf(
+      "%s: removed=%zu; added=%zu", fn, removes.size(), adds.size());
+  return true;
 }
 
 bool RoutingManager::commitRouting() {
   static const char fn[] = "RoutingManager::commitRouting";
   tNFA_STATUS nfaStat = 0;
   DLOG_IF(INFO, nfc_debug_enabled) << fn;
+  bool staged = finishAidTransaction();
 #if(NXP_EXTNS != TRUE)
   if(mEeInfoChanged) {
     mSeTechMask = updateEeTechRouteSetting();
     mEeInfoChanged = false;
   }
 #endif
+  uint32_t generation;
+  if (!isRoutingDirty(generation)) {
+    DLOG_IF(INFO, nfc_debug_enabled) << fn << ": routing unchanged";
+    return staged;
+  }
   {
+    uint64_t startMicros = NfcStatsUtil::nowMicros();
     SyncEventGuard guard(mEeUpdateEvent);
     nfaStat = NFA_EeUpdateNow();
     if (nfaStat == NFA_STATUS_OK) {
       mEeUpdateEvent.wait();  // wait for NFA_EE_UPDATED_EVT
+      NfcStatsUtil::recordLatency(NfcStatsUtil::HIST_ROUTING_COMMIT,
+                                  NfcStatsUtil::nowMicros() - startMicros);
     }
   }
-  return (nfaStat == NFA_STATUS_OK);
+  if (nfaStat == NFA_STATUS_OK) {
+    snapshotRoutingTable(generation);
+  } else {
+    invalidateAidShadow();
+  }
+  return (nfaStat == NFA_STATUS_OK) && staged;
+}
+
+/*******************************************************************************
+**
+** Function:        hasRoutingChanges
+**
+** Description:     Whether commitRouting() would send the routing table.
+**
+** Returns:         True if routing changed since the last commit.
+**
+*******************************************************************************/
+bool RoutingManager::hasRoutingChanges() {
+  {
+    // AID routes planned in a transaction are sent by commitRouting()
+    AutoMutex lock(mAidPlannerMutex);
+    if (mAidPlanner.hasChanges()) return true;
+  }
+  AutoMutex lock(mAidShadowMutex);
+  return mRoutingDirty || !mAidShadowValid;
+}
+
+/*******************************************************************************
+**
+** Function:        isRoutingDirty
+**
+** Description:     Check and clear the routing changes before a commit.
+**                  generation: Receives the AID shadow generation, to be
+**                  passed to snapshotRoutingTable().
+**
+** Returns:         True if the routing table must be sent.
+**
+*******************************************************************************/
+bool RoutingManager::isRoutingDirty(uint32_t& generation) {
+  AutoMutex lock(mAidShadowMutex);
+  generation = mAidShadowGeneration;
+  if (!mRoutingDirty && mAidShadowValid) return false;
+  mRoutingDirty = false;
+  return true;
+}
+
+/*******************************************************************************
+**
+** Function:        snapshotRoutingTable
+**
+** Description:     Seed the AID shadow from the committed listen mode
+**                  routing table, unless AID routes changed during the
+**                  commit.
+**                  generation: AID shadow generation when the commit began.
+**
+** Returns:         None
+**
+*******************************************************************************/
+void RoutingManager::snapshotRoutingTable(uint32_t generation) {
+  static const char fn[] = "RoutingManager::snapshotRoutingTable";
+  const std::vector<uint8_t>& tlvs = *lmrt_get_tlvs();
+  map<vector<uint8_t>, AidRoute> shadow;
+  size_t offset = 0;
+
+  // entry: type, length, route, power state, AID
+  while (offset + 2 <= tlvs.size()) {
+    uint8_t type = tlvs[offset];
+    uint8_t len = tlvs[offset + 1];
+    if (offset + 2 + len > tlvs.size()) {
+      LOG(ERROR) << StringPrintf("%s: truncated entry at %zu", fn, offset);
+      invalidateAidShadow();
+      return;
+    }
+    if (((type & 0x0F) == NFC_ROUTE_TAG_AID) && (len >= 2)) {
+      AidRoute& entry =
+          shadow[vector<uint8_t>(tlvs.begin() + offset + 4,
+                                 tlvs.begin() + offset + 2 + len)];
+      entry.route = tlvs[offset + 2];
+      entry.power = tlvs[offset + 3];
+      entry.qualifier = type & 0xF0;
+    }
+    offset += 2 + len;
+  }
+
+  AutoMutex lock(mAidShadowMutex);
+  if (generation != mAidShadowGeneration) return;
+  mAidShadow.swap(shadow);
+  mAidShadowValid = true;
+  DLOG_IF(INFO, nfc_debug_enabled)
+      << StringPrintf("%s: %zu AID(s)", fn, mAidShadow.size());
+}
+
+/*******************************************************************************
+**
+** Function:        isAidRouted
+**
+** Description:     Whether the controller already has this AID entry, so
+**                  that adding it again would change nothing.
+**                  aid: AID.
+**                  aidLen: Length of the AID.
+**                  route: NFA handle of the route.
+**                  power: Power state.
+**                  aidInfo: AID qualifier.
+**
+** Returns:         True if the same entry is routed.
+**
+*******************************************************************************/
+bool RoutingManager::isAidRouted(const uint8_t* aid, uint8_t aidLen, int route,
+                                 uint8_t power, int aidInfo) {
+  AutoMutex lock(mAidShadowMutex);
+  if (!mAidShadowValid) return false;
+  auto it = mAidShadow.find(vector<uint8_t>(aid, aid + aidLen));
+  return (it != mAidShadow.end()) && (it->second.route == (route & 0xFF)) &&
+         (it->second.power == power) &&
+         (it->second.qualifier == (aidInfo & 0xF0));
+}
+
+/*******************************************************************************
+**
+** Function:        updateAidShadow
+**
+** Description:     Record an AID entry sent to NFA.
+**                  aid: AID.
+**                  aidLen: Length of the AID.
+**                  route: NFA handle of the route.
+**                  power: Power state.
+**                  aidInfo: AID qualifier.
+**
+** Returns:         None
+**
+*******************************************************************************/
+void RoutingManager::updateAidShadow(const uint8_t* aid, uint8_t aidLen,
+                                     int route, uint8_t power, int aidInfo) {
+  AutoMutex lock(mAidShadowMutex);
+  AidRoute& entry = mAidShadow[vector<uint8_t>(aid, aid + aidLen)];
+  entry.route = route & 0xFF;
+  entry.power = power;
+  entry.qualifier = aidInfo & 0xF0;
+  mRoutingDirty = true;
+  mAidShadowGeneration++;
+}
+
+/*******************************************************************************
+**
+** Function:        removeFromAidShadow
+**
+** Description:     Record an AID removal sent to NFA.
+**                  aid: AID.
+**                  aidLen: Length of the AID.
+**
+** Returns:         None
+**
+*******************************************************************************/
+void RoutingManager::removeFromAidShadow(const uint8_t* aid, uint8_t aidLen) {
+  AutoMutex lock(mAidShadowMutex);
+  mAidShadow.erase(vector<uint8_t>(aid, aid + aidLen));
+  mRoutingDirty = true;
+  mAidShadowGeneration++;
+}
+
+/*******************************************************************************
+**
+** Function:        invalidateAidShadow
+**
+** Description:     Forget the AID shadow after an unexpected result, so that
+**                  every AID is sent and the next commit is not skipped.
+**
+** Returns:         None
+**
+*******************************************************************************/
+void RoutingManager::invalidateAidShadow() {
+  AutoMutex lock(mAidShadowMutex);
+  mAidShadow.clear();
+  mAidShadowValid = false;
+  mRoutingDirty = true;
+  mAidShadowGeneration++;
+}
+
+/*******************************************************************************
+**
+** Function:        onRoutingEvent
+**
+** Description:     Mark the routing dirty on every EE event that may have
+**                  changed technology, protocol or system code routes, or
+**                  the set of NFCEEs. AID requests are recorded when sent.
+**                  event: Event code.
+**
+** Returns:         None
+**
+*******************************************************************************/
+void RoutingManager::onRoutingEvent(tNFA_EE_EVT event) {
+  switch (event) {
+    case NFA_EE_UPDATED_EVT:
+    case NFA_EE_ACTION_EVT:
+    case NFA_EE_NO_CB_ERR_EVT:
+    case NFA_EE_ADD_AID_EVT:
+    case NFA_EE_REMOVE_AID_EVT:
+      break;
+    default: {
+      AutoMutex lock(mAidShadowMutex);
+      mRoutingDirty = true;
+    } break;
+  }
 }
 
 void RoutingManager::onNfccShutdown() {
@@ -963,6 +1517,7 @@ tNFA_TECHNOLOGY_MASK RoutingManager::updateEeTechRouteSetting() {
 void RoutingManager::nfaEeCallback(tNFA_EE_EVT event,
                                    tNFA_EE_CBACK_DATA* eventData) {
   static const char fn[] = "RoutingManager::nfaEeCallback";
+  NFC_TRACE_INSTANT("nfa", "eeCallback", event);
 
   RoutingManager& routingManager = RoutingManager::getInstance();
 #if (NXP_EXTNS == TRUE)
@@ -975,6 +1530,7 @@ void RoutingManager::nfaEeCallback(tNFA_EE_EVT event,
 #else
   if (eventData) routingManager.mCbEventData = *eventData;
 #endif
+  routingManager.onRoutingEvent(event);
 
   switch (event) {
     case NFA_EE_REGISTER_EVT: {
@@ -1082,11 +1638,15 @@ void RoutingManager::nfaEeCallback(tNFA_EE_EVT event,
       DLOG_IF(INFO, nfc_debug_enabled) << StringPrintf(
           "%s: NFA_EE_DISCOVER_REQ_EVT; status=0x%X; num ee=%u", __func__,
           eventData->discover_req.status, eventData->discover_req.num_ee);
-      SyncEventGuard guard(routingManager.mEeInfoEvent);
-      memcpy(&routingManager.mEeInfo, &eventData->discover_req,
-             sizeof(routingManager.mEeInfo));
-      routingManager.mReceivedEeInfo = true;
-      routingManager.mEeInfoEvent.notifyOne();
+      {
+        SyncEventGuard guard(routingManager.mEeInfoEvent);
+        memcpy(&routingManager.mEeInfo, &eventData->discover_req,
+               sizeof(routingManager.mEeInfo));
+        routingManager.mReceivedEeInfo = true;
+        routingManager.mEeInfoEvent.notifyOne();
+      }
+      // reported for NFCEE status notifications too
+      se.notifyEeStatusChanged();
     } break;
 
     case NFA_EE_NO_CB_ERR_EVT:
@@ -1097,13 +1657,21 @@ void RoutingManager::nfaEeCallback(tNFA_EE_EVT event,
     case NFA_EE_ADD_AID_EVT: {
       DLOG_IF(INFO, nfc_debug_enabled) << StringPrintf(
           "%s: NFA_EE_ADD_AID_EVT  status=%u", fn, eventData->status);
+      if (eventData->status != NFA_STATUS_OK)
+        routingManager.invalidateAidShadow();
+#if(NXP_EXTNS != TRUE)
+      {
+        SyncEventGuard guard(routingManager.mRoutingEvent);
+        routingManager.mAidRoutingConfigured =
+            (eventData->status == NFA_STATUS_OK);
+      }
+#endif
+      if (routingManager.onAidTransactionEvent(true, eventData->status)) break;
 #if(NXP_EXTNS == TRUE)
       SyncEventGuard guard(routingManager.mAidAddRemoveEvent);
       routingManager.mAidAddRemoveEvent.notifyOne();
 #else
       SyncEventGuard guard(routingManager.mRoutingEvent);
-      routingManager.mAidRoutingConfigured =
-          (eventData->status == NFA_STATUS_OK);
       routingManager.mRoutingEvent.notifyOne();
 #endif
     } break;
@@ -1125,13 +1693,21 @@ void RoutingManager::nfaEeCallback(tNFA_EE_EVT event,
     case NFA_EE_REMOVE_AID_EVT: {
       DLOG_IF(INFO, nfc_debug_enabled) << StringPrintf(
           "%s: NFA_EE_REMOVE_AID_EVT  status=%u", fn, eventData->status);
+      if (eventData->status != NFA_STATUS_OK)
+        routingManager.invalidateAidShadow();
+#if(NXP_EXTNS != TRUE)
+      {
+        SyncEventGuard guard(routingManager.mRoutingEvent);
+        routingManager.mAidRoutingConfigured =
+            (eventData->status == NFA_STATUS_OK);
+      }
+#endif
+      if (routingManager.onAidTransactionEvent(false, eventData->status)) break;
 #if(NXP_EXTNS == TRUE)
       SyncEventGuard guard(routingManager.mAidAddRemoveEvent);
       routingManager.mAidAddRemoveEvent.notifyOne();
 #else
       SyncEventGuard guard(routingManager.mRoutingEvent);
-      routingManager.mAidRoutingConfigured =
-          (eventData->status == NFA_STATUS_OK);
       routingManager.mRoutingEvent.notifyOne();
 #endif
     } break;
@@ -1140,6 +1716,7 @@ void RoutingManager::nfaEeCallback(tNFA_EE_EVT event,
       DLOG_IF(INFO, nfc_debug_enabled) << StringPrintf(
           "%s: NFA_EE_NEW_EE_EVT  h=0x%X; status=%u", fn,
           eventData->new_ee.ee_handle, eventData->new_ee.ee_status);
+      se.notifyEeStatusChanged();
     } break;
 
     case NFA_EE_UPDATED_EVT: {
@@ -1306,6 +1883,9 @@ bool RoutingManager::setNfcSecure(bool enable) {
 void RoutingManager::deinitialize() {
   onNfccShutdown();
   NFA_EeDeregister(nfaEeCallback);
+  invalidateAidShadow();
+  AutoMutex lock(mAidPlannerMutex);
+  mAidPlanner.clear();
 }
 
 int RoutingManager::registerJniFunctions(JNIEnv* e) {
@@ -1364,6 +1944,78 @@ int RoutingManager::
   return getInstance().mDefaultIsoDepRoute;
 }
 
+/*******************************************************************************
+**
+** Function:        com_android_nfc_cardemulation_doGetPlannedAidTableSize
+**
+** Description:     Dry run of the AID planner, to check whether a routing
+**                  table fits the controller before committing it.
+**                  e: JVM environment.
+**                  o: Java object.
+**                  entries: AID entries formatted as in the routing table:
+**                  type (0x02 | AID qualifier), length, route, power, AID.
+**
+** Returns:         Size in octets of the AID entries the planner would send,
+**                  or -1 if entries are malformed.
+**
+*******************************************************************************/
+int RoutingManager::com_android_nfc_cardemulation_doGetPlannedAidTableSize(
+    JNIEnv* e, jobject, jbyteArray entries) {
+  if (entries == NULL) return -1;
+  ScopedByteArrayRO bytes(e, entries);
+  const uint8_t* buf = reinterpret_cast<const uint8_t*>(&bytes[0]);
+  size_t bufLen = bytes.size();
+  AidRoutingPlanner planner;
+  std::vector<AidRoutingPlanner::Entry> table;
+  RoutingManager& routingManager = getInstance();
+
+  planner.setMatching(
+      routingManager.mAidMatchingMode != AID_MATCHING_EXACT_ONLY,
+      routingManager.mAidMatchingMode == AID_MATCHING_PREFIX_ONLY);
+  for (size_t i = 0; i < bufLen;) {
+    if ((bufLen - i < AidRoutingPlanner::TLV_HEADER_LEN) ||
+        ((buf[i] & 0x0F) != NFC_ROUTE_TAG_AID) || (buf[i + 1] < 2) ||
+        (bufLen - i - 2 < buf[i + 1])) {
+      LOG(ERROR) << StringPrintf("%s: malformed entry at %zu", __func__, i);
+      return -1;
+    }
+    const uint8_t* aid = buf + i + AidRoutingPlanner::TLV_HEADER_LEN;
+    size_t aidLen = buf[i + 1] - 2;
+    planner.add({std::vector<uint8_t>(aid, aid + aidLen), buf[i + 2],
+                 buf[i + 3], buf[i] & 0xF0});
+    i += 2 + buf[i + 1];
+  }
+  planner.getTable(table);
+  return AidRoutingPlanner::getTableSize(table);
+}
+
+/*******************************************************************************
+**
+** Function:        com_android_nfc_cardemulation_doResolveAidRoute
+**
+** Description:     Find the route a SELECT command is sent to, according to
+**                  the registered AIDs.
+**                  e: JVM environment.
+**                  o: Java object.
+**                  aid: AID of the SELECT command.
+**
+** Returns:         NFCEE ID of the route, or -1 if no entry routes the AID.
+**
+*******************************************************************************/
+int RoutingManager::com_android_nfc_cardemulation_doResolveAidRoute(
+    JNIEnv* e, jobject, jbyteArray aid) {
+  if (aid == NULL) return -1;
+  ScopedByteArrayRO bytes(e, aid);
+  RoutingManager& routingManager = getInstance();
+  AidRoutingPlanner::Entry winner;
+
+  AutoMutex lock(routingManager.mAidPlannerMutex);
+  if (!routingManager.mAidPlanner.resolve(
+          reinterpret_cast<const uint8_t*>(&bytes[0]), bytes.size(), winner))
+    return -1;
+  return winner.route & 0xFF;
+}
+
 #if(NXP_EXTNS == TRUE)
 /*******************************************************************************
  **
@@ -1725,7 +2377,12 @@ bool RoutingManager::clearAidTable ()
 {
     static const char fn [] = "RoutingManager::clearAidTable";
     DLOG_IF(INFO, nfc_debug_enabled) << StringPrintf("%s: enter", fn);
+    {
+        AutoMutex lock(mAidPlannerMutex);
+        mAidPlanner.clear();
+    }
     SyncEventGuard guard(RoutingManager::getInstance().mAidAddRemoveEvent);
+    invalidateAidShadow();
     tNFA_STATUS nfaStat = NFA_EeRemoveAidRouting(NFA_REMOVE_ALL_AID_LEN, (uint8_t*) NFA_REMOVE_ALL_AID);
     if (nfaStat == NFA_STATUS_OK)
     {
@@ -1829,9 +2486,16 @@ void RoutingManager::setEmptyAidEntry(int routeAndPowerState) {
 
     DLOG_IF(INFO, nfc_debug_enabled) << StringPrintf("%s: power %x",__func__,power);
     if(power){
+      if (mSecureNfcEnabled) power = 0x01;
+      if (isAidRouted(NULL, 0, routeLoc, power, AID_ROUTE_QUAL_PREFIX)) {
+        DLOG_IF(INFO, nfc_debug_enabled)
+            << StringPrintf("%s: already routed", __func__);
+        return;
+      }
+      updateAidShadow(NULL, 0, routeLoc, power, AID_ROUTE_QUAL_PREFIX);
       tNFA_STATUS nfaStat = NFA_EeAddAidRouting(
-          routeLoc, 0, NULL, mSecureNfcEnabled ? 0x01 : power,
-          AID_ROUTE_QUAL_PREFIX);
+          routeLoc, 0, NULL, power, AID_ROUTE_QUAL_PREFIX);
+      if (nfaStat != NFA_STATUS_OK) invalidateAidShadow();
       DLOG_IF(INFO, nfc_debug_enabled)
           << StringPrintf("%s: Status :0x%2x", __func__, nfaStat);
     }else{
@@ -2240,6 +2904,16 @@ void RoutingManager::notifyAllEvents() {
     SyncEventGuard guard(mAidAddRemoveEvent);
     mAidAddRemoveEvent.notifyOne();
   }
+  {
+    SyncEventGuard guard(mAidTransactionEvent);
+    mAidTransactionOpen = false;
+    mAidTransactionAborted = true;
+    mAidTransactionPending = 0;
+    mAidRequests.clear();
+    mAidFlush++;
+    mAidTransactionEvent.notifyOne();
+  }
+  invalidateAidShadow();
   {
     SyncEventGuard guard(mEeUpdateEvent);
     mEeUpdateEvent.notifyOne();
@@ -37,7 +37,10 @@
 *
 ******************************************************************************/
 #pragma once
+#include <deque>
 #include <vector>
+#include "AidRoutingPlanner.h"
+#include "Mutex.h"
 #include "NfcJniUtil.h"
 #include "RouteDataSet.h"
 #include "SyncEvent.h"
@@ -105,6 +108,8 @@ typedef struct routeInfo {
 }RouteInfo_t;
 #endif
 class RoutingManager {
+  friend class RoutingManagerBenchmark;
+
  public:
 #if(NXP_EXTNS == TRUE)
   static const uint8_t HOST_PWR_STATE = 0x11;
@@ -117,7 +122,9 @@ class RoutingManager {
   bool addAidRouting(const uint8_t* aid, uint8_t aidLen, int route, int aidInfo,
                      int power);
   bool removeAidRouting(const uint8_t* aid, uint8_t aidLen);
+  bool beginAidTransaction();
   bool commitRouting();
+  bool hasRoutingChanges();
   int registerT3tIdentifier(uint8_t* t3tId, uint8_t t3tIdLen);
   void deregisterT3tIdentifier(int handle);
   void onNfccShutdown();
@@ -175,6 +182,23 @@ class RoutingManager {
 
   void handleData(uint8_t technology, const uint8_t* data, uint32_t dataLen,
                   tNFA_STATUS status);
+  bool waitAidTransaction(int maxPending);
+  bool stageAidRequest(bool add, tNFA_STATUS nfaStat);
+  bool onAidTransactionEvent(bool add, tNFA_STATUS status);
+  bool finishAidTransaction();
+  bool planAidRoute(const uint8_t* aid, uint8_t aidLen, int route,
+                    uint8_t power, int aidInfo);
+  bool applyAidPlan();
+  bool flushAidPlanner();
+  bool isAidRouted(const uint8_t* aid, uint8_t aidLen, int route,
+                   uint8_t power, int aidInfo);
+  void updateAidShadow(const uint8_t* aid, uint8_t aidLen, int route,
+                       uint8_t power, int aidInfo);
+  void removeFromAidShadow(const uint8_t* aid, uint8_t aidLen);
+  void invalidateAidShadow();
+  void onRoutingEvent(tNFA_EE_EVT event);
+  bool isRoutingDirty(uint32_t& generation);
+  void snapshotRoutingTable(uint32_t generation);
   void notifyActivated(uint8_t technology);
   void notifyDeactivated(uint8_t technology);
   tNFA_TECHNOLOGY_MASK updateEeTechRouteSetting();
@@ -207,10 +231,50 @@ class RoutingManager {
   static int com_android_nfc_cardemulation_doGetAidMatchingMode(JNIEnv* e);
   static int com_android_nfc_cardemulation_doGetDefaultIsoDepRouteDestination(
       JNIEnv* e);
+  static int com_android_nfc_cardemulation_doGetPlannedAidTableSize(
+      JNIEnv* e, jobject o, jbyteArray entries);
+  static int com_android_nfc_cardemulation_doResolveAidRoute(JNIEnv* e,
+                                                             jobject o,
+                                                             jbyteArray aid);
   std::vector<uint8_t> mRxDataBuffer;
   map<int, uint16_t> mMapScbrHandle;
   bool mSecureNfcEnabled;
 
+  // AID add/remove requests sent without waiting, completed by commitRouting()
+  static const int AID_TRANSACTION_WINDOW = 16;    // requests in flight
+  static const int AID_TRANSACTION_TIMEOUT = 1000;  // ms
+  SyncEvent mAidTransactionEvent;  // guards the members below
+  bool mAidTransactionOpen;
+  bool mAidTransactionAborted;  // set by notifyAllEvents()
+  int mAidTransactionStaged;
+  int mAidTransactionPending;  // requests of the current flush in flight
+  int mAidTransactionFailed;
+  // staged requests not reported by NFA yet, oldest first; NFA reports AID
+  // requests in the order they were sent
+  struct AidRequest {
+    uint32_t flush;  // mAidFlush when sent
+    bool add;        // NFA_EE_ADD_AID_EVT rather than NFA_EE_REMOVE_AID_EVT
+  };
+  std::deque<AidRequest> mAidRequests;
+  uint32_t mAidFlush;  // sequence number of the current flush
+
+  // AID entries the controller has after the next commit, seeded from the
+  // last committed listen mode routing table
+  struct AidRoute {
+    uint8_t route;      // NFCEE ID
+    uint8_t power;      // power state
+    uint8_t qualifier;  // AID qualifier bits of the routing entry type
+  };
+  Mutex mAidShadowMutex;  // guards the members below
+  map<vector<uint8_t>, AidRoute> mAidShadow;
+  bool mAidShadowValid;
+  bool mRoutingDirty;       // routing changed since the last commit
+  uint32_t mAidShadowGeneration;
+
+  // registered AIDs; only the entries not covered by a prefix are sent
+  Mutex mAidPlannerMutex;  // guards the member below
+  AidRoutingPlanner mAidPlanner;
+
   // Fields below are final after initialize()
   nfc_jni_native_data* mNativeData;
   int mDefaultOffHostRoute;
@@ -0,0 +1,111 @@
+#include <benchmark/benchmark.h>
+
+#include <vector>
+#include "RoutingManager.h"
+#include "debug_lmrt.h"
+
+// drives the commit bookkeeping of RoutingManager; NFA is not started, so
+// only the host side of a commit is timed, not NFA_EeUpdateNow() itself
+class RoutingManagerBenchmark {
+ public:
+  static const uint8_t HOST_ROUTE = 0x00;
+  static const uint8_t ESE_ROUTE = 0xC0;
+  static const uint8_t POWER = 0x3B;
+
+  // an LMRT of numAids AID entries of 7 to 16 octets, as lmrt_get_tlvs()
+  // holds it after a commit
+  static void fillLmrt(int numAids) {
+    std::vector<uint8_t>& tlvs = *lmrt_get_tlvs();
+    tlvs.clear();
+    for (int i = 0; i < numAids; i++) {
+      std::vector<uint8_t> aid = getAid(i);
+      tlvs.push_back(NFC_ROUTE_TAG_AID);
+      tlvs.push_back(2 + aid.size());
+      tlvs.push_back((i % 4) ? HOST_ROUTE : ESE_ROUTE);
+      tlvs.push_back(POWER);
+      tlvs.insert(tlvs.end(), aid.begin(), aid.end());
+    }
+  }
+
+  static std::vector<uint8_t> getAid(int i) {
+    std::vector<uint8_t> aid = {0xA0, 0x00, 0x00, 0x06, 0x47, 0x2F, 0x00};
+    for (int j = 0; j < i % 10; j++) aid.push_back(i + j);
+    aid.push_back(i >> 8);
+    aid.push_back(i & 0xFF);
+    return aid;
+  }
+
+  // what commitRouting() does around NFA_EeUpdateNow() for a full commit
+  static void commit(RoutingManager& rm) {
+    uint32_t generation;
+    rm.isRoutingDirty(generation);
+    rm.snapshotRoutingTable(generation);
+  }
+
+  // an HCE service re-registering an AID it already routes
+  static bool isAidRouted(RoutingManager& rm, const std::vector<uint8_t>& aid,
+                          uint8_t route) {
+    return rm.isAidRouted(aid.data(), aid.size(), route, POWER, 0);
+  }
+
+  static void updateAidShadow(RoutingManager& rm,
+                              const std::vector<uint8_t>& aid,
+                              uint8_t route) {
+    rm.updateAidShadow(aid.data(), aid.size(), route, POWER, 0);
+  }
+};
+
+namespace {
+typedef RoutingManagerBenchmark Bench;
+
+// full commit: the shadow is rebuilt from the whole committed table
+void BM_RoutingFullCommit(benchmark::State& state) {
+  RoutingManager& rm = RoutingManager::getInstance();
+  Bench::fillLmrt(state.range(0));
+  for (auto _ : state) {
+    Bench::commit(rm);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_RoutingFullCommit)->Arg(16)->Arg(64)->Arg(128);
+
+// incremental commit after HCE service churn that changed nothing: every
+// AID is checked against the shadow, no AID is sent and RF discovery is
+// left running
+void BM_RoutingUnchangedCommit(benchmark::State& state) {
+  RoutingManager& rm = RoutingManager::getInstance();
+  const int numAids = state.range(0);
+  Bench::fillLmrt(numAids);
+  Bench::commit(rm);
+  std::vector<std::vector<uint8_t>> aids;
+  for (int i = 0; i < numAids; i++) aids.push_back(Bench::getAid(i));
+  for (auto _ : state) {
+    for (int i = 0; i < numAids; i++) {
+      benchmark::DoNotOptimize(Bench::isAidRouted(
+          rm, aids[i], (i % 4) ? Bench::HOST_ROUTE : Bench::ESE_ROUTE));
+    }
+    if (rm.hasRoutingChanges()) state.SkipWithError("routing changed");
+  }
+  state.SetItemsProcessed(state.iterations() * numAids);
+}
+BENCHMARK(BM_RoutingUnchangedCommit)->Arg(16)->Arg(64)->Arg(128);
+
+// incremental commit with one AID moved to another route: the table is
+// sent, so RF discovery is stopped for NFA_EeUpdateNow() and the shadow is
+// rebuilt; the RF downtime this causes on a device is reported as the
+// routing_rf_downtime histogram
+void BM_RoutingOneAidChanged(benchmark::State& state) {
+  RoutingManager& rm = RoutingManager::getInstance();
+  Bench::fillLmrt(state.range(0));
+  Bench::commit(rm);
+  std::vector<uint8_t> aid = Bench::getAid(1);
+  for (auto _ : state) {
+    Bench::updateAidShadow(rm, aid, Bench::ESE_ROUTE);
+    if (!rm.hasRoutingChanges()) state.SkipWithError("change not seen");
+    Bench::commit(rm);
+  }
+}
+BENCHMARK(BM_RoutingOneAidChanged)->Arg(16)->Arg(64)->Arg(128);
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -20,6 +20,8 @@
 #include <nativehelper/ScopedLocalRef.h>
 #include "JavaClassConstants.h"
 #include "NfcJniUtil.h"
+#include "NfcStatsUtil.h"
+#include "NfcTrace.h"
 #include <android-base/stringprintf.h>
 #include <base/logging.h>
 #include <semaphore.h>
@@ -28,6 +30,7 @@
 #include "nfc_config.h"
 #include "NativeJniExtns.h"
 #include "RoutingManager.h"
+#include "BerTlv.h"
 #include "HciEventManager.h"
 #include "MposManager.h"
 #include "SyncEvent.h"
@@ -89,6 +92,7 @@ SecureElement::SecureElement()
   mActualResponseSize = 0;
   mAtrInfolen = 0;
   mActualNumEe = 0;
+  mEeReady = false;
   memset(&mEeInfo, 0, MAX_NUM_EE * sizeof(tNFA_EE_INFO));
   memset(mAidForEmptySelect, 0, sizeof(mAidForEmptySelect));
   memset(mVerInfo, 0, sizeof(mVerInfo));
@@ -337,89 +341,6 @@ void SecureElement::notifyListenModeState (bool isActivated) {
                 << StringPrintf("%s: exit", fn);
 }
 
-/*******************************************************************************
-**
-** Function:        decodeBerTlvLength
-**
-** Description:     Decodes BER TLV length from the data provided
-**                  data : array of data to be processed
-**                  index : offset from which to consider processing
-**                  data_length : length of data to be processed
-**
-** Returns:         decoded_length
-**
-*******************************************************************************/
-int SecureElement::decodeBerTlvLength(uint8_t* data, int index,
-                                          int data_length) {
-    int decoded_length = -1;
-    int length = 0;
-    int temp = data[index] & 0xff;
-
-    LOG(INFO) << StringPrintf("decodeBerTlvLength index= %d data[index+0]=0x%x data[index+1]=0x%x len=%d",index, data[index], data[index+1], data_length);
-
-    if (temp < 0x80) {
-        decoded_length = temp;
-    } else if (temp == 0x81) {
-        if( index < data_length ) {
-            length = data[index+1] & 0xff;
-            if (length < 0x80) {
-                LOG(ERROR) << StringPrintf("Invalid TLV length encoding!");
-                goto TheEnd;
-            }
-            if (data_length < length + index) {
-                LOG(ERROR) << StringPrintf("Not enough data provided!");
-                goto TheEnd;
-            }
-        } else {
-            LOG(ERROR) << StringPrintf("Index %d out of range! [0..[%d",index, data_length);
-            goto TheEnd;
-        }
-        decoded_length = length;
-    } else if (temp == 0x82) {
-        if( (index + 1)< data_length ) {
-            length = ((data[index] & 0xff) << 8)
-                    | (data[index + 1] & 0xff);
-        } else {
-            LOG(ERROR) << StringPrintf("Index out of range! [0..[%d" , data_length);
-            goto TheEnd;
-        }
-        index += 2;
-        if (length < 0x100) {
-            LOG(ERROR) << StringPrintf("Invalid TLV length encoding!");
-            goto TheEnd;
-        }
-        if (data_length < length + index) {
-            LOG(ERROR) << StringPrintf("Not enough data provided!");
-            goto TheEnd;
-        }
-        decoded_length = length;
-    } else if (temp == 0x83) {
-        if( (index + 2)< data_length ) {
-            length = ((data[index] & 0xff) << 16)
-                    | ((data[index + 1] & 0xff) << 8)
-                    | (data[index + 2] & 0xff);
-        } else {
-            LOG(ERROR) << StringPrintf("Index out of range! [0..[%d", data_length);
-            goto TheEnd;
-        }
-        index += 3;
-        if (length < 0x10000) {
-            LOG(ERROR) << StringPrintf("Invalid TLV length encoding!");
-            goto TheEnd;
-        }
-        if (data_length < length + index) {
-            LOG(ERROR) << StringPrintf("Not enough data provided!");
-            goto TheEnd;
-        }
-        decoded_length = length;
-    } else {
-        LOG(ERROR) << StringPrintf("Unsupported TLV length encoding!");
-    }
-TheEnd:
-    LOG(INFO) << StringPrintf("decoded_length = %d", decoded_length);
-
-    return decoded_length;
-}
 /*******************************************************************************
 **
 ** Function:        notifyRfFieldEvent
@@ -484,6 +405,7 @@ void SecureElement::notifyRfFieldEvent (bool isActive)
 void SecureElement::nfaHciCallback(tNFA_HCI_EVT event,
                                    tNFA_HCI_EVT_DATA* eventData) {
     static const char fn [] = "SecureElement::nfaHciCallback";
+    NFC_TRACE_INSTANT("nfa", "hciCallback", event);
     LOG(INFO) << StringPrintf("%s: event=0x%X", fn, event);
 
     switch (event)
@@ -674,39 +596,22 @@ void SecureElement::nfaHciCallback(tNFA_HCI_EVT event,
             // If we got an AID, notify any listeners
             if ((eventData->rcvd_evt.evt_len > 3) && (eventData->rcvd_evt.p_evt_buf[0] == 0x81) )
             {
-                int aidlen = eventData->rcvd_evt.p_evt_buf[1];
-                uint8_t* data = NULL;
-                int32_t datalen = 0;
-                uint8_t dataStartPosition = 0;
-                if((eventData->rcvd_evt.evt_len > 2+aidlen) && (eventData->rcvd_evt.p_evt_buf[2+aidlen] == 0x82))
-                {
-                    //BERTLV decoding here, to support extended data length for params.
-                    datalen = SecureElement::decodeBerTlvLength((uint8_t *)eventData->rcvd_evt.p_evt_buf, 2+aidlen+1, eventData->rcvd_evt.evt_len);
-                }
-                if(datalen >= 0)
+                // AID, tag 0x81; then parameters, tag 0x82
+                BerTlvReader reader(eventData->rcvd_evt.p_evt_buf, eventData->rcvd_evt.evt_len);
+                BerTlv aid;
+                BerTlv params;
+                if (reader.next(aid))
                 {
-                    /* Over 128 bytes data of transaction can not receive on PN547, Ref. BER-TLV length fields in ISO/IEC 7816 */
-                    if ( datalen < 0x80)
+                    // a malformed parameter TLV drops the parameters, not the AID
+                    if (!reader.next(params) || (params.tag() != 0x82))
                     {
-                        dataStartPosition = 2+aidlen+2;
+                        if (reader.isMalformed())
+                            LOG(ERROR) << StringPrintf("%s: transaction parameters malformed; ignored", fn);
+                        params = BerTlv();
                     }
-                    else if ( datalen < 0x100)
-                    {
-                        dataStartPosition = 2+aidlen+3;
-                    }
-                    else if ( datalen < 0x10000)
-                    {
-                        dataStartPosition = 2+aidlen+4;
-                    }
-                    else if ( datalen < 0x1000000)
-                    {
-                        dataStartPosition = 2+aidlen+5;
-                    }
-                    data  = &eventData->rcvd_evt.p_evt_buf[dataStartPosition];
-
                     if (nfcFL.nfcNxpEse && nfcFL.eseFL._ESE_ETSI_READER_ENABLE)
                     {
-                        if(MposManager::getInstance().validateHCITransactionEventParams(data, datalen) == NFA_STATUS_OK)
+                        if(MposManager::getInstance().validateHCITransactionEventParams(params) == NFA_STATUS_OK)
                             HciEventManager::getInstance().nfaHciCallback(event, eventData);
                     }
                     else
@@ -714,12 +619,14 @@ void SecureElement::nfaHciCallback(tNFA_HCI_EVT event,
                 }
                 else
                 {
-                    LOG(ERROR) << StringPrintf("Event data TLV length encoding Unsupported!");
+                    LOG(ERROR) << StringPrintf("%s: transaction AID TLV malformed", fn);
                 }
             }
         }
         else if(eventData->rcvd_evt.evt_code == NFA_HCI_EVT_INIT_COMPLETED) {
             LOG(INFO) << StringPrintf("%s: NFA_HCI_EVT_INIT_COMPLETED; received", fn);
+            sSecElem.mEeReady = true;
+            sSecElem.notifyEeStatusChanged();
         }
         else if (eventData->rcvd_evt.evt_code == NFA_HCI_EVT_CONNECTIVITY)
         {
@@ -804,7 +711,45 @@ bool SecureElement::transceive(uint8_t* xmitBuffer, int32_t xmitBufferSize,
                                uint8_t* recvBuffer, int32_t recvBufferMaxSize,
                                int32_t& recvBufferActualSize,
                                int32_t timeoutMillisec, tNFA_HANDLE eeHandle) {
+  recvBufferActualSize = 0;
+  return transceive(
+      xmitBuffer, xmitBufferSize, recvBufferMaxSize,
+      [&](const uint8_t* rsp, int32_t rspLen) {
+        memcpy(recvBuffer, rsp, rspLen);
+        recvBufferActualSize = rspLen;
+      },
+      timeoutMillisec, eeHandle);
+}
+
+/*******************************************************************************
+**
+** Function:        transceive
+**
+** Description:     Send data to the secure element; hand its response to
+**                  a handler, straight from the buffer NFA received it in.
+**                  xmitBuffer: Data to transmit.
+**                  xmitBufferSize: Length of data.
+**                  recvBufferMaxSize: Maximum length of response.
+**                  onResponse: Called with the response before returning;
+**                  the response is only valid during the call.
+**                  timeoutMillisec: timeout in millisecond.
+**                  eeHandle: handle to the selected NFCEE.
+**
+** Returns:         True if ok.
+**
+*******************************************************************************/
+bool SecureElement::transceive(uint8_t* xmitBuffer, int32_t xmitBufferSize,
+                               int32_t recvBufferMaxSize,
+                               const ResponseHandler& onResponse,
+                               int32_t timeoutMillisec, tNFA_HANDLE eeHandle) {
   static const char fn[] = "SecureElement::transceive";
+  // mResponseData stays the buffer NFA writes into, even after a timeout, so
+  // a late response cannot land in memory that is gone; the channels of all
+  // secure elements take turns using it
+  ApduScheduler::Turn turn(
+      mApduScheduler, eeHandle,
+      (xmitBufferSize > 0) ? ApduScheduler::getLogicalChannel(xmitBuffer[0])
+                           : 0);
   tNFA_STATUS nfaStat = NFA_STATUS_FAILED;
   bool isSuccess = false;
   mTransceiveWaitOk = false;
@@ -859,14 +804,19 @@ bool SecureElement::transceive(uint8_t* xmitBuffer, int32_t xmitBufferSize,
     if (!mIsWiredModeOpen) {
       return isSuccess;
     }
+    // only the received bytes are ever read; no need to clear the buffer
     mActualResponseSize = 0;
-    memset(mResponseData, 0, sizeof(mResponseData));
+    NFC_TRACE_INSTANT("se", "send", xmitBufferSize);
+    uint64_t sendMicros = NfcStatsUtil::nowMicros();
     nfaStat = NFA_HciSendApdu(mNfaHciHandle, mActiveEeHandle, xmitBufferSize,
                               xmitBuffer, sizeof(mResponseData), mResponseData,
                               timeoutMillisec);
 
     if (nfaStat == NFA_STATUS_OK) {
       mTransceiveEvent.wait();
+      NFC_TRACE_INSTANT("se", "wakeup", mActualResponseSize);
+      NfcStatsUtil::recordLatency(NfcStatsUtil::HIST_SE_TRANSCEIVE_RTT,
+                                  NfcStatsUtil::nowMicros() - sendMicros);
     } else {
       LOG(ERROR) << StringPrintf("%s: fail send data; error=0x%X", fn, nfaStat);
       goto TheEnd;
@@ -908,11 +858,9 @@ bool SecureElement::transceive(uint8_t* xmitBuffer, int32_t xmitBufferSize,
     }
   }
   if (mActualResponseSize > recvBufferMaxSize)
-    recvBufferActualSize = recvBufferMaxSize;
+    onResponse(mResponseData, recvBufferMaxSize);
   else
-    recvBufferActualSize = mActualResponseSize;
-
-  memcpy(recvBuffer, mResponseData, recvBufferActualSize);
+    onResponse(mResponseData, mActualResponseSize);
   isSuccess = true;
 TheEnd:
   return (isSuccess);
@@ -1069,6 +1017,10 @@ tNFA_STATUS SecureElement::SecElem_EeModeSet(uint16_t handle, uint8_t mode)
     tNFA_STATUS stat = NFA_STATUS_FAILED;
     LOG(INFO) << StringPrintf("%s:Enter mode = %d", __func__, mode);
 
+    if (mode == NFA_EE_MD_ACTIVATE) {
+      // wait for a new EVT_INIT_COMPLETED
+      sSecElem.mEeReady = false;
+    }
     SyncEventGuard guard (sSecElem.mEeSetModeEvent);
     stat =  NFA_EeModeSet(handle, mode);
     if(stat == NFA_STATUS_OK)
@@ -1140,8 +1092,25 @@ void SecureElement::notifyModeSet (tNFA_HANDLE eeHandle, bool success, tNFA_EE_S
     }
     else
         LOG(INFO) << StringPrintf("%s: NFA_EE_MODE_SET_EVT; EE: 0x%04x not found.  mActiveEeHandle: 0x%04x", fn, eeHandle, sSecElem.mActiveEeHandle);
-    SyncEventGuard guard (sSecElem.mEeSetModeEvent);
-    sSecElem.mEeSetModeEvent.notifyOne();
+    {
+        SyncEventGuard guard (sSecElem.mEeSetModeEvent);
+        sSecElem.mEeSetModeEvent.notifyOne();
+    }
+    sSecElem.notifyEeStatusChanged();
+}
+/*******************************************************************************
+ **
+ ** Function:       notifyEeStatusChanged
+ **
+ ** Description:    Wake up threads waiting for the status of an EE. Call on
+ **                 every EE notification that may change it.
+ **
+ ** Returns:        None
+ **
+ *******************************************************************************/
+void SecureElement::notifyEeStatusChanged()
+{
+    mEeStatusWaiter.notifyChanged();
 }
 /*******************************************************************************
 **
@@ -1206,7 +1175,7 @@ bool SecureElement::apduGateReset(jint seID, uint8_t* recvBuffer, int32_t *recvB
         LOG(INFO) << StringPrintf("%s MAX_WTX limit reached, eSE power recycle", fn);
         setNfccPwrConfig(NFCC_DECIDES, mActiveEeHandle);
         SecEle_Modeset(NFCEE_DISABLE, mActiveEeHandle);
-        usleep(50 * 1000);
+        waitEeStatus(mActiveEeHandle, NFA_EE_STATUS_INACTIVE, 50);
         setNfccPwrConfig(POWER_ALWAYS_ON|COMM_LINK_ACTIVE, mActiveEeHandle);
         SecEle_Modeset(NFCEE_ENABLE, mActiveEeHandle);
         nfaStat = NFA_STATUS_OK;
@@ -1268,13 +1237,13 @@ bool SecureElement::doNfcee_Session_Reset(tNFA_HANDLE mActiveEeHandle)
       if(SecEle_Modeset(NFCEE_DISABLE, mActiveEeHandle))
       {
         LOG(INFO) << StringPrintf("%s Nfcee session mode set off", fn);
-        usleep(100 * 1000);
+        waitEeStatus(mActiveEeHandle, NFA_EE_STATUS_INACTIVE, 100);
         if(setNfccPwrConfig(POWER_ALWAYS_ON|COMM_LINK_ACTIVE, mActiveEeHandle) == NFA_STATUS_OK)
         {
           LOG(INFO) << StringPrintf("%s Nfcee session PWRLNK 03", fn);
           if(SecEle_Modeset(NFCEE_ENABLE, mActiveEeHandle))
           {
-            usleep(100 * 1000);
+            waitEeReady(mActiveEeHandle, 100);
             LOG(INFO) << StringPrintf("%s Nfcee session mode set on", fn);
             status = NFA_STATUS_OK;
           }
@@ -1341,6 +1310,89 @@ bool SecureElement::SecEle_Modeset(uint8_t type, tNFA_HANDLE seHandle) {
   return retval;
 }
 
+/*******************************************************************************
+**
+** Function:        waitEeReady
+**
+** Description:     Wait for an EE enabled by SecEle_Modeset() to report
+**                  EVT_INIT_COMPLETED. Stop waiting as soon as an EE
+**                  status notification shows it is no longer active.
+**                  eeHandle: Handle of the EE.
+**                  maxWaitMs: Longest time to wait.
+**
+** Returns:         True if the EE is ready.
+**
+*******************************************************************************/
+bool SecureElement::waitEeReady(tNFA_HANDLE eeHandle, uint32_t maxWaitMs) {
+  tNFA_EE_STATUS eeStatus = NFA_EE_STATUS_ACTIVE;
+  uint64_t start = NfcTrace::now();
+
+  mEeStatusWaiter.waitFor(maxWaitMs, [&] {
+    if (mEeReady) return true;
+    eeStatus = queryEeStatus(eeHandle);
+    return eeStatus != NFA_EE_STATUS_ACTIVE;
+  });
+  bool ready = mEeReady;
+  if (!ready && (eeStatus != NFA_EE_STATUS_ACTIVE)) {
+    LOG(ERROR) << StringPrintf("%s: ee=0x%X; status=0x%X", __func__, eeHandle,
+                               eeStatus);
+  }
+  LOG(INFO) << StringPrintf("%s: ee=0x%X; ready=%d; waited=%u ms", __func__,
+                            eeHandle, ready,
+                            (uint32_t)((NfcTrace::now() - start) / 1000000));
+  return ready;
+}
+
+/*******************************************************************************
+**
+** Function:        waitEeStatus
+**
+** Description:     Wait for EE status and mode set notifications until the
+**                  status of an EE is eeStatus.
+**                  eeHandle: Handle of the EE.
+**                  eeStatus: Status to wait for.
+**                  maxWaitMs: Longest time to wait.
+**
+** Returns:         True if the EE reached the status.
+**
+*******************************************************************************/
+bool SecureElement::waitEeStatus(tNFA_HANDLE eeHandle, tNFA_EE_STATUS eeStatus,
+                                 uint32_t maxWaitMs) {
+  tNFA_EE_STATUS status = NFA_EE_STATUS_REMOVED;
+  uint64_t start = NfcTrace::now();
+
+  bool reached = mEeStatusWaiter.waitFor(maxWaitMs, [&] {
+    status = queryEeStatus(eeHandle);
+    return status == eeStatus;
+  });
+  DLOG_IF(INFO, nfc_debug_enabled) << StringPrintf(
+      "%s: ee=0x%X; status=0x%X; waited=%u ms", __func__, eeHandle, status,
+      (uint32_t)((NfcTrace::now() - start) / 1000000));
+  return reached;
+}
+
+/*******************************************************************************
+**
+** Function:        queryEeStatus
+**
+** Description:     Get the status of an EE as last reported by the NFCC.
+**                  eeHandle: Handle of the EE.
+**
+** Returns:         Status of the EE; NFA_EE_STATUS_REMOVED if unknown.
+**
+*******************************************************************************/
+tNFA_EE_STATUS SecureElement::queryEeStatus(tNFA_HANDLE eeHandle) {
+  uint8_t numEe = MAX_NUM_EE;
+  tNFA_EE_INFO eeInfo[MAX_NUM_EE];
+
+  if (NFA_EeGetInfo(&numEe, eeInfo) != NFA_STATUS_OK)
+    return NFA_EE_STATUS_REMOVED;
+  for (uint8_t xx = 0; xx < numEe; xx++) {
+    if (eeInfo[xx].ee_handle == eeHandle) return eeInfo[xx].ee_status;
+  }
+  return NFA_EE_STATUS_REMOVED;
+}
+
 /*******************************************************************************
 **
 ** Function:        initializeEeHandle
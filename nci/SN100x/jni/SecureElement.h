@@ -17,6 +17,10 @@
  ******************************************************************************/
 
 #pragma once
+#include <atomic>
+#include <functional>
+#include "ApduScheduler.h"
+#include "EeStatusWaiter.h"
 #include "NfcJniUtil.h"
 #include "SyncEvent.h"
 #include "config.h"
@@ -151,6 +155,8 @@ void getEeHandleList(tNFA_HANDLE *list, uint8_t* count);
   SyncEvent   mRegistryEvent;
   SyncEvent   mWiredModeHoldEvent;
   SyncEvent   mModeSetNtf;
+  EeStatusWaiter mEeStatusWaiter;  // notified on EE status changes and EVT_INIT_COMPLETED
+  std::atomic<bool> mEeReady;      // whether the eSE reported it is initialized
 
   int     mActualResponseSize;         //number of bytes in the response received from secure element
   int     mAtrInfolen;
@@ -168,6 +174,7 @@ void getEeHandleList(tNFA_HANDLE *list, uint8_t* count);
   uint8_t     mCreatedPipe;
   static uint8_t mStaticPipeProp;
   Mutex mTimeoutHandleMutex; // Used to Sync handleTransceiveTimeout() & releasePendingTransceive()
+  ApduScheduler mApduScheduler; // Keeps mResponseData to one transceive at a time
   Mutex mMutex; // protects fields below
   struct timespec mLastRfFieldToggle; // last time RF field went off
 
@@ -190,20 +197,6 @@ mNfceeData  mNfceeData_t;
 *******************************************************************************/
 SecureElement();
 
-/*******************************************************************************
-**
-** Function:        decodeBerTlvLength
-**
-** Description:     Decodes BER TLV length from the data provided
-**                  data : array of data to be processed
-**                  index : offset from which to consider processing
-**                  data_length : length of data to be processed
-**
-** Returns:         decoded_length
-**
-*******************************************************************************/
-static int decodeBerTlvLength(uint8_t* data, int index, int data_length);
-
 /*******************************************************************************/
 
 bool notifySeInitialized();
@@ -233,6 +226,18 @@ static void nfaHciCallback(tNFA_HCI_EVT event, tNFA_HCI_EVT_DATA* eventData);
 *******************************************************************************/
 void handleTransceiveTimeout(uint8_t powerConfigValue);
 
+/*******************************************************************************
+**
+** Function:        queryEeStatus
+**
+** Description:     Get the status of an EE as last reported by the NFCC.
+**                  eeHandle: Handle of the EE.
+**
+** Returns:         Status of the EE; NFA_EE_STATUS_REMOVED if unknown.
+**
+*******************************************************************************/
+tNFA_EE_STATUS queryEeStatus(tNFA_HANDLE eeHandle);
+
 public:
 #if(NXP_EXTNS == TRUE)
  bool mRfFieldIsOn;            // last known RF field state
@@ -288,6 +293,30 @@ public:
                  uint8_t* recvBuffer, int32_t recvBufferMaxSize,
                  int32_t& recvBufferActualSize, int32_t timeoutMillisec,
                  tNFA_HANDLE eeHandle = EE_HANDLE_0xF3);
+
+ typedef std::function<void(const uint8_t* rsp, int32_t rspLen)>
+     ResponseHandler;
+
+ /*******************************************************************************
+ **
+ ** Function:        transceive
+ **
+ ** Description:     Send data to the secure element; hand its response to
+ **                  a handler, straight from the buffer NFA received it in.
+ **                  xmitBuffer: Data to transmit.
+ **                  xmitBufferSize: Length of data.
+ **                  recvBufferMaxSize: Maximum length of response.
+ **                  onResponse: Called with the response before returning;
+ **                  the response is only valid during the call.
+ **                  timeoutMillisec: timeout in millisecond.
+ **                  eeHandle: handle to the selected NFCEE.
+ **
+ ** Returns:         True if ok.
+ **
+ *******************************************************************************/
+ bool transceive(uint8_t* xmitBuffer, int32_t xmitBufferSize,
+                 int32_t recvBufferMaxSize, const ResponseHandler& onResponse,
+                 int32_t timeoutMillisec, tNFA_HANDLE eeHandle);
  /*******************************************************************************
  **
  ** Function:        activate
@@ -374,6 +403,35 @@ public:
   **
   *******************************************************************************/
  bool SecEle_Modeset(uint8_t type, tNFA_HANDLE seHandle = EE_HANDLE_0xF3);
+ /*******************************************************************************
+  **
+  ** Function:       waitEeReady
+  **
+  ** Description:    Wait for an EE enabled by SecEle_Modeset() to report
+  **                 EVT_INIT_COMPLETED. Stop waiting as soon as an EE
+  **                 status notification shows it is no longer active.
+  **                 eeHandle: Handle of the EE.
+  **                 maxWaitMs: Longest time to wait.
+  **
+  ** Returns:        True if the EE is ready.
+  **
+  *******************************************************************************/
+ bool waitEeReady(tNFA_HANDLE eeHandle, uint32_t maxWaitMs);
+ /*******************************************************************************
+  **
+  ** Function:       waitEeStatus
+  **
+  ** Description:    Wait for EE status and mode set notifications until
+  **                 the status of an EE is eeStatus.
+  **                 eeHandle: Handle of the EE.
+  **                 eeStatus: Status to wait for.
+  **                 maxWaitMs: Longest time to wait.
+  **
+  ** Returns:        True if the EE reached the status.
+  **
+  *******************************************************************************/
+ bool waitEeStatus(tNFA_HANDLE eeHandle, tNFA_EE_STATUS eeStatus,
+                   uint32_t maxWaitMs);
  /*******************************************************************************
   **
   ** Function:        notifyRfFieldEvent
@@ -492,6 +550,17 @@ public:
   *******************************************************************************/
  void notifyModeSet(tNFA_HANDLE eeHandle, bool success,
                     tNFA_EE_STATUS eeStatus);
+ /*******************************************************************************
+  **
+  ** Function:       notifyEeStatusChanged
+  **
+  ** Description:    Wake up threads waiting for the status of an EE. Call on
+  **                 every EE notification that may change it.
+  **
+  ** Returns:        None
+  **
+  *******************************************************************************/
+ void notifyEeStatusChanged();
  /*******************************************************************************
  **
  ** Function:        getGateAndPipeList
@@ -0,0 +1,148 @@
+/******************************************************************************
+ *
+ *  Copyright 2024 NXP
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/*
+ *  Run the stages of the NFC enable sequence as a dependency graph.
+ */
+#include "StartupGraph.h"
+
+#include <stdio.h>
+#include <string>
+#include <thread>
+
+#include <android-base/stringprintf.h>
+#include <base/logging.h>
+
+#include "NfcTrace.h"
+
+using android::base::StringPrintf;
+
+extern bool nfc_debug_enabled;
+
+namespace {
+Mutex sTimingMutex;
+std::string sTiming;  // stage timing of the last run
+}  // namespace
+
+/*******************************************************************************
+**
+** Function:        addStage
+**
+** Description:     Add a stage to the graph.
+**                  name: Stage name; must be a string literal.
+**                  after: Stages that must be done before this one starts.
+**                  stage: Function to run.
+**
+** Returns:         Id of the stage, to be used in "after" of later stages.
+**
+*******************************************************************************/
+int StartupGraph::addStage(const char* name, const std::vector<int>& after,
+                           Stage stage) {
+  mNodes.push_back(Node{name, after, stage, false, false, 0, 0});
+  return mNodes.size() - 1;
+}
+
+/*******************************************************************************
+**
+** Function:        run
+**
+** Description:     Run all stages, using the calling thread and up to
+**                  MAX_WORKERS - 1 other threads.
+**
+** Returns:         None
+**
+*******************************************************************************/
+void StartupGraph::run() {
+  std::vector<std::thread> workers;
+  uint64_t startNs = NfcTrace::now();
+
+  mStarted = 0;
+  for (size_t i = 1; (i < (size_t)MAX_WORKERS) && (i < mNodes.size()); i++)
+    workers.push_back(std::thread(&StartupGraph::work, this));
+  work();
+  for (std::thread& worker : workers) worker.join();
+  saveTiming(startNs, NfcTrace::now());
+}
+
+void StartupGraph::work() {
+  while (true) {
+    int id;
+    {
+      AutoMutex lock(mMutex);
+      while (((id = takeReadyStage()) < 0) && (mStarted < mNodes.size()))
+        mCondVar.wait(mMutex);
+      if (id < 0) return;
+    }
+
+    Node& node = mNodes[id];
+    node.startNs = NfcTrace::now();
+    node.stage();
+    node.endNs = NfcTrace::now();
+#ifndef NFC_TRACE_DISABLED
+    NfcTrace::record('X', "init", node.name, node.startNs,
+                     node.endNs - node.startNs, 0);
+#endif
+
+    AutoMutex lock(mMutex);
+    node.done = true;
+    mCondVar.notifyAll();
+  }
+}
+
+// caller must hold mMutex
+int StartupGraph::takeReadyStage() {
+  for (size_t i = 0; i < mNodes.size(); i++) {
+    Node& node = mNodes[i];
+    if (node.started) continue;
+    bool ready = true;
+    for (int after : node.after) ready = ready && mNodes[after].done;
+    if (!ready) continue;
+    node.started = true;
+    mStarted++;
+    return i;
+  }
+  return -1;
+}
+
+void StartupGraph::saveTiming(uint64_t startNs, uint64_t endNs) {
+  std::string timing = StringPrintf("NFC enable stages (total %.1f ms):\n",
+                                    (endNs - startNs) / 1e6);
+  for (Node& node : mNodes) {
+    timing += StringPrintf("  %-16s start=%7.1f ms; took=%7.1f ms\n",
+                           node.name, (node.startNs - startNs) / 1e6,
+                           (node.endNs - node.startNs) / 1e6);
+  }
+  DLOG_IF(INFO, nfc_debug_enabled) << timing;
+  AutoMutex lock(sTimingMutex);
+  sTiming.swap(timing);
+}
+
+/*******************************************************************************
+**
+** Function:        dump
+**
+** Description:     Write the stage timing of the last run.
+**                  fd: File descriptor to write to.
+**
+** Returns:         None
+**
+*******************************************************************************/
+void StartupGraph::dump(int fd) {
+  AutoMutex lock(sTimingMutex);
+  if (!sTiming.empty()) dprintf(fd, "%s", sTiming.c_str());
+}
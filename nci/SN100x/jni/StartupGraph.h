@@ -0,0 +1,95 @@
+/******************************************************************************
+ *
+ *  Copyright 2024 NXP
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/*
+ *  Run the stages of the NFC enable sequence as a dependency graph. A stage
+ *  starts as soon as the stages it depends on are done, so that stages
+ *  blocked on different NFA events wait in parallel. The timing of every
+ *  stage of the last run is kept for dumpsys and recorded in NfcTrace.
+ */
+#pragma once
+#include <stdint.h>
+#include <functional>
+#include <vector>
+#include "CondVar.h"
+#include "Mutex.h"
+
+class StartupGraph {
+ public:
+  typedef std::function<void()> Stage;
+
+  /*******************************************************************************
+  **
+  ** Function:        addStage
+  **
+  ** Description:     Add a stage to the graph.
+  **                  name: Stage name; must be a string literal.
+  **                  after: Stages that must be done before this one starts.
+  **                  stage: Function to run.
+  **
+  ** Returns:         Id of the stage, to be used in "after" of later stages.
+  **
+  *******************************************************************************/
+  int addStage(const char* name, const std::vector<int>& after, Stage stage);
+
+  /*******************************************************************************
+  **
+  ** Function:        run
+  **
+  ** Description:     Run all stages, using the calling thread and up to
+  **                  MAX_WORKERS - 1 other threads.
+  **
+  ** Returns:         None
+  **
+  *******************************************************************************/
+  void run();
+
+  /*******************************************************************************
+  **
+  ** Function:        dump
+  **
+  ** Description:     Write the stage timing of the last run.
+  **                  fd: File descriptor to write to.
+  **
+  ** Returns:         None
+  **
+  *******************************************************************************/
+  static void dump(int fd);
+
+ private:
+  static const int MAX_WORKERS = 4;
+
+  struct Node {
+    const char* name;
+    std::vector<int> after;
+    Stage stage;
+    bool started;
+    bool done;
+    uint64_t startNs;
+    uint64_t endNs;
+  };
+
+  void work();
+  int takeReadyStage();
+  void saveTiming(uint64_t startNs, uint64_t endNs);
+
+  Mutex mMutex;  // guards the members below
+  CondVar mCondVar;
+  std::vector<Node> mNodes;
+  size_t mStarted;
+};
@@ -0,0 +1,49 @@
+#include <benchmark/benchmark.h>
+
+#include <unistd.h>
+#include "StartupGraph.h"
+
+namespace {
+// the shape of the enable sequence: configuration, then independent
+// waits on the controller and on the NFCEEs, then a final stage
+void addEnableStages(StartupGraph& graph, useconds_t waitUs) {
+  auto wait = [waitUs] {
+    if (waitUs > 0) usleep(waitUs);
+  };
+  int config = graph.addStage("config", {}, wait);
+  int rf = graph.addStage("rf", {config}, wait);
+  int ee = graph.addStage("ee", {config}, wait);
+  int hci = graph.addStage("hci", {config}, wait);
+  int routing = graph.addStage("routing", {ee, hci}, wait);
+  graph.addStage("discovery", {rf, routing}, wait);
+}
+
+// cost of scheduling the stages, with nothing to overlap
+void BM_StartupGraphOverhead(benchmark::State& state) {
+  for (auto _ : state) {
+    StartupGraph graph;
+    addEnableStages(graph, 0);
+    graph.run();
+  }
+}
+BENCHMARK(BM_StartupGraphOverhead)->UseRealTime();
+
+// stages blocked on 1 ms host-side waits, run as a graph and in sequence
+void BM_StartupGraphWaits(benchmark::State& state) {
+  for (auto _ : state) {
+    StartupGraph graph;
+    addEnableStages(graph, 1000);
+    graph.run();
+  }
+}
+BENCHMARK(BM_StartupGraphWaits)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+void BM_StartupSerialWaits(benchmark::State& state) {
+  for (auto _ : state) {
+    for (int i = 0; i < 6; i++) usleep(1000);
+  }
+}
+BENCHMARK(BM_StartupSerialWaits)->UseRealTime()->Unit(benchmark::kMillisecond);
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,44 @@
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+#include <atomic>
+#include "StartupGraph.h"
+
+TEST(StartupGraphTest, StageStartsAfterItsDependencies) {
+  StartupGraph graph;
+  std::atomic<int> order(0);
+  int first = -1, second = -1, third = -1;
+
+  int a = graph.addStage("a", {}, [&] {
+    usleep(20000);
+    first = order++;
+  });
+  int b = graph.addStage("b", {a}, [&] { second = order++; });
+  graph.addStage("c", {a, b}, [&] { third = order++; });
+  graph.run();
+
+  EXPECT_EQ(0, first);
+  EXPECT_EQ(1, second);
+  EXPECT_EQ(2, third);
+}
+
+TEST(StartupGraphTest, IndependentStagesOverlap) {
+  StartupGraph graph;
+  std::atomic<int> running(0);
+  std::atomic<int> maxRunning(0);
+  auto stage = [&] {
+    int now = ++running;
+    int max = maxRunning;
+    while ((now > max) && !maxRunning.compare_exchange_weak(max, now)) {
+    }
+    usleep(50000);
+    running--;
+  };
+
+  graph.addStage("x", {}, stage);
+  graph.addStage("y", {}, stage);
+  graph.addStage("z", {}, stage);
+  graph.run();
+
+  EXPECT_EQ(3, maxRunning);
+}
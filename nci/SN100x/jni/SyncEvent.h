@@ -16,13 +16,35 @@
 
 /*
  *  Synchronize two or more threads using a condition variable and a mutex.
+ *  Each waiter takes a ticket, in order, when it starts waiting; each
+ *  notifyOne() releases the oldest ticket still waiting. Tickets are
+ *  counters: those below mReleased are released, so waiting allocates
+ *  nothing unless a waiter times out behind another. A thread that
+ *  starts waiting after a notification cannot take the wake-up from the
+ *  thread it was meant for, and spurious wake-ups of the condition
+ *  variable are not reported as events.
  */
 #pragma once
+#include <stdint.h>
+#include <time.h>
+#include <algorithm>
+#include <vector>
 #include "CondVar.h"
 #include "Mutex.h"
 
 class SyncEvent {
  public:
+  /*******************************************************************************
+  **
+  ** Function:        SyncEvent
+  **
+  ** Description:     Initialize member variables.
+  **
+  ** Returns:         None.
+  **
+  *******************************************************************************/
+  SyncEvent() : mNextTicket(0), mReleased(0) {}
+
   /*******************************************************************************
   **
   ** Function:        ~SyncEvent
@@ -54,7 +76,7 @@ class SyncEvent {
   ** Returns:         None.
   **
   *******************************************************************************/
-  void wait() { mCondVar.wait(mMutex); }
+  void wait() { waitForWakeup(NULL); }
 
   /*******************************************************************************
   **
@@ -67,8 +89,32 @@ class SyncEvent {
   **
   *******************************************************************************/
   bool wait(long millisec) {
-    bool retVal = mCondVar.wait(mMutex, millisec);
-    return retVal;
+    struct timespec deadline;
+    CondVar::getDeadline(millisec, deadline);
+    return waitForWakeup(&deadline);
+  }
+
+  /*******************************************************************************
+  **
+  ** Function:        wait
+  **
+  ** Description:     Block the thread until a condition holds. The condition
+  **                  is evaluated with the event started, before waiting and
+  **                  after every notification.
+  **                  millisec: Timeout in milliseconds, for the whole wait.
+  **                  pred: Condition to wait for.
+  **
+  ** Returns:         Value of the condition when the wait ends.
+  **
+  *******************************************************************************/
+  template <typename Predicate>
+  bool wait(long millisec, Predicate pred) {
+    struct timespec deadline;
+    CondVar::getDeadline(millisec, deadline);
+    while (!pred()) {
+      if (!waitForWakeup(&deadline)) return pred();
+    }
+    return true;
   }
 
   /*******************************************************************************
@@ -81,7 +127,22 @@ class SyncEvent {
   ** Returns:         None.
   **
   *******************************************************************************/
-  void notifyOne() { mCondVar.notifyOne(); }
+  void notifyOne() {
+    while (!mAbandoned.empty() && (mAbandoned.front() == mReleased)) {
+      mAbandoned.erase(mAbandoned.begin());
+      mReleased++;
+    }
+    if (mReleased == mNextTicket) return;
+    bool single = (mNextTicket - mReleased - mAbandoned.size()) == 1;
+    mReleased++;
+    // with more waiters, the released one is not known to the condition
+    // variable
+    if (single) {
+      mCondVar.notifyOne();
+    } else {
+      mCondVar.notifyAll();
+    }
+  }
 
   /*******************************************************************************
   **
@@ -95,8 +156,64 @@ class SyncEvent {
   void end() { mMutex.unlock(); }
 
  private:
+  /*******************************************************************************
+  **
+  ** Function:        waitForWakeup
+  **
+  ** Description:     Wait until notifyOne() releases the ticket this thread
+  **                  takes on entry.
+  **                  deadline: Absolute time to give up; NULL for no limit.
+  **
+  ** Returns:         True if woken up; false if timeout occurs.
+  **
+  *******************************************************************************/
+  bool waitForWakeup(const struct timespec* deadline) {
+    uint64_t ticket = mNextTicket++;
+    while (ticket >= mReleased) {
+      if (deadline == NULL) {
+        mCondVar.wait(mMutex);
+      } else if (!mCondVar.waitUntil(mMutex, *deadline)) {
+        // released just as the wait timed out: still a wake-up
+        if (ticket < mReleased) break;
+        abandon(ticket);
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /*******************************************************************************
+  **
+  ** Function:        abandon
+  **
+  ** Description:     Give back the ticket of a waiter that timed out, so
+  **                  that notifyOne() does not release it.
+  **                  ticket: Ticket not released yet.
+  **
+  ** Returns:         None.
+  **
+  *******************************************************************************/
+  void abandon(uint64_t ticket) {
+    if (ticket + 1 == mNextTicket) {
+      // the newest ticket: take it back, and any abandoned before it
+      mNextTicket--;
+      while (!mAbandoned.empty() && (mAbandoned.back() + 1 == mNextTicket)) {
+        mAbandoned.pop_back();
+        mNextTicket--;
+      }
+      return;
+    }
+    mAbandoned.insert(
+        std::lower_bound(mAbandoned.begin(), mAbandoned.end(), ticket),
+        ticket);
+  }
+
   CondVar mCondVar;
   Mutex mMutex;
+  uint64_t mNextTicket;  // ticket of the next waiter
+  uint64_t mReleased;    // tickets below this are released
+  // tickets of waiters that timed out behind another waiter, in order
+  std::vector<uint64_t> mAbandoned;
 };
 
 /*****************************************************************************/
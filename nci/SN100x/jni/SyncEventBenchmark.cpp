@@ -0,0 +1,91 @@
+#include <benchmark/benchmark.h>
+
+#include <unistd.h>
+#include <thread>
+#include <vector>
+#include "SyncEvent.h"
+
+namespace {
+// wake-up round trip between two threads, as between a JNI call waiting
+// for its NFA event and the NFA callback thread; one waiter per event, so
+// every notification signals rather than broadcasts
+void BM_SyncEventPingPong(benchmark::State& state) {
+  SyncEvent ping;
+  SyncEvent pong;
+  bool pinged = false;
+  bool ponged = false;
+  bool stop = false;
+
+  std::thread echo([&] {
+    for (;;) {
+      {
+        SyncEventGuard guard(ping);
+        while (!pinged && !stop) ping.wait();
+        if (stop) return;
+        pinged = false;
+      }
+      SyncEventGuard guard(pong);
+      ponged = true;
+      pong.notifyOne();
+    }
+  });
+  for (auto _ : state) {
+    {
+      SyncEventGuard guard(ping);
+      pinged = true;
+      ping.notifyOne();
+    }
+    SyncEventGuard guard(pong);
+    while (!ponged) pong.wait();
+    ponged = false;
+  }
+  {
+    SyncEventGuard guard(ping);
+    stop = true;
+    ping.notifyOne();
+  }
+  echo.join();
+}
+BENCHMARK(BM_SyncEventPingPong)->UseRealTime();
+
+// a notified wait with range(0) waiters queued on the event: the released
+// waiter is woken by a broadcast when others wait
+void BM_SyncEventWakeInQueue(benchmark::State& state) {
+  SyncEvent event;
+  const int waiters = state.range(0);
+  int alive = waiters;
+  int woken = 0;
+  bool stop = false;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < waiters; i++) {
+    threads.emplace_back([&] {
+      SyncEventGuard guard(event);
+      while (!stop) {
+        if (event.wait(1000)) woken++;
+      }
+      alive--;
+    });
+  }
+  usleep(20000);  // let every waiter queue
+  for (auto _ : state) {
+    SyncEventGuard guard(event);
+    int target = woken + 1;
+    event.notifyOne();
+    while (woken < target) {
+      event.end();
+      std::this_thread::yield();
+      event.start();
+    }
+  }
+  for (;;) {
+    SyncEventGuard guard(event);
+    stop = true;
+    if (alive == 0) break;
+    event.notifyOne();
+  }
+  for (std::thread& t : threads) t.join();
+}
+BENCHMARK(BM_SyncEventWakeInQueue)->Arg(1)->Arg(2)->Arg(8)->UseRealTime();
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,92 @@
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+#include <thread>
+#include "SyncEvent.h"
+
+TEST(SyncEventTest, LateWaiterDoesNotTakeWakeup) {
+  SyncEvent event;
+  bool firstWoken = false;
+  bool lateWoken = true;
+
+  std::thread first([&] {
+    SyncEventGuard g(event);
+    firstWoken = event.wait(1000);
+  });
+  usleep(20000);  // let the first thread wait
+  std::thread late;
+  {
+    SyncEventGuard g(event);
+    event.notifyOne();
+    // competes with the first thread for the mutex once it is released
+    late = std::thread([&] {
+      SyncEventGuard g(event);
+      lateWoken = event.wait(50);
+    });
+  }
+  first.join();
+  late.join();
+
+  EXPECT_TRUE(firstWoken);
+  EXPECT_FALSE(lateWoken);
+}
+
+TEST(SyncEventTest, NotifyWithoutWaiterIsDropped) {
+  SyncEvent event;
+  SyncEventGuard g(event);
+  event.notifyOne();
+  EXPECT_FALSE(event.wait(10));
+}
+
+TEST(SyncEventTest, PredicateWaitEndsWhenConditionHolds) {
+  SyncEvent event;
+  int count = 0;
+
+  std::thread notifier([&] {
+    for (int i = 0; i < 3; i++) {
+      usleep(5000);
+      SyncEventGuard g(event);
+      count++;
+      event.notifyOne();
+    }
+  });
+  {
+    SyncEventGuard g(event);
+    EXPECT_TRUE(event.wait(1000, [&] { return count == 3; }));
+  }
+  notifier.join();
+}
+
+TEST(SyncEventTest, TimedOutWaiterDoesNotTakeWakeup) {
+  SyncEvent event;
+  bool shortWoken = true;
+  bool longWoken = false;
+  bool newestWoken = false;
+
+  std::thread longWaiter([&] {
+    SyncEventGuard g(event);
+    longWoken = event.wait(1000);
+  });
+  usleep(20000);  // let the long waiter take the first ticket
+  std::thread shortWaiter([&] {
+    SyncEventGuard g(event);
+    shortWoken = event.wait(10);
+  });
+  std::thread newest([&] {
+    usleep(5000);  // takes a ticket behind the short waiter
+    SyncEventGuard g(event);
+    newestWoken = event.wait(1000);
+  });
+  shortWaiter.join();
+  {
+    SyncEventGuard g(event);
+    event.notifyOne();  // releases the long waiter
+    event.notifyOne();  // skips the short waiter's ticket to the newest
+  }
+  longWaiter.join();
+  newest.join();
+
+  EXPECT_FALSE(shortWoken);
+  EXPECT_TRUE(longWoken);
+  EXPECT_TRUE(newestWoken);
+}
@@ -0,0 +1,180 @@
+/******************************************************************************
+ *
+ *  Copyright 2024 NXP
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+
+/*
+ *  Cache the content of T4T NFCEE files.
+ */
+#include "T4tContentCache.h"
+
+#include <algorithm>
+
+/*******************************************************************************
+**
+** Function:        get
+**
+** Description:     Get the content of a file.
+**                  fileId: File ID.
+**                  content: Receives the content.
+**
+** Returns:         True if the file is cached.
+**
+*******************************************************************************/
+bool T4tContentCache::get(uint16_t fileId, std::vector<uint8_t>& content) {
+  AutoMutex lock(mMutex);
+  auto it = mEntries.find(fileId);
+  if (it == mEntries.end()) return false;
+  content = it->second.content;
+  return true;
+}
+
+/*******************************************************************************
+**
+** Function:        put
+**
+** Description:     Set the content of a file.
+**                  fileId: File ID.
+**                  content: Content.
+**                  dirty: Whether the content is still to be written.
+**
+** Returns:         None
+**
+*******************************************************************************/
+void T4tContentCache::put(uint16_t fileId, const std::vector<uint8_t>& content,
+                          bool dirty) {
+  AutoMutex lock(mMutex);
+  Entry& entry = mEntries[fileId];
+  entry.content = content;
+  entry.dirty = dirty;
+  if (!dirty) {
+    entry.base = content;
+    entry.stale = false;
+  }
+}
+
+/*******************************************************************************
+**
+** Function:        patch
+**
+** Description:     Update part of a cached file, growing it if needed, and
+**                  mark it dirty.
+**                  fileId: File ID.
+**                  offset: Offset of the data; at most the file size.
+**                  data: Data.
+**                  len: Length of the data.
+**
+** Returns:         False if the file is not cached or offset is beyond
+**                  its end.
+**
+*******************************************************************************/
+bool T4tContentCache::patch(uint16_t fileId, size_t offset,
+                            const uint8_t* data, size_t len) {
+  AutoMutex lock(mMutex);
+  auto it = mEntries.find(fileId);
+  if (it == mEntries.end()) return false;
+  std::vector<uint8_t>& content = it->second.content;
+  if (offset > content.size()) return false;
+  if (offset + len > content.size()) content.resize(offset + len);
+  std::copy(data, data + len, content.begin() + offset);
+  it->second.dirty = true;
+  return true;
+}
+
+/*******************************************************************************
+**
+** Function:        takeDirty
+**
+** Description:     Get a dirty file and mark it clean, before writing it.
+**                  update: Receives the file.
+**
+** Returns:         False if no file is dirty.
+**
+*******************************************************************************/
+bool T4tContentCache::takeDirty(Update& update) {
+  AutoMutex lock(mMutex);
+  for (auto& it : mEntries) {
+    Entry& entry = it.second;
+    if (!entry.dirty) continue;
+    update.fileId = it.first;
+    update.content = entry.content;
+    update.base = entry.base;
+    update.stale = entry.stale;
+    // the content is assumed written from now on
+    entry.dirty = false;
+    entry.base = entry.content;
+    entry.stale = false;
+    return true;
+  }
+  return false;
+}
+
+/*******************************************************************************
+**
+** Function:        hasDirty
+**
+** Description:     Check whether a file is still to be written.
+**
+** Returns:         True if a file is dirty.
+**
+*******************************************************************************/
+bool T4tContentCache::hasDirty() {
+  AutoMutex lock(mMutex);
+  for (auto& it : mEntries) {
+    if (it.second.dirty) return true;
+  }
+  return false;
+}
+
+/*******************************************************************************
+**
+** Function:        invalidate
+**
+** Description:     Forget a file, including an update not written yet.
+**                  fileId: File ID.
+**
+** Returns:         None
+**
+*******************************************************************************/
+void T4tContentCache::invalidate(uint16_t fileId) {
+  AutoMutex lock(mMutex);
+  mEntries.erase(fileId);
+}
+
+/*******************************************************************************
+**
+** Function:        invalidateClean
+**
+** Description:     Forget the files that may differ from the NFCEE; the
+**                  dirty ones are kept, as they are still to be written,
+**                  and marked stale.
+**
+** Returns:         None
+**
+*******************************************************************************/
+void T4tContentCache::invalidateClean() {
+  AutoMutex lock(mMutex);
+  auto it = mEntries.begin();
+  while (it != mEntries.end()) {
+    if (it->second.dirty) {
+      it->second.stale = true;
+      ++it;
+    } else {
+      it = mEntries.erase(it);
+    }
+  }
+}
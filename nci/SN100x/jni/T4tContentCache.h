@@ -0,0 +1,149 @@
+/******************************************************************************
+ *
+ *  Copyright 2024 NXP
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+
+/*
+ *  Cache the content of T4T NFCEE files, keyed by file ID, so that reading
+ *  a file again does not cost a connection and a full NFCEE read. An entry
+ *  may be dirty: updated here and not written to the NFCEE yet, so that a
+ *  series of small updates costs one NFCEE write. A dirty entry keeps the
+ *  content it was based on, so that a write by a reader in between can be
+ *  detected before the update is written.
+ */
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <map>
+#include <vector>
+#include "Mutex.h"
+
+class T4tContentCache {
+ public:
+  // a dirty file, taken for writing
+  struct Update {
+    uint16_t fileId;
+    std::vector<uint8_t> content;
+    // the NFCEE content the update was made on
+    std::vector<uint8_t> base;
+    // whether the NFCEE may not hold base anymore
+    bool stale;
+  };
+
+  /*******************************************************************************
+  **
+  ** Function:        get
+  **
+  ** Description:     Get the content of a file.
+  **                  fileId: File ID.
+  **                  content: Receives the content.
+  **
+  ** Returns:         True if the file is cached.
+  **
+  *******************************************************************************/
+  bool get(uint16_t fileId, std::vector<uint8_t>& content);
+
+  /*******************************************************************************
+  **
+  ** Function:        put
+  **
+  ** Description:     Set the content of a file.
+  **                  fileId: File ID.
+  **                  content: Content.
+  **                  dirty: Whether the content is still to be written.
+  **
+  ** Returns:         None
+  **
+  *******************************************************************************/
+  void put(uint16_t fileId, const std::vector<uint8_t>& content, bool dirty);
+
+  /*******************************************************************************
+  **
+  ** Function:        patch
+  **
+  ** Description:     Update part of a cached file, growing it if needed, and
+  **                  mark it dirty.
+  **                  fileId: File ID.
+  **                  offset: Offset of the data; at most the file size.
+  **                  data: Data.
+  **                  len: Length of the data.
+  **
+  ** Returns:         False if the file is not cached or offset is beyond
+  **                  its end.
+  **
+  *******************************************************************************/
+  bool patch(uint16_t fileId, size_t offset, const uint8_t* data, size_t len);
+
+  /*******************************************************************************
+  **
+  ** Function:        takeDirty
+  **
+  ** Description:     Get a dirty file and mark it clean, before writing it.
+  **                  update: Receives the file.
+  **
+  ** Returns:         False if no file is dirty.
+  **
+  *******************************************************************************/
+  bool takeDirty(Update& update);
+
+  /*******************************************************************************
+  **
+  ** Function:        hasDirty
+  **
+  ** Description:     Check whether a file is still to be written.
+  **
+  ** Returns:         True if a file is dirty.
+  **
+  *******************************************************************************/
+  bool hasDirty();
+
+  /*******************************************************************************
+  **
+  ** Function:        invalidate
+  **
+  ** Description:     Forget a file, including an update not written yet.
+  **                  fileId: File ID.
+  **
+  ** Returns:         None
+  **
+  *******************************************************************************/
+  void invalidate(uint16_t fileId);
+
+  /*******************************************************************************
+  **
+  ** Function:        invalidateClean
+  **
+  ** Description:     Forget the files that may differ from the NFCEE; the
+  **                  dirty ones are kept, as they are still to be written,
+  **                  and marked stale.
+  **
+  ** Returns:         None
+  **
+  *******************************************************************************/
+  void invalidateClean();
+
+ private:
+  struct Entry {
+    std::vector<uint8_t> content;
+    std::vector<uint8_t> base;
+    bool dirty;
+    bool stale;
+  };
+
+  Mutex mMutex;  // guards mEntries
+  std::map<uint16_t, Entry> mEntries;
+};
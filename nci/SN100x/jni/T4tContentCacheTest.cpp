@@ -0,0 +1,69 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+#include "T4tContentCache.h"
+
+TEST(T4tContentCacheTest, PatchesCoalesceIntoOneDirtyFile) {
+  T4tContentCache cache;
+  std::vector<uint8_t> content;
+  const uint8_t first[] = {0x11};
+  EXPECT_FALSE(cache.patch(0xE104, 0, first, sizeof(first)));
+
+  cache.put(0xE104, {0x00, 0x01, 0x02}, false);
+  const uint8_t second[] = {0x22, 0x33};
+  ASSERT_TRUE(cache.patch(0xE104, 0, first, sizeof(first)));
+  ASSERT_TRUE(cache.patch(0xE104, 2, second, sizeof(second)));
+  const uint8_t beyond[] = {0x44};
+  EXPECT_FALSE(cache.patch(0xE104, 5, beyond, sizeof(beyond)));
+
+  EXPECT_TRUE(cache.hasDirty());
+  T4tContentCache::Update update;
+  ASSERT_TRUE(cache.takeDirty(update));
+  EXPECT_EQ(0xE104, update.fileId);
+  EXPECT_EQ(std::vector<uint8_t>({0x11, 0x01, 0x22, 0x33}), update.content);
+  EXPECT_EQ(std::vector<uint8_t>({0x00, 0x01, 0x02}), update.base);
+  EXPECT_FALSE(update.stale);
+  // written once for both updates
+  EXPECT_FALSE(cache.takeDirty(update));
+  EXPECT_FALSE(cache.hasDirty());
+}
+
+TEST(T4tContentCacheTest, InvalidateCleanKeepsPendingUpdates) {
+  T4tContentCache cache;
+  std::vector<uint8_t> content;
+  const uint8_t data[] = {0x55};
+  cache.put(0xE104, {0x00}, false);
+  cache.put(0xE105, {0x00}, false);
+  ASSERT_TRUE(cache.patch(0xE105, 0, data, sizeof(data)));
+
+  cache.invalidateClean();
+  EXPECT_FALSE(cache.get(0xE104, content));
+  ASSERT_TRUE(cache.get(0xE105, content));
+  EXPECT_EQ(std::vector<uint8_t>({0x55}), content);
+
+  cache.invalidate(0xE105);
+  EXPECT_FALSE(cache.get(0xE105, content));
+}
+
+TEST(T4tContentCacheTest, InvalidateCleanMarksPendingUpdatesStale) {
+  T4tContentCache cache;
+  T4tContentCache::Update update;
+  const uint8_t first[] = {0x11};
+  const uint8_t second[] = {0x22};
+  cache.put(0xE104, {0x00, 0x01}, false);
+  ASSERT_TRUE(cache.patch(0xE104, 0, first, sizeof(first)));
+
+  cache.invalidateClean();
+  ASSERT_TRUE(cache.patch(0xE104, 1, second, sizeof(second)));
+  ASSERT_TRUE(cache.takeDirty(update));
+  EXPECT_TRUE(update.stale);
+  // checked against what the NFCEE held before the first update
+  EXPECT_EQ(std::vector<uint8_t>({0x00, 0x01}), update.base);
+  EXPECT_EQ(std::vector<uint8_t>({0x11, 0x22}), update.content);
+
+  // the next update is based on the content written
+  ASSERT_TRUE(cache.patch(0xE104, 0, second, sizeof(second)));
+  ASSERT_TRUE(cache.takeDirty(update));
+  EXPECT_FALSE(update.stale);
+  EXPECT_EQ(std::vector<uint8_t>({0x11, 0x22}), update.base);
+}
@@ -0,0 +1,396 @@
+/******************************************************************************
+ *
+ *  Copyright 2024 NXP
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/*
+ *  Per-target transaction state of an activated tag.
+ */
+#include "TagSession.h"
+
+#include <android-base/stringprintf.h>
+#include <base/logging.h>
+#include <string.h>
+#include "NfcTrace.h"
+
+using android::base::StringPrintf;
+
+extern bool nfc_debug_enabled;
+
+const int TagSession::IDLE_DISC_ID;
+Mutex TagSession::sSessionsMutex;
+std::map<int, std::shared_ptr<TagSession>> TagSession::sSessions;
+std::shared_ptr<TagSession> TagSession::sCurrent;
+
+/*******************************************************************************
+**
+** Function:        TagSession
+**
+** Description:     Initialize member variables.
+**                  discId: RF discovery ID of the target.
+**
+** Returns:         None
+**
+*******************************************************************************/
+TagSession::TagSession(int discId)
+    : mDiscId(discId),
+      mRxDataStatus(NFA_STATUS_OK),
+      mWaitingForTransceive(false),
+      mTransceiveRfTimeout(false),
+      mResponseDone(false),
+      mRxDirectBuffer(NULL),
+      mRxDirectCapacity(0),
+      mRxDirectLength(0),
+      mRxDirectOverflow(false),
+      mRxStreaming(false),
+      mRxStreamDone(false),
+      mRxStreamOverflow(false),
+      mIsoDepPresCheckCnt(0),
+      mIsoDepPresCheckAlternate(false),
+      mPresCheckErrCnt(0),
+      mPresCheckFingerprint(0),
+      mActivatedMicros(0) {}
+
+/*******************************************************************************
+**
+** Function:        prepareTransceive
+**
+** Description:     Reset the receive state before a frame is sent.
+**                  Caller must hold mTransceiveEvent.
+**
+** Returns:         None
+**
+*******************************************************************************/
+void TagSession::prepareTransceive() {
+  mTransceiveRfTimeout = false;
+  mWaitingForTransceive = true;
+  mResponseDone = false;
+  mRxDataStatus = NFA_STATUS_OK;
+  mRxDataBuffer.clear();
+  mRxDirectLength = 0;
+  mRxDirectOverflow = false;
+}
+
+/*******************************************************************************
+**
+** Function:        endTransceive
+**
+** Description:     Drop data events until the next prepareTransceive().
+**
+** Returns:         None
+**
+*******************************************************************************/
+void TagSession::endTransceive() {
+  SyncEventGuard g(mTransceiveEvent);
+  mWaitingForTransceive = false;
+}
+
+/*******************************************************************************
+**
+** Function:        startStreaming
+**
+** Description:     Pass the fragments of the next response through
+**                  mRxStreamQueue, allocating it on first use. Call after
+**                  prepareTransceive(); caller must hold mTransceiveEvent.
+**
+** Returns:         None
+**
+*******************************************************************************/
+void TagSession::startStreaming() {
+  if (!mRxStreamQueue) mRxStreamQueue.reset(new DataRing(RX_STREAM_RING_SIZE));
+  uint8_t stale[256];
+  uint16_t len = 0;
+  while (mRxStreamQueue->dequeue(stale, sizeof(stale), len)) {
+    // fragments that arrived after the previous stream stopped
+  }
+  mRxStreamQueue->open();
+  mRxStreamDone = false;
+  mRxStreamOverflow = false;
+  mRxStreaming = true;
+}
+
+/*******************************************************************************
+**
+** Function:        stopStreaming
+**
+** Description:     Stop passing fragments through mRxStreamQueue and drop
+**                  those not consumed.
+**
+** Returns:         None
+**
+*******************************************************************************/
+void TagSession::stopStreaming() {
+  mRxStreaming = false;
+  endTransceive();
+  if (!mRxStreamQueue) return;
+  uint8_t stale[256];
+  uint16_t len = 0;
+  while (mRxStreamQueue->dequeue(stale, sizeof(stale), len)) {
+    // discard fragments left over from an aborted stream
+  }
+}
+
+/*******************************************************************************
+**
+** Function:        onData
+**
+** Description:     Store a response fragment from NFA_DATA_EVT and wake the
+**                  waiter when the response is complete.
+**                  status: NFA_STATUS_OK for the final fragment,
+**                          NFC_STATUS_CONTINUE for chained ones.
+**                  buf: Fragment data.
+**                  bufLen: Length of fragment.
+**
+** Returns:         None
+**
+*******************************************************************************/
+void TagSession::onData(tNFA_STATUS status, uint8_t* buf, uint32_t bufLen) {
+  NFC_TRACE_INSTANT("tag", "data", bufLen);
+  if (mRxStreaming) {
+    onStreamData(status, buf, bufLen);
+    return;
+  }
+  SyncEventGuard g(mTransceiveEvent);
+  DLOG_IF(INFO, nfc_debug_enabled) << StringPrintf(
+      "%s: disc id=%d; data len=%d", __func__, mDiscId, bufLen);
+
+  if (!mWaitingForTransceive) {
+    LOG(ERROR) << StringPrintf("%s: drop data", __func__);
+    return;
+  }
+  mRxDataStatus = status;
+  if (mRxDataStatus == NFA_STATUS_OK || mRxDataStatus == NFC_STATUS_CONTINUE) {
+    if (mRxDirectBuffer != NULL) {
+      // write the fragment straight into the caller's buffer
+      if (bufLen > mRxDirectCapacity - mRxDirectLength) {
+        LOG(ERROR) << StringPrintf("%s: rx buffer overflow; cap=%zu", __func__,
+                                   mRxDirectCapacity);
+        mRxDirectOverflow = true;
+      } else {
+        memcpy(mRxDirectBuffer + mRxDirectLength, buf, bufLen);
+        mRxDirectLength += bufLen;
+      }
+    } else {
+      mRxDataBuffer.append(buf, bufLen);
+    }
+  }
+
+  if (mRxDataStatus == NFA_STATUS_OK) {
+    mResponseDone = true;
+    mTransceiveEvent.notifyOne();
+  }
+}
+
+/*******************************************************************************
+**
+** Function:        onStreamData
+**
+** Description:     Queue a response fragment for the streaming consumer
+**                  without taking mTransceiveEvent, and close the queue when
+**                  the response is complete or failed.
+**                  status: NFA_STATUS_OK for the final fragment,
+**                          NFC_STATUS_CONTINUE for chained ones.
+**                  buf: Fragment data.
+**                  bufLen: Length of fragment.
+**
+** Returns:         None
+**
+*******************************************************************************/
+void TagSession::onStreamData(tNFA_STATUS status, uint8_t* buf,
+                              uint32_t bufLen) {
+  DLOG_IF(INFO, nfc_debug_enabled) << StringPrintf(
+      "%s: disc id=%d; data len=%d", __func__, mDiscId, bufLen);
+  if (status == NFA_STATUS_OK || status == NFC_STATUS_CONTINUE) {
+    // hand each chained fragment to the consumer as it arrives; never
+    // wait for the consumer to make room
+    while (bufLen > 0 && !mRxStreamOverflow) {
+      uint16_t len = (bufLen > UINT16_MAX) ? UINT16_MAX : bufLen;
+      if (!mRxStreamQueue->enqueue(buf, len)) {
+        LOG(ERROR) << StringPrintf("%s: fail enqueue fragment", __func__);
+        mRxStreamOverflow = true;
+      }
+      buf += len;
+      bufLen -= len;
+    }
+    if (status == NFA_STATUS_OK)
+      mRxStreamDone = true;
+    else if (!mRxStreamOverflow)
+      return;
+  } else {
+    LOG(ERROR) << StringPrintf("%s: fail receive; status=0x%X", __func__,
+                               status);
+  }
+  mRxStreamQueue->close();
+}
+
+/*******************************************************************************
+**
+** Function:        onRfTimeout
+**
+** Description:     Wake the waiter because the tag did not respond.
+**                  isTimeout: False if the error must not be reported as
+**                             a timeout.
+**
+** Returns:         None
+**
+*******************************************************************************/
+void TagSession::onRfTimeout(bool isTimeout) {
+  SyncEventGuard g(mTransceiveEvent);
+  DLOG_IF(INFO, nfc_debug_enabled) << StringPrintf(
+      "%s: waiting for transceive: %d", __func__, mWaitingForTransceive);
+  if (!mWaitingForTransceive) return;
+
+  if (isTimeout) mTransceiveRfTimeout = true;
+  mResponseDone = true;
+  if (mRxStreaming) mRxStreamQueue->close();
+  mTransceiveEvent.notifyOne();
+}
+
+/*******************************************************************************
+**
+** Function:        abortTransceive
+**
+** Description:     Unblock a pending transceive and reset presence-check
+**                  state.
+**
+** Returns:         None
+**
+*******************************************************************************/
+void TagSession::abortTransceive() {
+  {
+    SyncEventGuard g(mTransceiveEvent);
+    mResponseDone = true;
+    if (mRxStreaming) mRxStreamQueue->close();
+    mTransceiveEvent.notifyOne();
+  }
+  mIsoDepPresCheckCnt = 0;
+  mPresCheckErrCnt = 0;
+  mIsoDepPresCheckAlternate = false;
+}
+
+/*******************************************************************************
+**
+** Function:        resetPresenceCheck
+**
+** Description:     Reset variables related to presence-check.
+**
+** Returns:         None
+**
+*******************************************************************************/
+void TagSession::resetPresenceCheck() {
+  mIsoDepPresCheckCnt = 0;
+  mPresCheckErrCnt = 0;
+  mIsoDepPresCheckAlternate = false;
+}
+
+/*******************************************************************************
+**
+** Function:        createSessions
+**
+** Description:     Create one session per distinct RF discovery ID of the
+**                  activated tag, dropping sessions of previous tags.
+**                  discIds: RF discovery IDs (NfcTag::mTechHandles).
+**                  count: Number of entries in discIds.
+**
+** Returns:         None
+**
+*******************************************************************************/
+void TagSession::createSessions(const int* discIds, int count) {
+  AutoMutex lock(sSessionsMutex);
+  std::map<int, std::shared_ptr<TagSession>> sessions;
+  for (int i = 0; i < count; i++) {
+    auto it = sSessions.find(discIds[i]);
+    if (it != sSessions.end()) {
+      sessions[discIds[i]] = it->second;  // same target re-activated
+    } else if (sessions.find(discIds[i]) == sessions.end()) {
+      sessions[discIds[i]] = std::make_shared<TagSession>(discIds[i]);
+    }
+  }
+  sSessions.swap(sessions);
+  if (sCurrent && sSessions.find(sCurrent->mDiscId) == sSessions.end())
+    sCurrent.reset();
+  DLOG_IF(INFO, nfc_debug_enabled)
+      << StringPrintf("%s: %zu session(s)", __func__, sSessions.size());
+}
+
+/*******************************************************************************
+**
+** Function:        find
+**
+** Description:     Look up the session of a target.
+**                  discId: RF discovery ID.
+**
+** Returns:         Session, or null if the target is unknown.
+**
+*******************************************************************************/
+std::shared_ptr<TagSession> TagSession::find(int discId) {
+  AutoMutex lock(sSessionsMutex);
+  auto it = sSessions.find(discId);
+  return (it != sSessions.end()) ? it->second : nullptr;
+}
+
+/*******************************************************************************
+**
+** Function:        select
+**
+** Description:     Make the session of a target the one receiving data
+**                  events, creating it if needed.
+**                  discId: RF discovery ID.
+**
+** Returns:         Selected session.
+**
+*******************************************************************************/
+std::shared_ptr<TagSession> TagSession::select(int discId) {
+  AutoMutex lock(sSessionsMutex);
+  std::shared_ptr<TagSession>& session = sSessions[discId];
+  if (!session) session = std::make_shared<TagSession>(discId);
+  sCurrent = session;
+  return session;
+}
+
+/*******************************************************************************
+**
+** Function:        current
+**
+** Description:     Get the session receiving data events: that of the
+**                  last selected target, until another target is selected
+**                  or createSessions() finds it gone. Never null; an idle
+**                  session is returned when there is no such target.
+**
+** Returns:         Current session.
+**
+*******************************************************************************/
+std::shared_ptr<TagSession> TagSession::current() {
+  AutoMutex lock(sSessionsMutex);
+  if (!sCurrent) sCurrent = std::make_shared<TagSession>(IDLE_DISC_ID);
+  return sCurrent;
+}
+
+/*******************************************************************************
+**
+** Function:        releaseAll
+**
+** Description:     Drop all sessions. Sessions still referenced by a
+**                  caller stay valid until released.
+**
+** Returns:         None
+**
+*******************************************************************************/
+void TagSession::releaseAll() {
+  AutoMutex lock(sSessionsMutex);
+  sSessions.clear();
+  sCurrent.reset();
+}
@@ -0,0 +1,540 @@
+/******************************************************************************
+ *
+ *  Copyright 2024 NXP
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/*
+ *  Per-target transaction state of an activated tag.
+ */
+#pragma once
+#include <atomic>
+#include <map>
+#include <memory>
+#include <string>
+#include "DataRing.h"
+#include "Mutex.h"
+#include "SyncEvent.h"
+#include "nfa_api.h"
+
+class TagSession {
+  friend class TagSessionTest;
+
+ public:
+  /*******************************************************************************
+  **
+  ** Function:        TagSession
+  **
+  ** Description:     Initialize member variables.
+  **                  discId: RF discovery ID of the target.
+  **
+  ** Returns:         None
+  **
+  *******************************************************************************/
+  explicit TagSession(int discId);
+
+  /*******************************************************************************
+  **
+  ** Function:        getDiscId
+  **
+  ** Description:     Get the RF discovery ID of the target.
+  **
+  ** Returns:         RF discovery ID.
+  **
+  *******************************************************************************/
+  int getDiscId() { return mDiscId; }
+
+  /*******************************************************************************
+  **
+  ** Function:        getTransceiveEvent
+  **
+  ** Description:     Get the event guarding the transceive state. Hold it
+  **                  around prepareTransceive(), sending the frame and
+  **                  waitResponse().
+  **
+  ** Returns:         Event.
+  **
+  *******************************************************************************/
+  SyncEvent& getTransceiveEvent() { return mTransceiveEvent; }
+
+  /*******************************************************************************
+  **
+  ** Function:        endTransceive
+  **
+  ** Description:     Drop data events until the next prepareTransceive().
+  **
+  ** Returns:         None
+  **
+  *******************************************************************************/
+  void endTransceive();
+
+  /*******************************************************************************
+  **
+  ** Function:        isRfTimeout
+  **
+  ** Description:     Whether the tag did not respond to the frame sent.
+  **                  Caller must hold mTransceiveEvent.
+  **
+  ** Returns:         True if an RF timeout occurred.
+  **
+  *******************************************************************************/
+  bool isRfTimeout() { return mTransceiveRfTimeout; }
+
+  /*******************************************************************************
+  **
+  ** Function:        getResponse
+  **
+  ** Description:     Get the response to the frame sent, when no direct
+  **                  buffer is set. Call once waitResponse() returned.
+  **
+  ** Returns:         Response.
+  **
+  *******************************************************************************/
+  const std::basic_string<uint8_t>& getResponse() { return mRxDataBuffer; }
+
+  /*******************************************************************************
+  **
+  ** Function:        clearResponse
+  **
+  ** Description:     Release the response to the frame sent.
+  **
+  ** Returns:         None
+  **
+  *******************************************************************************/
+  void clearResponse() { mRxDataBuffer.clear(); }
+
+  /*******************************************************************************
+  **
+  ** Function:        setDirectBuffer
+  **
+  ** Description:     Receive the next responses straight into a caller-owned
+  **                  buffer. Caller must hold mTransceiveEvent.
+  **                  buf: Buffer; NULL to stop using it.
+  **                  capacity: Size of buf.
+  **
+  ** Returns:         None
+  **
+  *******************************************************************************/
+  void setDirectBuffer(uint8_t* buf, size_t capacity) {
+    mRxDirectBuffer = buf;
+    mRxDirectCapacity = capacity;
+  }
+
+  /*******************************************************************************
+  **
+  ** Function:        getDirectLength
+  **
+  ** Description:     Get the length of the response in the direct buffer.
+  **
+  ** Returns:         Length in octets.
+  **
+  *******************************************************************************/
+  size_t getDirectLength() { return mRxDirectLength; }
+
+  /*******************************************************************************
+  **
+  ** Function:        isDirectOverflow
+  **
+  ** Description:     Whether the response did not fit the direct buffer.
+  **
+  ** Returns:         True if the response was dropped.
+  **
+  *******************************************************************************/
+  bool isDirectOverflow() { return mRxDirectOverflow; }
+
+  /*******************************************************************************
+  **
+  ** Function:        getStreamQueue
+  **
+  ** Description:     Get the queue of streamed fragments. Only valid after
+  **                  startStreaming().
+  **
+  ** Returns:         Queue.
+  **
+  *******************************************************************************/
+  DataRing& getStreamQueue() { return *mRxStreamQueue; }
+
+  /*******************************************************************************
+  **
+  ** Function:        isStreamDone
+  **
+  ** Description:     Whether the final fragment of the streamed response was
+  **                  queued.
+  **
+  ** Returns:         True if done.
+  **
+  *******************************************************************************/
+  bool isStreamDone() { return mRxStreamDone; }
+
+  /*******************************************************************************
+  **
+  ** Function:        isStreamOverflow
+  **
+  ** Description:     Whether a streamed fragment did not fit the queue.
+  **
+  ** Returns:         True if a fragment was dropped.
+  **
+  *******************************************************************************/
+  bool isStreamOverflow() { return mRxStreamOverflow; }
+
+  /*******************************************************************************
+  **
+  ** Function:        takeActivatedMicros
+  **
+  ** Description:     Get the activation time once, to time the first APDU.
+  **
+  ** Returns:         Activation time in microseconds; 0 if already taken.
+  **
+  *******************************************************************************/
+  uint64_t takeActivatedMicros() {
+    uint64_t micros = mActivatedMicros;
+    mActivatedMicros = 0;
+    return micros;
+  }
+
+  /*******************************************************************************
+  **
+  ** Function:        setActivatedMicros
+  **
+  ** Description:     Set the activation time of the target.
+  **                  micros: Activation time in microseconds.
+  **
+  ** Returns:         None
+  **
+  *******************************************************************************/
+  void setActivatedMicros(uint64_t micros) { mActivatedMicros = micros; }
+
+  /*******************************************************************************
+  **
+  ** Function:        getPresCheckFingerprint
+  **
+  ** Description:     Get the key of learned presence-check behavior.
+  **
+  ** Returns:         Fingerprint.
+  **
+  *******************************************************************************/
+  uint32_t getPresCheckFingerprint() { return mPresCheckFingerprint; }
+
+  /*******************************************************************************
+  **
+  ** Function:        setPresCheckFingerprint
+  **
+  ** Description:     Set the key of learned presence-check behavior.
+  **                  fingerprint: Fingerprint of the target.
+  **
+  ** Returns:         None
+  **
+  *******************************************************************************/
+  void setPresCheckFingerprint(uint32_t fingerprint) {
+    mPresCheckFingerprint = fingerprint;
+  }
+
+  /*******************************************************************************
+  **
+  ** Function:        countPresCheckError
+  **
+  ** Description:     Count a presence check the tag did not answer in time.
+  **
+  ** Returns:         Number of such checks in a row.
+  **
+  *******************************************************************************/
+  int countPresCheckError() { return ++mPresCheckErrCnt; }
+
+  /*******************************************************************************
+  **
+  ** Function:        getPresCheckErrors
+  **
+  ** Description:     Get the number of unanswered presence checks in a row.
+  **
+  ** Returns:         Number of checks.
+  **
+  *******************************************************************************/
+  int getPresCheckErrors() { return mPresCheckErrCnt; }
+
+  /*******************************************************************************
+  **
+  ** Function:        clearPresCheckErrors
+  **
+  ** Description:     Forget the unanswered presence checks.
+  **
+  ** Returns:         None
+  **
+  *******************************************************************************/
+  void clearPresCheckErrors() { mPresCheckErrCnt = 0; }
+
+  /*******************************************************************************
+  **
+  ** Function:        countIsoDepNakPresCheck
+  **
+  ** Description:     Count an ISO-DEP presence check done with R(NAK).
+  **
+  ** Returns:         Number of such checks.
+  **
+  *******************************************************************************/
+  int countIsoDepNakPresCheck() { return ++mIsoDepPresCheckCnt; }
+
+  /*******************************************************************************
+  **
+  ** Function:        getIsoDepNakPresChecks
+  **
+  ** Description:     Get the number of ISO-DEP presence checks done with
+  **                  R(NAK).
+  **
+  ** Returns:         Number of checks.
+  **
+  *******************************************************************************/
+  int getIsoDepNakPresChecks() { return mIsoDepPresCheckCnt; }
+
+  /*******************************************************************************
+  **
+  ** Function:        isIsoDepPresCheckAlternate
+  **
+  ** Description:     Whether ISO-DEP presence checks use I-blocks, as the
+  **                  tag does not support R(NAK).
+  **
+  ** Returns:         True if I-blocks are used.
+  **
+  *******************************************************************************/
+  bool isIsoDepPresCheckAlternate() { return mIsoDepPresCheckAlternate; }
+
+  /*******************************************************************************
+  **
+  ** Function:        setIsoDepPresCheckAlternate
+  **
+  ** Description:     Use I-blocks for the ISO-DEP presence checks.
+  **
+  ** Returns:         None
+  **
+  *******************************************************************************/
+  void setIsoDepPresCheckAlternate() { mIsoDepPresCheckAlternate = true; }
+
+  /*******************************************************************************
+  **
+  ** Function:        prepareTransceive
+  **
+  ** Description:     Reset the receive state before a frame is sent.
+  **                  Caller must hold mTransceiveEvent.
+  **
+  ** Returns:         None
+  **
+  *******************************************************************************/
+  void prepareTransceive();
+
+  /*******************************************************************************
+  **
+  ** Function:        startStreaming
+  **
+  ** Description:     Pass the fragments of the next response through
+  **                  mRxStreamQueue, allocating it on first use. Call after
+  **                  prepareTransceive(); caller must hold mTransceiveEvent.
+  **
+  ** Returns:         None
+  **
+  *******************************************************************************/
+  void startStreaming();
+
+  /*******************************************************************************
+  **
+  ** Function:        stopStreaming
+  **
+  ** Description:     Stop passing fragments through mRxStreamQueue and drop
+  **                  those not consumed.
+  **
+  ** Returns:         None
+  **
+  *******************************************************************************/
+  void stopStreaming();
+
+  /*******************************************************************************
+  **
+  ** Function:        waitResponse
+  **
+  ** Description:     Wait for the response to the frame sent, an RF timeout
+  **                  or an abort. Caller must hold mTransceiveEvent.
+  **                  timeout: Timeout in milliseconds.
+  **
+  ** Returns:         False if timeout occurs.
+  **
+  *******************************************************************************/
+  bool waitResponse(int timeout) {
+    return mTransceiveEvent.wait(timeout, [this] { return mResponseDone; });
+  }
+
+  /*******************************************************************************
+  **
+  ** Function:        onData
+  **
+  ** Description:     Store a response fragment from NFA_DATA_EVT and wake the
+  **                  waiter when the response is complete.
+  **                  status: NFA_STATUS_OK for the final fragment,
+  **                          NFC_STATUS_CONTINUE for chained ones.
+  **                  buf: Fragment data.
+  **                  bufLen: Length of fragment.
+  **
+  ** Returns:         None
+  **
+  *******************************************************************************/
+  void onData(tNFA_STATUS status, uint8_t* buf, uint32_t bufLen);
+
+  /*******************************************************************************
+  **
+  ** Function:        onRfTimeout
+  **
+  ** Description:     Wake the waiter because the tag did not respond.
+  **                  isTimeout: False if the error must not be reported as
+  **                             a timeout.
+  **
+  ** Returns:         None
+  **
+  *******************************************************************************/
+  void onRfTimeout(bool isTimeout);
+
+  /*******************************************************************************
+  **
+  ** Function:        abortTransceive
+  **
+  ** Description:     Unblock a pending transceive and reset presence-check
+  **                  state.
+  **
+  ** Returns:         None
+  **
+  *******************************************************************************/
+  void abortTransceive();
+
+  /*******************************************************************************
+  **
+  ** Function:        resetPresenceCheck
+  **
+  ** Description:     Reset variables related to presence-check.
+  **
+  ** Returns:         None
+  **
+  *******************************************************************************/
+  void resetPresenceCheck();
+
+  /*******************************************************************************
+  **
+  ** Function:        createSessions
+  **
+  ** Description:     Create one session per distinct RF discovery ID of the
+  **                  activated tag, dropping sessions of previous tags.
+  **                  discIds: RF discovery IDs (NfcTag::mTechHandles).
+  **                  count: Number of entries in discIds.
+  **
+  ** Returns:         None
+  **
+  *******************************************************************************/
+  static void createSessions(const int* discIds, int count);
+
+  /*******************************************************************************
+  **
+  ** Function:        find
+  **
+  ** Description:     Look up the session of a target.
+  **                  discId: RF discovery ID.
+  **
+  ** Returns:         Session, or null if the target is unknown.
+  **
+  *******************************************************************************/
+  static std::shared_ptr<TagSession> find(int discId);
+
+  /*******************************************************************************
+  **
+  ** Function:        select
+  **
+  ** Description:     Make the session of a target the one receiving data
+  **                  events, creating it if needed.
+  **                  discId: RF discovery ID.
+  **
+  ** Returns:         Selected session.
+  **
+  *******************************************************************************/
+  static std::shared_ptr<TagSession> select(int discId);
+
+  /*******************************************************************************
+  **
+  ** Function:        current
+  **
+  ** Description:     Get the session receiving data events: that of the
+  **                  last selected target, until another target is selected
+  **                  or createSessions() finds it gone. Never null; an idle
+  **                  session is returned when there is no such target.
+  **
+  ** Returns:         Current session.
+  **
+  *******************************************************************************/
+  static std::shared_ptr<TagSession> current();
+
+  /*******************************************************************************
+  **
+  ** Function:        releaseAll
+  **
+  ** Description:     Drop all sessions. Sessions still referenced by a
+  **                  caller stay valid until released.
+  **
+  ** Returns:         None
+  **
+  *******************************************************************************/
+  static void releaseAll();
+
+ private:
+  static const int IDLE_DISC_ID = -1;
+  static const size_t RX_STREAM_RING_SIZE = 0x10000;
+
+  int mDiscId;
+  SyncEvent mTransceiveEvent;  // guards all transceive members below
+  std::basic_string<uint8_t> mRxDataBuffer;
+  tNFA_STATUS mRxDataStatus;
+  bool mWaitingForTransceive;
+  bool mTransceiveRfTimeout;
+  bool mResponseDone;  // response, RF timeout or abort since prepareTransceive
+  uint8_t* mRxDirectBuffer;  // caller-owned RX buffer, if any
+  size_t mRxDirectCapacity;
+  size_t mRxDirectLength;
+  bool mRxDirectOverflow;
+  // chained fragments not yet consumed; allocated by startStreaming() and
+  // filled without mTransceiveEvent, so that NFA never waits for the consumer
+  std::unique_ptr<DataRing> mRxStreamQueue;
+  std::atomic<bool> mRxStreaming;
+  std::atomic<bool> mRxStreamDone;
+  std::atomic<bool> mRxStreamOverflow;
+
+  int mIsoDepPresCheckCnt;
+  bool mIsoDepPresCheckAlternate;
+  int mPresCheckErrCnt;
+  uint32_t mPresCheckFingerprint;  // key of learned presence-check behavior
+  uint64_t mActivatedMicros;  // activation time; 0 once first APDU is timed
+
+  /*******************************************************************************
+  **
+  ** Function:        onStreamData
+  **
+  ** Description:     Queue a response fragment for the streaming consumer
+  **                  without taking mTransceiveEvent, and close the queue
+  **                  when the response is complete or failed.
+  **                  status: NFA_STATUS_OK for the final fragment,
+  **                          NFC_STATUS_CONTINUE for chained ones.
+  **                  buf: Fragment data.
+  **                  bufLen: Length of fragment.
+  **
+  ** Returns:         None
+  **
+  *******************************************************************************/
+  void onStreamData(tNFA_STATUS status, uint8_t* buf, uint32_t bufLen);
+
+  static Mutex sSessionsMutex;  // guards sSessions and sCurrent only
+  static std::map<int, std::shared_ptr<TagSession>> sSessions;
+  static std::shared_ptr<TagSession> sCurrent;
+};
@@ -0,0 +1,161 @@
+#include <gtest/gtest.h>
+
+#include "TagSession.h"
+#include "nfc_api.h"
+
+class TagSessionTest : public ::testing::Test {
+ protected:
+  void TearDown() override { TagSession::releaseAll(); }
+
+  static bool hasStreamQueue(TagSession& session) {
+    return session.mRxStreamQueue != nullptr;
+  }
+  static tNFA_STATUS getRxDataStatus(TagSession& session) {
+    return session.mRxDataStatus;
+  }
+};
+
+TEST_F(TagSessionTest, ChainedFragmentsAreAppended) {
+  TagSession session(1);
+  uint8_t first[] = {0x01, 0x02};
+  uint8_t last[] = {0x90, 0x00};
+
+  {
+    SyncEventGuard g(session.getTransceiveEvent());
+    session.prepareTransceive();
+  }
+  session.onData(NFC_STATUS_CONTINUE, first, sizeof(first));
+  session.onData(NFA_STATUS_OK, last, sizeof(last));
+
+  std::basic_string<uint8_t> expected = {0x01, 0x02, 0x90, 0x00};
+  EXPECT_EQ(expected, session.getResponse());
+  EXPECT_EQ(NFA_STATUS_OK, getRxDataStatus(session));
+}
+
+TEST_F(TagSessionTest, DataDroppedWhenNotWaiting) {
+  TagSession session(1);
+  uint8_t data[] = {0x90, 0x00};
+
+  session.onData(NFA_STATUS_OK, data, sizeof(data));
+
+  EXPECT_TRUE(session.getResponse().empty());
+}
+
+TEST_F(TagSessionTest, DirectBufferOverflowIsFlagged) {
+  TagSession session(1);
+  uint8_t rx[3];
+  uint8_t data[] = {0x01, 0x02, 0x90, 0x00};
+
+  {
+    SyncEventGuard g(session.getTransceiveEvent());
+    session.prepareTransceive();
+    session.setDirectBuffer(rx, sizeof(rx));
+  }
+  session.onData(NFA_STATUS_OK, data, sizeof(data));
+
+  EXPECT_TRUE(session.isDirectOverflow());
+  EXPECT_EQ(0u, session.getDirectLength());
+}
+
+TEST_F(TagSessionTest, StreamedFragmentsAreQueued) {
+  TagSession session(1);
+  uint8_t first[] = {0x01, 0x02};
+  uint8_t last[] = {0x90, 0x00};
+  uint8_t buffer[4];
+  uint16_t len = 0;
+
+  // allocated by the first stream only
+  EXPECT_FALSE(hasStreamQueue(session));
+  {
+    SyncEventGuard g(session.getTransceiveEvent());
+    session.prepareTransceive();
+    session.startStreaming();
+  }
+  ASSERT_TRUE(hasStreamQueue(session));
+  session.onData(NFC_STATUS_CONTINUE, first, sizeof(first));
+  EXPECT_FALSE(session.getStreamQueue().isClosed());
+  session.onData(NFA_STATUS_OK, last, sizeof(last));
+  EXPECT_TRUE(session.isStreamDone());
+  EXPECT_TRUE(session.getStreamQueue().isClosed());
+
+  ASSERT_TRUE(session.getStreamQueue().dequeue(buffer, sizeof(buffer), len));
+  EXPECT_EQ(sizeof(first), len);
+  ASSERT_TRUE(session.getStreamQueue().dequeue(buffer, sizeof(buffer), len));
+  EXPECT_EQ(sizeof(last), len);
+  EXPECT_TRUE(session.getResponse().empty());
+  session.stopStreaming();
+}
+
+TEST_F(TagSessionTest, RfTimeoutClosesStream) {
+  TagSession session(1);
+
+  {
+    SyncEventGuard g(session.getTransceiveEvent());
+    session.prepareTransceive();
+    session.startStreaming();
+  }
+  session.onRfTimeout(true);
+  EXPECT_TRUE(session.getStreamQueue().isClosed());
+  EXPECT_FALSE(session.isStreamDone());
+  session.stopStreaming();
+}
+
+TEST_F(TagSessionTest, RfTimeoutOnlyWhenWaiting) {
+  TagSession session(1);
+
+  session.onRfTimeout(true);
+  EXPECT_FALSE(session.isRfTimeout());
+
+  {
+    SyncEventGuard g(session.getTransceiveEvent());
+    session.prepareTransceive();
+  }
+  session.onRfTimeout(true);
+  EXPECT_TRUE(session.isRfTimeout());
+}
+
+TEST_F(TagSessionTest, OneSessionPerDiscoveryId) {
+  int discIds[] = {1, 1, 2};
+  TagSession::createSessions(discIds, 3);
+
+  std::shared_ptr<TagSession> first = TagSession::find(1);
+  std::shared_ptr<TagSession> second = TagSession::find(2);
+  ASSERT_NE(nullptr, first);
+  ASSERT_NE(nullptr, second);
+  EXPECT_NE(first, second);
+  EXPECT_EQ(nullptr, TagSession::find(3));
+
+  EXPECT_EQ(second, TagSession::select(2));
+  EXPECT_EQ(second, TagSession::current());
+
+  // re-activation of the same target keeps its session
+  TagSession::createSessions(discIds + 2, 1);
+  EXPECT_EQ(second, TagSession::find(2));
+  EXPECT_EQ(nullptr, TagSession::find(1));
+  EXPECT_EQ(second, TagSession::current());
+}
+
+TEST_F(TagSessionTest, CurrentIsNeverNull) {
+  TagSession::releaseAll();
+  std::shared_ptr<TagSession> idle = TagSession::current();
+  ASSERT_NE(nullptr, idle);
+  EXPECT_EQ(-1, idle->getDiscId());
+}
+
+TEST_F(TagSessionTest, CurrentKeptUntilAnotherTargetIsSelected) {
+  int discIds[] = {1, 2};
+  TagSession::createSessions(discIds, 2);
+
+  std::shared_ptr<TagSession> first = TagSession::select(1);
+  ASSERT_NE(nullptr, first);
+  first->setPresCheckFingerprint(0x1234);
+
+  // as nativeNfcTag_abortWaits() does on deactivation
+  TagSession::current()->abortTransceive();
+  EXPECT_EQ(first, TagSession::current());
+
+  std::shared_ptr<TagSession> second = TagSession::select(2);
+  EXPECT_EQ(second, TagSession::current());
+  EXPECT_EQ(first, TagSession::find(1));
+  EXPECT_EQ(0x1234u, TagSession::find(1)->getPresCheckFingerprint());
+}
@@ -291,6 +291,9 @@ public class NativeNfcManager implements DeviceHost {
     @Override
     public native int   getDefaultFelicaCLTPowerState();
 
+    @Override
+    public native boolean beginRoutingTransaction();
+
     @Override
     public native boolean commitRouting();
 
@@ -421,6 +424,16 @@ public class NativeNfcManager implements DeviceHost {
     public byte[] doReadT4tData(byte[] fileId) {
       return mT4tNfceeMgr.doReadT4tData(fileId);
     }
+
+    @Override
+    public int doWriteT4tDataRange(byte[] fileId, int offset, byte[] data) {
+      return mT4tNfceeMgr.doWriteT4tDataRange(fileId, offset, data);
+    }
+
+    @Override
+    public byte[] doReadT4tDataRange(byte[] fileId, int offset, int length) {
+      return mT4tNfceeMgr.doReadT4tDataRange(fileId, offset, length);
+    }
     @Override
     public int startExtendedFieldDetectMode(int detectionTimeout) {
       return mExtFieldMgr.startExtendedFieldDetectMode(detectionTimeout);
@@ -575,6 +588,9 @@ public class NativeNfcManager implements DeviceHost {
     @Override
     public native int getMaxRoutingTableSize();
 
+    /** Returns latency histograms and error counters of the JNI as JSON. */
+    public native String getMetricsSnapshot();
+
     /** Notifies Ndef Message (TODO: rename into notifyTargetDiscovered) */
     private void notifyNdefMessageListeners(NativeNfcTag tag) {
         mListener.onRemoteEndpointDiscovered(tag);
@@ -632,8 +648,13 @@ public class NativeNfcManager implements DeviceHost {
         mListener.notifyCoreGenericError(errorCode);
     }
 
-    private void notifyTransactionListeners(byte[] aid, byte[] data, String evtSrc) {
-        mListener.onNfcTransactionEvent(aid, data, evtSrc);
+    /**
+     * Notifies a batch of transaction events, in order of arrival
+     */
+    private void notifyTransactionListeners(byte[][] aids, byte[][] data, String[] evtSrcs) {
+        for (int i = 0; i < aids.length; i++) {
+            mListener.onNfcTransactionEvent(aids[i], data[i], evtSrcs[i]);
+        }
     }
 
     private void notifyEeUpdated() {
@@ -54,6 +54,8 @@ import android.util.Log;
 import com.android.nfc.DeviceHost;
 import com.android.nfc.DeviceHost.TagEndpoint;
 
+import java.nio.ByteBuffer;
+
 /** Native interface to the NFC tag functions */
 public class NativeNfcTag implements TagEndpoint {
     static final boolean DBG = true;
@@ -288,6 +290,10 @@ public class NativeNfcTag implements TagEndpoint {
         // to know the tag is in the field.
         mIsPresent = true;
         if (mWatchdog == null) {
+            int maxDelay = doGetPresenceCheckInterval();
+            if (maxDelay > 0 && presenceCheckDelay > maxDelay) {
+                presenceCheckDelay = maxDelay;
+            }
             mWatchdog = new PresenceCheckWatchdog(presenceCheckDelay, callback);
             mWatchdog.start();
         }
@@ -391,6 +397,100 @@ public class NativeNfcTag implements TagEndpoint {
         return result;
     }
 
+    private native int doTransceiveDirect(ByteBuffer tx, int txLen, ByteBuffer rx,
+            int[] returnCode);
+
+    /**
+     * Transceive using caller-owned direct buffers. The response is written to
+     * {@code rx} starting at position 0.
+     *
+     * @return number of response bytes, or -1 on failure
+     */
+    public synchronized int transceive(ByteBuffer tx, int txLen, ByteBuffer rx,
+            int[] returnCode) {
+        if (tx == null || rx == null || !tx.isDirect() || !rx.isDirect()) {
+            throw new IllegalArgumentException("direct buffers required");
+        }
+        if (mWatchdog != null) {
+            mWatchdog.pause();
+        }
+        int result = doTransceiveDirect(tx, txLen, rx, returnCode);
+        if (mWatchdog != null) {
+            mWatchdog.doResume();
+        }
+        return result;
+    }
+
+    private native byte[] doTransceiveBatch(byte[][] apdus, int[] expectedSw, int[] swMask,
+            boolean abortOnMismatch, int[] returnCode);
+
+    /**
+     * Run a script of C-APDUs in one native call.
+     *
+     * @param expectedSw expected status word per C-APDU, or null to skip checks
+     * @param swMask mask applied before comparing; 0 skips the check for that C-APDU
+     * @return one R-APDU per executed C-APDU, or null if none was executed
+     */
+    public synchronized byte[][] transceiveBatch(byte[][] apdus, int[] expectedSw,
+            int[] swMask, boolean abortOnMismatch, int[] returnCode) {
+        if (mWatchdog != null) {
+            mWatchdog.pause();
+        }
+        byte[] packed = doTransceiveBatch(apdus, expectedSw, swMask, abortOnMismatch,
+                returnCode);
+        if (mWatchdog != null) {
+            mWatchdog.doResume();
+        }
+        if (packed == null) {
+            return null;
+        }
+        // each R-APDU is preceded by its 4-byte big-endian length
+        ByteBuffer buffer = ByteBuffer.wrap(packed);
+        int count = 0;
+        while (buffer.remaining() >= 4) {
+            buffer.position(buffer.position() + 4 + buffer.getInt(buffer.position()));
+            count++;
+        }
+        buffer.rewind();
+        byte[][] responses = new byte[count][];
+        for (int i = 0; i < count; i++) {
+            responses[i] = new byte[buffer.getInt()];
+            buffer.get(responses[i]);
+        }
+        return responses;
+    }
+
+    /** Receives response fragments from {@link #transceiveStreaming}. */
+    public interface FragmentConsumer {
+        /**
+         * Called on the transceiving thread for each chained fragment, in order.
+         *
+         * @param last true for the final fragment of the response
+         */
+        void onFragment(byte[] fragment, boolean last);
+    }
+
+    private native int doTransceiveStreaming(byte[] data, FragmentConsumer consumer,
+            int[] returnCode);
+
+    /**
+     * Transceive with an ISO-DEP tag, handing each chained response fragment to
+     * {@code consumer} as it arrives instead of buffering the whole response.
+     *
+     * @return total number of response bytes, or -1 on failure
+     */
+    public synchronized int transceiveStreaming(byte[] data, FragmentConsumer consumer,
+            int[] returnCode) {
+        if (mWatchdog != null) {
+            mWatchdog.pause();
+        }
+        int result = doTransceiveStreaming(data, consumer, returnCode);
+        if (mWatchdog != null) {
+            mWatchdog.doResume();
+        }
+        return result;
+    }
+
     private native int doCheckNdef(int[] ndefinfo);
 
     private synchronized int checkNdefWithStatus(int[] ndefinfo) {
@@ -445,6 +545,8 @@ public class NativeNfcTag implements TagEndpoint {
 
     native boolean doPresenceCheck();
 
+    native int doGetPresenceCheckInterval();
+
     @Override
     public synchronized boolean presenceCheck() {
         if (mWatchdog != null) {
@@ -24,6 +24,10 @@ public class NativeT4tNfceeManager {
 
   public native byte[] doReadT4tData(byte[] fileId);
 
+  public native int doWriteT4tDataRange(byte[] fileId, int offset, byte[] data);
+
+  public native byte[] doReadT4tDataRange(byte[] fileId, int offset, int length);
+
   public native boolean doLockT4tData(boolean lock);
 
   public native boolean isLockedT4tData();
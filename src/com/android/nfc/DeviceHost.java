@@ -225,6 +225,8 @@ public interface DeviceHost {
 
     public int getDefaultFelicaCLTPowerState();
 
+    public boolean beginRoutingTransaction();
+
     public boolean commitRouting();
 
     public void setEmptyAidRoute(int defaultAidRoute);
@@ -324,6 +326,8 @@ public interface DeviceHost {
     public boolean isRssiEnabled();
     public int doWriteT4tData(byte[] fileId, byte[] data, int length);
     public byte[] doReadT4tData(byte[] fileId);
+    public int doWriteT4tDataRange(byte[] fileId, int offset, byte[] data);
+    public byte[] doReadT4tDataRange(byte[] fileId, int offset, int length);
     public boolean doLockT4tData(boolean lock);
     public boolean isLockedT4tData();
     public boolean doClearNdefT4tData();
@@ -257,6 +257,7 @@ public class NfcService implements DeviceHostListener, ForegroundUtils.Callback
     public static final int MSG_SRD_EVT_FEATURE_NOT_SUPPORT = 85;
     public static final int MSG_EFDM_EVT_TIMEOUT = 86;
     public static final int MSG_TAG_ABORT_OPERATION = 87;
+    static final int MSG_BEGIN_ROUTING_TRANSACTION = 88;
     private int SE_READER_TYPE = SE_READER_TYPE_INAVLID;
 
     static final String MSG_ROUTE_AID_PARAM_TAG = "power";
@@ -3824,6 +3825,14 @@ public class NfcService implements DeviceHostListener, ForegroundUtils.Callback
         return mDeviceHost.getLfT3tMax();
     }
 
+    /**
+     * Routes and unroutes queued after this are sent to the controller without
+     * waiting for each other, up to the next commitRouting().
+     */
+    public void beginRoutingTransaction() {
+        mHandler.sendEmptyMessage(MSG_BEGIN_ROUTING_TRANSACTION);
+    }
+
     public void commitRouting() {
         Log.d(TAG, "commitRouting >>>");
         mHandler.sendEmptyMessage(MSG_COMMIT_ROUTING);
@@ -4008,6 +4017,10 @@ public class NfcService implements DeviceHostListener, ForegroundUtils.Callback
                     mDeviceHost.unrouteAid(hexStringToBytes(aid));
                     break;
                 }
+                case MSG_BEGIN_ROUTING_TRANSACTION: {
+                    mDeviceHost.beginRoutingTransaction();
+                    break;
+                }
                 case MSG_REGISTER_T3T_IDENTIFIER: {
                     Log.d(TAG, "message to register LF_T3T_IDENTIFIER");
                     mDeviceHost.disableDiscovery();
@@ -45,6 +45,7 @@ import com.android.nfc.NfcService;
 import com.android.nfc.NfcStatsLog;
 import android.util.SparseArray;
 import android.util.proto.ProtoOutputStream;
+import java.io.ByteArrayOutputStream;
 import java.io.FileDescriptor;
 import java.io.PrintWriter;
 import java.util.Collections;
@@ -115,6 +116,8 @@ public class AidRoutingManager {
     private native byte[] doGetOffHostEseDestination();
     private native int doGetAidMatchingMode();
     private native int doGetDefaultIsoDepRouteDestination();
+    private native int doGetPlannedAidTableSize(byte[] entries);
+    private native int doResolveAidRoute(byte[] aid);
     final ActivityManager mActivityManager;
     final class AidEntry {
         boolean isOnHost;
@@ -163,7 +166,14 @@ public class AidRoutingManager {
     public int calculateAidRouteSize(HashMap<String, AidEntry> routeCache) {
         // TAG + ROUTE + LENGTH_BYTE + POWER
         int AID_HDR_LENGTH = 0x04;
-        int routeTableSize = 0x00;
+        // the native planner leaves out AIDs covered by prefix AIDs
+        byte[] entries = getAidRouteEntries(routeCache);
+        int routeTableSize = (entries != null) ? doGetPlannedAidTableSize(entries) : -1;
+        if (routeTableSize >= 0) {
+            if (DBG) Log.d(TAG, "calculateAidRouteSize: " + routeTableSize);
+            return routeTableSize;
+        }
+        routeTableSize = 0x00;
         for(Map.Entry<String, AidEntry> aidEntry : routeCache.entrySet()) {
             String aid = aidEntry.getKey();
             // removing prefix length
@@ -177,6 +187,50 @@ public class AidRoutingManager {
         return routeTableSize;
     }
 
+    // Formats the entries as in the routing table: type, length, route, power, AID
+    private byte[] getAidRouteEntries(HashMap<String, AidEntry> routeCache) {
+        ByteArrayOutputStream entries = new ByteArrayOutputStream();
+        for (Map.Entry<String, AidEntry> aidEntry : routeCache.entrySet()) {
+            String aid = aidEntry.getKey();
+            AidEntry entry = aidEntry.getValue();
+            if (aid.endsWith("*") || aid.endsWith("#")) {
+                aid = aid.substring(0, aid.length() - 1);
+            }
+            byte[] aidBytes = hexToBytes(aid);
+            if (aidBytes == null) {
+                Log.e(TAG, "Invalid AID " + aid);
+                return null;
+            }
+            entries.write(0x02 | (entry.aidInfo & 0xF0));
+            entries.write(aidBytes.length + 2);
+            entries.write(entry.route);
+            entries.write(entry.power);
+            entries.write(aidBytes, 0, aidBytes.length);
+        }
+        return entries.toByteArray();
+    }
+
+    private static byte[] hexToBytes(String hex) {
+        byte[] bytes = new byte[hex.length() / 2];
+        try {
+            for (int i = 0; i < bytes.length; i++) {
+                bytes[i] = (byte) Integer.parseInt(hex.substring(2 * i, 2 * i + 2), 16);
+            }
+        } catch (NumberFormatException e) {
+            return null;
+        }
+        return bytes;
+    }
+
+    /**
+     * Returns the route a SELECT command for the AID is sent to according to
+     * the AIDs committed natively, or -1 if no route matches.
+     */
+    public int resolveAidRoute(String aid) {
+        byte[] aidBytes = hexToBytes(aid);
+        return (aidBytes != null) ? doResolveAidRoute(aidBytes) : -1;
+    }
+
     private void clearNfcRoutingTableLocked() {
         for (Map.Entry<String, AidEntry> aidEntry : mRouteForAid.entrySet())  {
             String aid = aidEntry.getKey();
@@ -524,6 +578,8 @@ public class AidRoutingManager {
        {
          return;
        }
+        boolean isNfcEnabled = NfcService.getInstance().isNfcEnabled();
+        if (isNfcEnabled) NfcService.getInstance().beginRoutingTransaction();
         for (Map.Entry<String, AidEntry> aidEntry : routeCache.entrySet())  {
           /*NXP_EXTNS: Empty Aid route is registered by Nfc service. To align majority of code with
            * AOSP, additional check is added to skip empty aid route registration from
@@ -544,7 +600,7 @@ public class AidRoutingManager {
             NfcService.getInstance().routeAids(aid, route, aidType, power);
         }
 
-        if (NfcService.getInstance().isNfcEnabled())
+        if (isNfcEnabled)
           NfcService.getInstance().commitRouting();
     }
     /**
@@ -574,7 +630,18 @@ public class AidRoutingManager {
                 Set<String> aids = mAidRoutingTable.valueAt(i);
                 pw.println("    Routed to 0x" + Integer.toHexString(mAidRoutingTable.keyAt(i)) + ":");
                 for (String aid : aids) {
-                    pw.println("        \"" + aid + "\"");
+                    String selectAid = aid;
+                    if (aid.endsWith("*") || aid.endsWith("#")) {
+                        selectAid = aid.substring(0, aid.length() - 1);
+                    }
+                    int route = resolveAidRoute(selectAid);
+                    if (route >= 0 && route != mAidRoutingTable.keyAt(i)) {
+                        // an overlapping entry wins the SELECT of this AID
+                        pw.println("        \"" + aid + "\" (selects 0x"
+                                + Integer.toHexString(route) + ")");
+                    } else {
+                        pw.println("        \"" + aid + "\"");
+                    }
                 }
             }
         }